@@ -45,6 +45,16 @@ namespace uvgrtp {
              * \return Difference of the timestamps in milliseconds
              */
             uint64_t diff_now(uint64_t then);
+
+            /**
+             * \brief Convert Unix time to NTP units
+             *
+             * \param sec Seconds since the Unix epoch
+             * \param nsec Nanoseconds
+             *
+             * \return NTP timestamp
+             */
+            uint64_t from_unix(uint64_t sec, uint64_t nsec);
         };
 
         /// \cond DO_NOT_DOCUMENT
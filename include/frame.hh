@@ -18,6 +18,9 @@
 #define RTCP_HEADER_LENGTH  12
 
 namespace uvgrtp {
+
+    class frame_pool;
+
     namespace frame {
         enum HEADER_SIZES {
             HEADER_SIZE_RTP      = 12,
@@ -38,11 +41,13 @@ namespace uvgrtp {
         };
 
         enum RTCP_FRAME_TYPE {
-            RTCP_FT_SR   = 200, /* Sender report */
-            RTCP_FT_RR   = 201, /* Receiver report */
-            RTCP_FT_SDES = 202, /* Source description */
-            RTCP_FT_BYE  = 203, /* Goodbye */
-            RTCP_FT_APP  = 204  /* Application-specific message */
+            RTCP_FT_SR    = 200, /* Sender report */
+            RTCP_FT_RR    = 201, /* Receiver report */
+            RTCP_FT_SDES  = 202, /* Source description */
+            RTCP_FT_BYE   = 203, /* Goodbye */
+            RTCP_FT_APP   = 204, /* Application-specific message */
+            RTCP_FT_RTPFB = 205, /* Transport layer feedback message */
+            RTCP_FT_PSFB  = 206  /* Payload-specific feedback message */
         };
 
         PACK(struct rtp_header {
@@ -91,6 +96,18 @@ namespace uvgrtp {
             rtp_format_t format = RTP_FORMAT_GENERIC;
             int  type = 0;
             sockaddr_in src_addr;
+
+            /* NTP timestamp of when the datagram was received. The kernel receive timestamp is used
+             * if it is available. For a reassembled frame, this is the arrival time of its first packet */
+            uint64_t arrival = 0;
+
+            /* ECN codepoint of the datagram (RFC 3168), 0 (Not-ECT) if it is not known, see RCE_ECN */
+            uint8_t ecn = 0;
+
+            /* Pool of the media stream the frame and its payload are returned to and the size class
+             * of the payload buffer, nullptr and -1 if they were allocated with new (for internal use only) */
+            uvgrtp::frame_pool *pool = nullptr;
+            int payload_class = -1;
         };
 
         struct rtcp_header {
@@ -154,6 +171,20 @@ namespace uvgrtp {
             uint8_t *payload = nullptr;
         };
 
+        /* RTCP ECN feedback packet of RFC 6679, transport layer feedback with FMT 8 */
+        struct rtcp_ecn_feedback {
+            struct rtcp_header header;
+            uint32_t ssrc = 0;        /* SSRC of the packet sender */
+            uint32_t media_ssrc = 0;  /* SSRC of the media source the counters are for */
+            uint32_t ext_max_seq = 0; /* extended highest sequence number received */
+            uint32_t ect0 = 0;        /* number of packets received with ECT(0) */
+            uint32_t ect1 = 0;        /* number of packets received with ECT(1) */
+            uint16_t ce = 0;          /* number of packets received with ECN-CE */
+            uint16_t not_ect = 0;     /* number of packets received without ECT */
+            uint16_t lost = 0;        /* number of lost packets */
+            uint16_t duplicates = 0;  /* number of duplicate packets */
+        };
+
         PACK(struct zrtp_frame {
             uint8_t version:4;
             uint16_t unused:12;
@@ -189,6 +220,9 @@ namespace uvgrtp {
         zrtp_frame *alloc_zrtp_frame(size_t payload_size);
 
         /* Deallocate RTP frame
+         *
+         * Received frames and their payloads are returned to the pool of the media stream,
+         * so the payload must not be freed or replaced by the application
          *
          * Return RTP_OK on successs
          * Return RTP_INVALID_VALUE if "frame" is nullptr */
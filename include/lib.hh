@@ -15,6 +15,8 @@
 
 namespace uvgrtp {
 
+    class reactor;
+
     class context {
         public:
             /**
@@ -30,9 +32,33 @@ namespace uvgrtp {
              *
              * \details This does not destroy active sessions. They must be destroyed manually
              * by calling uvgrtp::context::destroy_session()
+             *
+             * If the reactor has been started, all sessions must be destroyed before the context
              */
             ~context();
 
+            /**
+             * \brief Run the media streams of this context on a shared reactor
+             *
+             * \details By default each media stream has its own receiver thread and, if RTCP or
+             * keepalive is enabled, their own threads as well. With the reactor, the sockets and
+             * timers of all media streams are multiplexed on "threads" epoll threads so that
+             * idle media streams do not consume any CPU.
+             *
+             * Only sessions created after calling this function use the reactor
+             *
+             * \param threads Number of reactor threads
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK                On success
+             * \retval RTP_INVALID_VALUE     If threads is 0
+             * \retval RTP_INITIALIZED       If the reactor has already been started
+             * \retval RTP_NOT_SUPPORTED     If the platform does not support the reactor
+             * \retval RTP_GENERIC_ERROR     If starting the reactor threads failed
+             */
+            rtp_error_t start_reactor(size_t threads);
+
             /**
              * \brief Create a new RTP session
              *
@@ -87,6 +113,9 @@ namespace uvgrtp {
 
             /* CNAME is the same for all connections */
             std::string cname_;
+
+            /* Reactor shared by the media streams, nullptr if it has not been started */
+            uvgrtp::reactor *reactor_;
         };
 };
 
@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <memory>
 #include <string>
+#include <vector>
 
 
 #ifndef _WIN32
@@ -17,6 +18,7 @@ namespace uvgrtp {
     // forward declarations
     class rtp;
     class rtcp;
+    struct bundle;
 
     class zrtp;
     class base_srtp;
@@ -24,8 +26,11 @@ namespace uvgrtp {
     class srtcp;
 
     class pkt_dispatcher;
+    class frame_pool;
     class holepuncher;
+    class multicast;
     class socket;
+    class reactor;
 
     namespace frame {
         struct rtp_frame;
@@ -38,8 +43,10 @@ namespace uvgrtp {
     class media_stream {
         public:
             /// \cond DO_NOT_DOCUMENT
-            media_stream(std::string addr, int src_port, int dst_port, rtp_format_t fmt, int flags);
-            media_stream(std::string remote_addr, std::string local_addr, int src_port, int dst_port, rtp_format_t fmt, int flags);
+            media_stream(std::string addr, int src_port, int dst_port, rtp_format_t fmt, int flags,
+                         uvgrtp::reactor *reactor = nullptr);
+            media_stream(std::string remote_addr, std::string local_addr, int src_port, int dst_port, rtp_format_t fmt, int flags,
+                         uvgrtp::reactor *reactor = nullptr);
             ~media_stream();
 
             /* Initialize traditional RTP session
@@ -61,6 +68,10 @@ namespace uvgrtp {
              *
              * Other error return codes are defined in {conn,writer,reader,srtp}.hh */
             rtp_error_t init(uvgrtp::zrtp *zrtp);
+
+            /* Share the socket of "bundle" with the other media streams of the bundle, see RCE_BUNDLE
+             * Must be called before init() */
+            void set_bundle(std::shared_ptr<uvgrtp::bundle> bundle);
             /// \endcond
 
             /**
@@ -228,6 +239,9 @@ namespace uvgrtp {
              * reading more frames. Instead, it should only be used as an interface between uvgRTP and
              * the calling application where the frame hand-off happens.
              *
+             * The hook is not called concurrently: with RCC_RECV_SHARDS, the receiver threads of
+             * the shards take turns calling it
+             *
              * \param arg Optional argument that is passed to the hook when it is called, can be set to nullptr
              * \param hook Function pointer to the receive hook that uvgRTP should call
              *
@@ -274,6 +288,125 @@ namespace uvgrtp {
              */
             rtp_error_t configure_ctx(int flag, ssize_t value);
 
+            /**
+             * \brief Get the state of the send queue of the media stream
+             *
+             * \details The encoder can use this to lower its bitrate before the kernel
+             * starts dropping packets, see ::send_status_t
+             *
+             * \param status Pointer to the structure where the state is written
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK On success
+             * \retval RTP_INVALID_VALUE If status is nullptr
+             * \retval RTP_NOT_INITIALIZED If the media stream has not been initialized
+             * \retval RTP_GENERIC_ERROR If querying the socket failed
+             */
+            rtp_error_t get_send_status(send_status_t *status);
+
+            /**
+             * \brief Get the state of the receiver of the media stream
+             *
+             * \details The application can use this to tell the datagrams dropped by the kernel
+             * apart from network loss, see ::recv_status_t
+             *
+             * \param status Pointer to the structure where the state is written
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK On success
+             * \retval RTP_INVALID_VALUE If status is nullptr
+             * \retval RTP_NOT_INITIALIZED If the media stream has not been initialized
+             * \retval RTP_GENERIC_ERROR If querying the socket failed
+             */
+            rtp_error_t get_recv_status(recv_status_t *status);
+
+            /**
+             * \brief Get the state of the frame pool of the media stream
+             *
+             * \details The received frames and their payloads are allocated from a pool owned
+             * by the media stream and recycled when the application frees them with
+             * uvgrtp::frame::dealloc_frame(), see ::pool_status_t
+             *
+             * \param status Pointer to the structure where the state is written
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK On success
+             * \retval RTP_INVALID_VALUE If status is nullptr
+             * \retval RTP_NOT_INITIALIZED If the media stream has not been initialized
+             */
+            rtp_error_t get_pool_status(pool_status_t *status);
+
+            /**
+             * \brief Send the frames of the media stream also to another receiver (Linux only)
+             *
+             * \details The frame is packetized once and each packet is sent to all destinations
+             * with one batched system call. Each additional destination gets its own sequence
+             * numbers but the SSRC and the timestamps of the media stream. Destinations can be
+             * added and removed while frames are being sent. RTCP is only sent to the remote
+             * given when the media stream was created, so the other receivers get no sender
+             * reports unless the application relays the reports of that remote to them.
+             *
+             * \param addr IPv4 address of the receiver
+             * \param port Destination port of the receiver
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK On success
+             * \retval RTP_INVALID_VALUE If the receiver is already a destination
+             * \retval RTP_NOT_INITIALIZED If the media stream has not been initialized
+             * \retval RTP_NOT_SUPPORTED If SRTP is used or the platform is not Linux
+             */
+            rtp_error_t add_destination(std::string addr, uint16_t port);
+
+            /**
+             * \brief Stop sending the frames to a receiver added with add_destination()
+             *
+             * \param addr IPv4 address of the receiver
+             * \param port Destination port of the receiver
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK On success
+             * \retval RTP_INVALID_VALUE If the receiver is not a destination
+             * \retval RTP_NOT_INITIALIZED If the media stream has not been initialized
+             */
+            rtp_error_t remove_destination(std::string addr, uint16_t port);
+
+            /**
+             * \brief Send and receive the RTP packets also through a redundant network path
+             *
+             * \details Each RTP packet is sent through both paths and the receiver merges the
+             * packets of the paths, dropping the duplicates by SSRC and sequence number before
+             * frame reassembly. A packet lost on one path is thus replaced by its copy from the
+             * other path without the delay of a retransmission (cf. SMPTE ST 2022-7). Both the
+             * sender and the receiver add the redundant path.
+             *
+             * The media stream must have been created with a local address. The socket of the
+             * redundant path is bound to another local address, i.e., another interface, and uses
+             * the ports of the media stream. RTCP and ZRTP use only the primary path. The number of
+             * duplicates dropped is reported in recv_status_t::duplicate_packets. The redundant
+             * path must not be added while push_frame() is being called from another thread.
+             * SRTP is not supported because the duplicates are dropped before the packets are
+             * authenticated
+             *
+             * \param remote_addr IPv4 address of the remote on the redundant path
+             * \param local_addr IPv4 address of the local interface of the redundant path
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK On success
+             * \retval RTP_INVALID_VALUE If the media stream was created without a local address
+             * \retval RTP_INITIALIZED If the media stream already has a redundant path
+             * \retval RTP_NOT_INITIALIZED If the media stream has not been initialized
+             * \retval RTP_NOT_SUPPORTED If the remote is a multicast group or the media stream
+             * uses receive shards, RCE_SRTP, RCE_IO_URING, RCE_SHM_TRANSPORT or RCE_LOOPBACK_TRANSPORT
+             * \retval RTP_BIND_ERROR If binding to the local address failed
+             */
+            rtp_error_t add_redundant_path(std::string remote_addr, std::string local_addr);
+
             /// \cond DO_NOT_DOCUMENT
             /* Setter and getter for media-specific config that can be used f.ex with Opus */
             void  set_media_config(void *config);
@@ -304,9 +437,47 @@ namespace uvgrtp {
              * an outgoing address */
             rtp_error_t init_connection();
 
+            /* Install the transport selected with RCE_LOOPBACK_TRANSPORT or RCE_SHM_TRANSPORT
+             * to the socket. This is done after ZRTP so that the key exchange uses UDP */
+            void init_transport();
+
+            /* Limit the payload size so that the packets fit into the path MTU, see RCE_PMTU_DISCOVERY */
+            void limit_payload_size();
+
+            /* Configure a socket of the stream and bind it to "local_addr" and the source port */
+            rtp_error_t setup_socket(uvgrtp::socket *socket, std::string local_addr);
+
+            /* Join the multicast group of the remote address on "socket" and
+             * send through the interface of the local address if it was given */
+            rtp_error_t join_multicast(socket_t socket);
+
+            /* Join the multicast group on the RTCP sockets if the remote address is a group */
+            void join_rtcp_multicast();
+
+            /* Add the remote participant to RTCP and start it, on the RTP socket if RCE_RTCP_MUX is set */
+            rtp_error_t start_rtcp();
+
+            /* Send through the socket of the bundle, see RCE_BUNDLE */
+            rtp_error_t share_bundle_socket();
+
+            /* Start receiving, through the dispatcher of the bundle if the media stream is bundled */
+            rtp_error_t start_dispatcher();
+
+            /* Route the packets of the payload type or the remote SSRC of the stream to its dispatcher */
+            rtp_error_t update_route();
+
             /* Create the media object for the stream */
             rtp_error_t create_media(rtp_format_t fmt);
 
+            /* Create a media object for "fmt_" and install its handler to "dispatcher"
+             *
+             * Return nullptr if the format is not supported */
+            uvgrtp::formats::media *new_media(uvgrtp::pkt_dispatcher *dispatcher, uint32_t key);
+
+            /* Open "count" additional SO_REUSEPORT sockets on the port of the stream
+             * and start a packet dispatcher for each, see RCC_RECV_SHARDS */
+            rtp_error_t create_recv_shards(size_t count);
+
             /* free all allocated resources */
             rtp_error_t free_resources(rtp_error_t ret);
 
@@ -348,8 +519,43 @@ namespace uvgrtp {
             /* Media object associated with this media stream. */
             uvgrtp::formats::media *media_;
 
+            /* Recycled frames and payload buffers of the received frames */
+            uvgrtp::frame_pool *frame_pool_;
+
             /* Thread that keeps the holepunched connection open for unidirectional streams */
             uvgrtp::holepuncher *holepuncher_;
+
+            /* Multicast group memberships of the RTP and RTCP sockets,
+             * empty if the remote address is not a multicast group */
+            std::vector<uvgrtp::multicast *> multicast_;
+
+            /* Additional receive sockets of the stream, each with its own packet dispatcher
+             * and media object so frames from different sources are reassembled in parallel */
+            struct recv_shard {
+                uvgrtp::socket *socket;
+                uvgrtp::pkt_dispatcher *pkt_dispatcher;
+                uvgrtp::formats::media *media;
+            };
+            std::vector<recv_shard> shards_;
+
+            /* Socket of the redundant path, nullptr if there is none, see add_redundant_path() */
+            uvgrtp::socket *path_socket_;
+
+            /* Socket and receive loop shared with other media streams, nullptr if not bundled.
+             * "remote_ssrc_" is the SSRC of the remote sender set with RCC_REMOTE_SSRC, 0 if not set */
+            std::shared_ptr<uvgrtp::bundle> bundle_;
+            uint32_t remote_ssrc_;
+
+            /* Reactor of the context and the reactor thread this media stream runs on.
+             * If reactor_ is nullptr, the media stream has its own threads */
+            uvgrtp::reactor *reactor_;
+            size_t reactor_thread_;
+
+            /* Busy poll budget in microseconds, see RCC_BUSY_POLL */
+            uint32_t busy_poll_;
+
+            /* Upper limit of the receive buffer set with RCC_UDP_RCV_BUF_MAX, 0 if not set */
+            size_t rcvbuf_max_;
     };
 };
 
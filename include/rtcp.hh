@@ -9,6 +9,7 @@
 
 #include <bitset>
 #include <map>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include <functional>
@@ -18,6 +19,7 @@ namespace uvgrtp {
 
     class rtp;
     class srtcp;
+    class reactor;
 
     /// \cond DO_NOT_DOCUMENT
     enum RTCP_ROLE {
@@ -57,6 +59,12 @@ namespace uvgrtp {
         uint32_t base_seq = 0;       /* First sequence number received */
         uint32_t bad_seq = 0;        /* TODO:  */
         uint32_t cycles = 0;         /* Number of sequence cycles */
+
+        /* Number of RTP packets received with each ECN codepoint, see RCE_ECN */
+        uint32_t ect0_pkts = 0;
+        uint32_t ect1_pkts = 0;
+        uint32_t ce_pkts = 0;
+        uint32_t not_ect_pkts = 0;
     };
 
     struct rtcp_participant {
@@ -73,6 +81,7 @@ namespace uvgrtp {
         uvgrtp::frame::rtcp_receiver_report *rr_frame = nullptr;
         uvgrtp::frame::rtcp_sdes_packet     *sdes_frame = nullptr;
         uvgrtp::frame::rtcp_app_packet      *app_frame = nullptr;
+        uvgrtp::frame::rtcp_ecn_feedback    *ecn_frame = nullptr;
     };
     /// \endcond
 
@@ -88,6 +97,16 @@ namespace uvgrtp {
              * return RTP_OK on success and RTP_MEMORY_ERROR if the allocation fails */
             rtp_error_t start();
 
+            /* Start RTCP on reactor thread "thread" instead of its own thread
+             *
+             * Incoming packets are handled when the sockets become readable and
+             * the status report is generated by a reactor timer
+             *
+             * If "reactor" is nullptr, this is the same as start()
+             *
+             * return RTP_OK on success and RTP_GENERIC_ERROR if the sockets could not be added to the reactor */
+            rtp_error_t start(uvgrtp::reactor *reactor, size_t thread);
+
             /* End the RTCP session and send RTCP BYE to all participants
              *
              * return RTP_OK on success */
@@ -162,9 +181,10 @@ namespace uvgrtp {
             uvgrtp::frame::rtcp_receiver_report *get_receiver_packet(uint32_t ssrc);
             uvgrtp::frame::rtcp_sdes_packet     *get_sdes_packet(uint32_t ssrc);
             uvgrtp::frame::rtcp_app_packet      *get_app_packet(uint32_t ssrc);
+            uvgrtp::frame::rtcp_ecn_feedback    *get_ecn_feedback(uint32_t ssrc);
 
             /* Return a reference to vector that contains the sockets of all participants */
-            std::vector<uvgrtp::socket>& get_sockets();
+            std::vector<uvgrtp::socket *>& get_sockets();
 
             /* Somebody joined the multicast group the owner of this RTCP instance is part of
              * Add it to RTCP participant list so we can start listening for reports
@@ -176,6 +196,14 @@ namespace uvgrtp {
              * Return RTP_OK on success and RTP_ERROR on error */
             rtp_error_t add_participant(std::string dst_addr, uint16_t dst_port, uint16_t src_port, uint32_t clock_rate);
 
+            /* Add the remote participant of a media stream that multiplexes RTCP on its RTP socket
+             *
+             * The reports are sent to "dst_port" through "socket", which is not owned by RTCP,
+             * and the received reports are given to mux_packet_handler(), see RCE_RTCP_MUX
+             *
+             * Return RTP_OK on success and RTP_ERROR on error */
+            rtp_error_t add_participant(uvgrtp::socket *socket, std::string dst_addr, uint16_t dst_port, uint32_t clock_rate);
+
             /* Functions for updating various RTP sender statistics */
             void sender_inc_seq_cycle_count();
             void sender_inc_sent_pkts(size_t n);
@@ -282,6 +310,21 @@ namespace uvgrtp {
             rtp_error_t install_app_hook(void (*hook)(uvgrtp::frame::rtcp_app_packet *));
             rtp_error_t install_app_hook(std::function<void(std::shared_ptr<uvgrtp::frame::rtcp_app_packet>)> app_handler);
 
+            /**
+             * \brief Install an RTCP ECN feedback hook
+             *
+             * \details This function is called when an RFC 6679 ECN feedback packet is received,
+             * i.e., when the remote reports the ECN marks of the packets we have sent, see ::RCE_ECN.
+             * An increase of the CE counter tells that the network is congested
+             *
+             * \param hook Function pointer to the hook
+             *
+             * \retval RTP_OK on success
+             * \retval RTP_INVALID_VALUE If hook is nullptr
+             */
+            rtp_error_t install_ecn_hook(void (*hook)(uvgrtp::frame::rtcp_ecn_feedback *));
+            rtp_error_t install_ecn_hook(std::function<void(std::shared_ptr<uvgrtp::frame::rtcp_ecn_feedback>)> ecn_handler);
+
             /// \cond DO_NOT_DOCUMENT
             /* Update RTCP-related sender statistics */
             rtp_error_t update_sender_stats(size_t pkt_size);
@@ -291,6 +334,9 @@ namespace uvgrtp {
 
             /* Update RTCP-related sender statistics */
             static rtp_error_t send_packet_handler_vec(void *arg, uvgrtp::buf_vec& buffers);
+
+            /* Handle an RTCP packet received on the RTP socket, see RCE_RTCP_MUX */
+            static rtp_error_t mux_packet_handler(void *arg, uint8_t *packet, size_t size);
             /// \endcond
 
         private:
@@ -307,9 +353,22 @@ namespace uvgrtp {
             rtp_error_t handle_bye_packet(uint8_t* frame, size_t size);
             rtp_error_t handle_app_packet(uint8_t* frame, size_t size,
                 uvgrtp::frame::rtcp_header& header);
+            rtp_error_t handle_rtpfb_packet(uint8_t* frame, size_t size,
+                uvgrtp::frame::rtcp_header& header);
+
+            /* Send an ECN feedback packet for each participant we have received RTP packets from
+             * Return RTP_OK on success and RTP_ERROR on error */
+            rtp_error_t send_ecn_feedback();
 
             static void rtcp_runner(rtcp *rtcp);
 
+            /* RTCP runner of a multiplexed RTCP session, only sends the reports */
+            static void rtcp_mux_runner(rtcp *rtcp);
+
+            /* Reactor handlers, "arg" is the RTCP instance */
+            static void recv_handler(void *arg);
+            static void report_handler(void *arg);
+
             /* when we start the RTCP instance, we don't know what the SSRC of the remote is
              * when an RTP packet is received, we must check if we've already received a packet
              * from this sender and if not, create new entry to receiver_stats_ map */
@@ -436,18 +495,34 @@ namespace uvgrtp {
             /* Vector of sockets the RTCP runner is listening to
              *
              * The socket are also stored here (in addition to participants_ map) so they're easier
-             * to pass to poll when RTCP runner is listening to incoming packets */
-            std::vector<uvgrtp::socket> sockets_;
+             * to pass to poll when RTCP runner is listening to incoming packets.
+             * The sockets are owned by the participants */
+            std::vector<uvgrtp::socket *> sockets_;
+
+            /* RTP socket the reports are sent through if RTCP is multiplexed on the RTP port,
+             * nullptr otherwise. Owned by the media stream */
+            uvgrtp::socket *mux_socket_;
+
+            /* RTP packets may be received by multiple receive shards concurrently,
+             * see RCC_RECV_SHARDS, and multiplexed RTCP packets by the packet dispatcher */
+            std::mutex recv_mtx_;
+
+            /* Reactor RTCP is running on and the timer of status reports,
+             * nullptr and -1 if RTCP has its own thread */
+            uvgrtp::reactor *reactor_;
+            int report_timer_;
 
             void (*sender_hook_)(uvgrtp::frame::rtcp_sender_report *);
             void (*receiver_hook_)(uvgrtp::frame::rtcp_receiver_report *);
             void (*sdes_hook_)(uvgrtp::frame::rtcp_sdes_packet *);
             void (*app_hook_)(uvgrtp::frame::rtcp_app_packet *);
+            void (*ecn_hook_)(uvgrtp::frame::rtcp_ecn_feedback *);
 
             std::function<void(std::shared_ptr<uvgrtp::frame::rtcp_sender_report>)> sr_hook_f_;
             std::function<void(std::shared_ptr<uvgrtp::frame::rtcp_receiver_report>)> rr_hook_f_;
             std::function<void(std::shared_ptr<uvgrtp::frame::rtcp_sdes_packet>)> sdes_hook_f_;
             std::function<void(std::shared_ptr<uvgrtp::frame::rtcp_app_packet>)> app_hook_f_;
+            std::function<void(std::shared_ptr<uvgrtp::frame::rtcp_ecn_feedback>)> ecn_hook_f_;
     };
 };
 
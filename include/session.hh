@@ -2,8 +2,11 @@
 
 #include "util.hh"
 
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
@@ -11,12 +14,14 @@ namespace uvgrtp {
 
     class media_stream;
     class zrtp;
+    class reactor;
+    struct bundle;
 
     class session {
         public:
             /// \cond DO_NOT_DOCUMENT
-            session(std::string addr);
-            session(std::string remote_addr, std::string local_addr);
+            session(std::string addr, uvgrtp::reactor *reactor = nullptr);
+            session(std::string remote_addr, std::string local_addr, uvgrtp::reactor *reactor = nullptr);
             ~session();
             /// \endcond
 
@@ -81,9 +86,15 @@ namespace uvgrtp {
             /* If user so wishes, the session can be bound to a certain interface */
             std::string laddr_;
 
+            /* Reactor of the context, nullptr if the media streams have their own threads */
+            uvgrtp::reactor *reactor_;
+
             /* All media streams of this session */
             std::unordered_map<uint32_t, uvgrtp::media_stream *> streams_;
 
+            /* Sockets shared by the media streams created with RCE_BUNDLE, by source and destination port */
+            std::map<std::pair<int, int>, std::weak_ptr<uvgrtp::bundle>> bundles_;
+
             std::mutex session_mtx_;
     };
 };
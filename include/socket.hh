@@ -9,9 +9,17 @@
 #else
 #include <netinet/ip.h>
 #include <arpa/inet.h>
+#include <sys/socket.h>
 #include <sys/uio.h>
 #endif
 
+#if defined(__linux__) && !defined(MSG_ZEROCOPY)
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -24,6 +32,17 @@ namespace uvgrtp {
 
     const int MAX_BUFFER_COUNT = 256;
 
+    /* How many RTP packets are merged into one UDP GSO buffer at most
+     * and how large can the merged buffer be, see RCE_UDP_GSO */
+    const size_t MAX_GSO_SEGMENTS = 64;
+    const size_t MAX_GSO_SIZE     = 0xffff - IPV4_HDR_SIZE - UDP_HDR_SIZE;
+
+    /* How long (milliseconds) a send waits for the kernel to accept the packets before the
+     * rest of the frame is dropped, and how long (microseconds) it sleeps between the attempts
+     * if the device queue is full */
+    const int SEND_RETRY_TIMEOUT  = 100;
+    const int SEND_RETRY_INTERVAL = 500;
+
     /* Vector of buffers that contain a full RTP frame */
     typedef std::vector<std::pair<size_t, uint8_t *>> buf_vec;
 
@@ -32,16 +51,51 @@ namespace uvgrtp {
 
     typedef rtp_error_t (*packet_handler_vec)(void *, buf_vec&);
 
+    class pacer;
+    class pmtu;
+    class transport;
+    class uring;
+    class xdp;
+    struct zerocopy_state;
+
     struct socket_packet_handler {
         void *arg = nullptr;
         packet_handler_vec handler = nullptr;
     };
 
+    /* ECN codepoints of the type of service byte (RFC 3168) */
+    enum ECN_CODEPOINTS {
+        ECN_NOT_ECT = 0,
+        ECN_ECT1    = 1,
+        ECN_ECT0    = 2,
+        ECN_CE      = 3
+    };
+
+    /* Packet classes of vector-based sends, see socket::set_priority_dscp() */
+    enum PACKET_CLASSES {
+        PKT_CLASS_NORMAL   = 0,
+        PKT_CLASS_PRIORITY = 1  /* e.g., parameter sets and intra NAL units */
+    };
+
+    /* Additional destination of vector-based sends, see socket::add_destination()
+     *
+     * Each destination has its own sequence numbers that are written to a copy of the RTP
+     * header of each packet. The SSRC and the timestamps are those of the media stream so
+     * that its RTCP sender reports map the RTP time of every destination to wallclock time */
+    struct fanout_destination {
+        sockaddr_in addr;
+        uint16_t seq = 0;
+    };
+
     class socket {
         public:
             socket(int flags);
             ~socket();
 
+            /* The socket owns its descriptor and backends so it cannot be copied */
+            socket(const socket&) = delete;
+            socket& operator=(const socket&) = delete;
+
             /* Create socket using "family", "type" and "protocol"
              *
              * NOTE: Only family AF_INET (ie. IPv4) is supported
@@ -50,6 +104,13 @@ namespace uvgrtp {
              * return RTP_SOCKET_ERROR if creating the socket failed */
             rtp_error_t init(short family, int type, int protocol);
 
+            /* Send through the UDP socket of "owner" instead of creating one, see RCE_BUNDLE
+             *
+             * The send handlers, the default address and the send statistics are this socket's own
+             * but socket options, e.g., DSCP and ECN, apply to the shared socket. The shared socket
+             * is not closed when this socket is destroyed so "owner" must outlive it */
+            void share(uvgrtp::socket *owner);
+
             /* Same as bind(2), assigns an address for the underlying socket object
              *
              * Return RTP_OK on success
@@ -79,6 +140,9 @@ namespace uvgrtp {
             rtp_error_t sendto(pkt_vec& buffers, int flags);
             rtp_error_t sendto(pkt_vec& buffers, int flags, int *bytes_sent);
 
+            /* Same as sendto() but each packet is marked according to its class in "classes", see set_priority_dscp() */
+            rtp_error_t sendto(pkt_vec& buffers, std::vector<uint8_t>& classes, int flags);
+
             /* Same as sendto() but the remote address given as parameter */
             rtp_error_t sendto(sockaddr_in& addr, uint8_t *buf, size_t buf_len, int flags);
             rtp_error_t sendto(sockaddr_in& addr, uint8_t *buf, size_t buf_len, int flags, int *bytes_sent);
@@ -110,6 +174,18 @@ namespace uvgrtp {
             rtp_error_t recvfrom(uint8_t *buf, size_t buf_len, int flags, int *bytes_read);
             rtp_error_t recvfrom(uint8_t *buf, size_t buf_len, int flags);
 
+#ifdef __linux__
+            /* Same as recvmmsg(2), receives up to "vlen" messages from remote with one system call
+             *
+             * Length of each received message is written to "msg_len" field of its header
+             * Write the number of messages received to "npkts" if it's not NULL
+             *
+             * Return RTP_OK on success and write the number of messages received to "npkts"
+             * Return RTP_INTERRUPTED if there were no messages to receive and set "npkts" to 0
+             * Return RTP_GENERIC_ERROR on error and set "npkts" to -1 */
+            rtp_error_t recvmmsg(struct mmsghdr *msgs, unsigned vlen, int flags, int *npkts);
+#endif
+
             /* Create sockaddr_in object using the provided information
              * NOTE: "family" must be AF_INET */
             sockaddr_in create_sockaddr(short family, unsigned host, short port);
@@ -137,7 +213,146 @@ namespace uvgrtp {
              * "arg" is an optional parameter that can be passed to the handler when it's called */
             rtp_error_t install_handler(void *arg, packet_handler_vec handler);
 
+            /* Use io_uring for vector-based send operations and allow the packet
+             * dispatcher to receive datagrams through it, see src/uring.hh
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if io_uring is not available */
+            rtp_error_t enable_io_uring();
+
+            /* Get the io_uring backend of the socket or nullptr if it has not been enabled */
+            uvgrtp::uring *get_uring();
+
+            /* Receive the datagrams of this socket through an AF_XDP socket, see src/xdp.hh
+             *
+             * The socket must be bound before calling this. "remote" is used
+             * to select the interface if the socket is bound to INADDR_ANY
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if AF_XDP is not available */
+            rtp_error_t enable_xdp(sockaddr_in& remote);
+
+            /* Get the AF_XDP backend of the socket or nullptr if it has not been enabled */
+            uvgrtp::xdp *get_xdp();
+
+            /* Send and receive the datagrams through "transport" in addition to the UDP socket,
+             * see src/transport.hh. The socket takes the ownership of "transport"
+             *
+             * The datagrams the transport does not accept are sent through the UDP socket */
+            void set_transport(uvgrtp::transport *transport);
+
+            /* Get the transport of the socket or nullptr if only the UDP socket is used */
+            uvgrtp::transport *get_transport();
+
+            /* Stop fragmenting the datagrams and follow the path MTU to "remote", see RCE_PMTU_DISCOVERY
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if path MTU discovery is not supported */
+            rtp_error_t enable_pmtu_discovery(sockaddr_in& remote);
+
+            /* Get the path MTU discovery of the socket or nullptr if it has not been enabled */
+            uvgrtp::pmtu *get_pmtu();
+
+            /* Busy poll the device queue (SO_BUSY_POLL, SO_PREFER_BUSY_POLL) for at most
+             * "budget" microseconds when the socket is read, 0 disables busy polling
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if busy polling is not supported or not permitted */
+            rtp_error_t set_busy_poll(int budget);
+
+            /* Mark the packets sent through the socket with DSCP "dscp" (IP_TOS)
+             *
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR if setting IP_TOS failed */
+            rtp_error_t set_dscp(int dscp);
+
+            /* Mark the packets of class PKT_CLASS_PRIORITY with DSCP "dscp" instead, -1 disables
+             *
+             * The DSCP is given to each packet in a control message, which io_uring sends do not support
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if per-packet marking is not supported */
+            rtp_error_t set_priority_dscp(int dscp);
+
+            /* Have the packet classes any effect, see set_priority_dscp() */
+            bool priority_marking();
+
+            /* Mark the packets sent through the socket with ECN codepoint "ecn" (RFC 3168),
+             * e.g., ECN_ECT0, keeping the DSCP. Also asks for the TOS byte of received datagrams
+             *
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR if setting IP_TOS or IP_RECVTOS failed
+             * Return RTP_NOT_SUPPORTED if ECN is not supported */
+            rtp_error_t set_ecn(uint8_t ecn);
+
+            /* Get the state of the send queue of the socket
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "status" is nullptr
+             * Return RTP_GENERIC_ERROR if querying the socket failed */
+            rtp_error_t get_send_status(send_status_t *status);
+
+            /* Create the pacer of the socket if it does not exist yet and return it
+             *
+             * When the pacer is enabled, vector-based send operations send the packets
+             * in bursts spaced out according to the pacing rate, see RCC_PACING_RATE */
+            uvgrtp::pacer *enable_pacing();
+
+            /* Can MSG_ZEROCOPY be given to vector-based send operations, see RCE_MSG_ZEROCOPY
+             *
+             * Zero-copy is not used together with io_uring or UDP GSO, and it is disabled
+             * if the kernel reports that it had to copy the data anyway */
+            bool zerocopy_enabled();
+
+            /* Return the identifier the kernel gives to the next zero-copy send.
+             * Every identifier below it has been given to a send */
+            uint32_t zerocopy_sent();
+
+            /* Return true if the kernel has released the buffers of all zero-copy sends below "id" */
+            bool zerocopy_completed(uint32_t id);
+
+            /* Read the zero-copy completion notifications from the error queue of the socket
+             *
+             * This can be called from any thread */
+            void reap_zerocopy();
+
+            /* Wait at most "timeout" milliseconds for the zero-copy sends below "id" to complete
+             *
+             * Return RTP_OK if the sends have completed
+             * Return RTP_TIMEOUT if they did not complete in time */
+            rtp_error_t wait_zerocopy(uint32_t id, int timeout);
+
+            /* Send the packets of vector-based sends also to "addr" (Linux only)
+             *
+             * The packets are sent to all destinations with one batched sendmmsg(2) and only the
+             * RTP header is copied for each destination. The destination list is replaced atomically
+             * so destinations can be added and removed while a send is in progress.
+             * Zero-copy, UDP GSO and io_uring are not used when there are additional destinations
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "addr" is already a destination
+             * Return RTP_NOT_SUPPORTED if not supported on this platform */
+            rtp_error_t add_destination(sockaddr_in& addr);
+
+            /* Stop sending to "addr"
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "addr" is not a destination */
+            rtp_error_t remove_destination(sockaddr_in& addr);
+
+            /* Send the packets of vector-based sends to the default address also through "path",
+             * the socket of a redundant path bound to another local address. The packets are sent
+             * through "path" to its own default address after the packets of this socket,
+             * one paced burst at a time if the sends are paced.
+             * The DSCP and ECN settings of this socket are applied to "path" too
+             *
+             * The send succeeds if either path accepts the packets. "path" is not owned
+             * and the path must not be set while packets are being sent */
+            void set_redundant_path(uvgrtp::socket *path);
+
         private:
+            typedef std::vector<std::shared_ptr<uvgrtp::fanout_destination>> destination_list;
+
             /* helper function for sending UPD packets, see documentation for sendto() above */
             rtp_error_t __sendto(sockaddr_in& addr, uint8_t *buf, size_t buf_len, int flags, int *bytes_sent);
             rtp_error_t __recv(uint8_t *buf, size_t buf_len, int flags, int *bytes_read);
@@ -145,12 +360,134 @@ namespace uvgrtp {
 
             /* __sendtov() does the same as __sendto but it combines multiple buffers into one frame and sends them */
             rtp_error_t __sendtov(sockaddr_in& addr, buf_vec& buffers, int flags, int *bytes_sent);
-            rtp_error_t __sendtov(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int flags, int *bytes_sent);
+
+            /* "classes" is nullptr or holds the packet class of each packet of "buffers", see PACKET_CLASSES */
+            rtp_error_t __sendtov(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int flags, int *bytes_sent,
+                                  const uint8_t *classes);
+
+            /* __sendtov_paced() sends "buffers" using __sendtov() in bursts allowed by the pacer
+             *
+             * If "path" is not nullptr, each burst is also sent through the socket of the redundant
+             * path to its default address right after this socket, so both paths are paced by the
+             * pacer of this socket. The send succeeds if either path accepts all of its bursts */
+            rtp_error_t __sendtov_paced(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int flags, int *bytes_sent,
+                                        const uint8_t *classes, uvgrtp::socket *path);
+
+            /* Send "buffers" through the redundant path, if there is one. "ret" is the result of the
+             * send through this socket and the result of the whole send is returned */
+            rtp_error_t send_redundant(rtp_error_t ret, uvgrtp::buf_vec& buffers, int flags);
+
+#ifdef __linux__
+            /* __sendtov_gso() merges consecutive packets of the same size into one buffer and
+             * lets the kernel segment it into datagrams (UDP_SEGMENT).
+             *
+             * If the segmentation fails, GSO is disabled for the socket and the unsent packets
+             * are sent using __sendtov() */
+            rtp_error_t __sendtov_gso(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int flags, int *bytes_sent,
+                                      const uint8_t *classes);
+
+            /* If sendmmsg(2) failed with "error" because the kernel could not accept more packets,
+             * wait for space and return true. Return false if the send should not be retried,
+             * either because of the error or because the send started at "start" has waited too long */
+            bool wait_send_space(int error, std::chrono::steady_clock::time_point start);
+
+            /* sendmmsg(2) that keeps count of the zero-copy sends */
+            int zc_sendmmsg(struct mmsghdr *headers, unsigned count, int flags);
+
+            /* Send "nmsgs" messages, resuming after partial sends and waiting for send space
+             *
+             * If "msgs_sent" is not nullptr, the number of messages sent is written to it.
+             * On failure, the messages after them were not sent */
+            rtp_error_t __sendmmsg(struct mmsghdr *headers, size_t nmsgs, int flags, size_t *msgs_sent = nullptr);
+
+            /* __sendtov_fanout() sends each packet to "addr" and to all "dests" */
+            rtp_error_t __sendtov_fanout(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int flags,
+                                         int *bytes_sent, const uint8_t *classes, const destination_list& dests);
+
+            /* Append an IP_TOS control message with the DSCP of PKT_CLASS_PRIORITY to "hdr"
+             *
+             * "buf" is used as the control buffer if "hdr" does not have one yet */
+            void add_priority_cmsg(struct msghdr *hdr, char *buf);
+#endif
 
             socket_t socket_;
             sockaddr_in addr_;
             int flags_;
 
+            /* Is UDP GSO supported and enabled for this socket */
+            bool gso_;
+
+            /* The underlying socket belongs to another socket object, see share() */
+            bool shared_;
+
+            /* io_uring backend, nullptr if not enabled */
+            uvgrtp::uring *uring_;
+
+            /* AF_XDP receive backend, nullptr if not enabled */
+            uvgrtp::xdp *xdp_;
+
+            /* Transport used instead of the UDP socket, nullptr if not set */
+            uvgrtp::transport *transport_;
+
+            /* Path MTU discovery, nullptr if not enabled. Told about the datagrams rejected with EMSGSIZE */
+            uvgrtp::pmtu *pmtu_;
+
+            /* Type of service byte of the packets of the socket and of the PKT_CLASS_PRIORITY
+             * packets, -1 if the priority packets are not marked differently. The ECN field
+             * (the lowest two bits) is the same for both */
+            int tos_;
+            int priority_tos_;
+
+            /* Send pacer, nullptr if pacing has not been configured */
+            uvgrtp::pacer *pacer_;
+
+            /* The current burst and the packet sizes of the frame being paced */
+            uvgrtp::pkt_vec paced_;
+            std::vector<size_t> paced_sizes_;
+
+#ifdef __linux__
+            /* Control messages carrying the segment size of one merged UDP GSO buffer and its DSCP */
+            union gso_cmsg {
+                char buf[CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(int))];
+                struct cmsghdr align;
+            };
+
+            /* Control message carrying the DSCP of one PKT_CLASS_PRIORITY packet */
+            union tos_cmsg {
+                char buf[CMSG_SPACE(sizeof(int))];
+                struct cmsghdr align;
+            };
+
+            /* sendmmsg(2) descriptors reused by all vector-based sends */
+            std::vector<struct mmsghdr> send_headers_;
+            std::vector<struct iovec> send_chunks_;
+            std::vector<gso_cmsg> gso_cmsgs_;
+            std::vector<size_t> gso_first_pkt_;
+            std::vector<tos_cmsg> tos_cmsgs_;
+
+            /* RTP headers of the additional destinations, one per packet and destination */
+            std::vector<uint8_t> fanout_headers_;
+#endif
+
+            /* Additional destinations, see add_destination(). Copied on write and accessed
+             * with std::atomic_load()/std::atomic_compare_exchange_weak() */
+            std::shared_ptr<const destination_list> dests_;
+
+            /* Zero-copy completion tracking, nullptr if SO_ZEROCOPY has not been enabled */
+            uvgrtp::zerocopy_state *zc_;
+
+            /* Socket of the redundant path, see set_redundant_path() */
+            uvgrtp::socket *redundant_;
+
+            /* Backpressure statistics, see get_send_status(). They are written
+             * by the sending thread and read by the application */
+            struct send_counters {
+                std::atomic<bool> would_block{ false };
+                std::atomic<uint64_t> blocked_sends{ 0 };
+                std::atomic<uint64_t> dropped_packets{ 0 };
+            };
+            send_counters counters_;
+
             /* __sendto() calls these handlers in order before sending the packet */
             std::vector<socket_packet_handler> buf_handlers_;
 
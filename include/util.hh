@@ -226,7 +226,122 @@ enum RTP_CTX_ENABLE_FLAGS {
     /** Use 256-bit keys with SRTP */
     RCE_SRTP_KEYSIZE_256          = 1 << 16,
 
-    RCE_LAST                      = 1 << 17,
+    /** Use UDP Generic Segmentation Offload (Linux only)
+     *
+     * If this flag is given, consecutive RTP packets of the same size
+     * (such as the fragmentation units of a large H26X frame) are merged
+     * into one buffer and the kernel splits that buffer into datagrams.
+     *
+     * If GSO is not supported by the operating system or the outgoing
+     * route, uvgRTP falls back to sending each packet separately */
+    RCE_UDP_GSO                   = 1 << 17,
+
+    /** Use UDP Generic Receive Offload (Linux only)
+     *
+     * If this flag is given, the kernel may coalesce consecutive datagrams
+     * of the same flow into one buffer. uvgRTP splits the buffer back into
+     * RTP packets before processing them, so the only visible difference is
+     * that a whole burst of packets can be received with one system call */
+    RCE_UDP_GRO                   = 1 << 18,
+
+    /** Use io_uring for sending and receiving RTP packets (Linux only)
+     *
+     * All packets of a frame are submitted to the kernel with one system call
+     * and received datagrams are written directly to registered receive buffers
+     * so the receiver does not need to poll the socket.
+     *
+     * If io_uring is not supported by the kernel, regular system calls are used.
+     * Not supported with redundant paths, see uvgrtp::media_stream::add_redundant_path() */
+    RCE_IO_URING                  = 1 << 19,
+
+    /** Receive RTP packets through an AF_XDP socket (Linux only)
+     *
+     * An XDP program steers the datagrams destined to the port of the media stream
+     * into shared memory, bypassing the network stack. The program is attached to the
+     * interface of the local address or, if no local address was given, to the interface
+     * used to reach the remote. Driver mode is used if supported, otherwise generic mode.
+     *
+     * Only one media stream per interface can use AF_XDP. Requires CAP_NET_ADMIN and
+     * CAP_BPF. If AF_XDP cannot be used, packets are received through the regular socket */
+    RCE_AF_XDP                    = 1 << 20,
+
+    /** Allow the receiver to be sharded across multiple sockets (Linux only)
+     *
+     * The socket of the media stream is bound with SO_REUSEPORT so that
+     * additional receive sockets can be opened with RCC_RECV_SHARDS */
+    RCE_RECV_SHARDS               = 1 << 21,
+
+    /** Send large frames with MSG_ZEROCOPY (Linux only)
+     *
+     * The kernel sends the frame directly from the memory of the application. Only frames
+     * whose memory uvgRTP owns (frames pushed as std::unique_ptr) are sent this way,
+     * their memory is released only when the kernel has completed the send.
+     * Zero-copy is disabled automatically if the kernel reports that it had to copy the data
+     * anyway, e.g., on loopback. Not used with SRTP, RCE_IO_URING or RCE_UDP_GSO */
+    RCE_MSG_ZEROCOPY              = 1 << 22,
+
+    /** Grow the receive buffer of the socket automatically
+     *
+     * The buffer is grown, up to RCC_UDP_RCV_BUF_MAX, based on the observed bitrate, the size
+     * of the bursts read from the socket and the datagrams dropped by the kernel. Beyond
+     * net.core.rmem_max, the buffer can be grown only if the process has CAP_NET_ADMIN */
+    RCE_ADAPTIVE_RCVBUF           = 1 << 23,
+
+    /** Exchange RTP packets with media streams of the same host through shared memory (Linux only)
+     *
+     * Both media streams must use this flag. The packets are written to a ring buffer
+     * shared by the two processes instead of the UDP socket. Packets larger than
+     * 2044 bytes and packets to other hosts are sent through the UDP socket */
+    RCE_SHM_TRANSPORT             = 1 << 24,
+
+    /** Exchange RTP packets with media streams of the same process in memory
+     *
+     * The packets sent to the UDP port of a media stream that also uses this flag are
+     * copied to its receive queue without going through the kernel, which is useful
+     * for benchmarking packetization, frame reassembly and SRTP. Packets to other ports,
+     * RTCP and ZRTP are sent through the UDP socket. Takes precedence over RCE_SHM_TRANSPORT */
+    RCE_LOOPBACK_TRANSPORT        = 1 << 25,
+
+    /** Follow the path MTU to the remote address and packetize the frames to fit it (Linux only)
+     *
+     * The datagrams are sent with the Don't Fragment bit set and the payload size is lowered
+     * when the kernel learns a smaller path MTU, e.g., over a tunnel, and raised again when it
+     * forgets it. RCC_MTU_SIZE remains the upper limit. The packets of the frame during which
+     * the path MTU shrinks may be lost. See also send_status_t::path_mtu */
+    RCE_PMTU_DISCOVERY            = 1 << 26,
+
+    /** Send the RTP packets ECN-capable and report the ECN marks received back with RTCP (Linux only)
+     *
+     * The packets are marked ECT(0), or ECT(1) with RCC_ECN_ECT1. The receiver counts
+     * the ECN codepoints of the RTP packets of each SSRC and, if RCE_RTCP is enabled,
+     * sends them in an RFC 6679 ECN feedback packet after each report so that the
+     * sender learns of congestion from CE marks before packets are lost. See
+     * uvgrtp::rtcp::install_ecn_hook() */
+    RCE_ECN                       = 1 << 27,
+
+    /** Send and receive RTCP on the RTP port instead of the next port (RFC 5761)
+     *
+     * Used together with RCE_RTCP. Only one socket is needed per media stream and the
+     * RTCP packets are told apart from RTP by their packet type, so both ends must use
+     * this flag and RTP payload types 64 - 95 must not be used. Not supported with
+     * multicast or receive shards */
+    RCE_RTCP_MUX                  = 1 << 28,
+
+    /** Share one socket and receive loop with the other media streams of the session
+     * created with this flag on the same ports (RFC 8843)
+     *
+     * The received packets are given to the media stream of their remote SSRC, set with
+     * RCC_REMOTE_SSRC, or otherwise of their payload type, which must then be unique within
+     * the bundle, see RCC_DYN_PAYLOAD_TYPE. Bundled media streams of the same payload type,
+     * e.g., two H.265 streams, must set RCC_REMOTE_SSRC: a stream whose payload type is already
+     * routed to another stream receives nothing until it is set. RTCP is multiplexed on the same port (RCE_RTCP_MUX).
+     * Socket options are those of the first media stream of the bundle. Use a reactor to run
+     * many bundled media streams on a few threads, see uvgrtp::context::start_reactor().
+     * Not supported with multicast, SRTP with ZRTP, RCE_RECV_SHARDS, RCE_AF_XDP, RCE_IO_URING,
+     * RCE_MSG_ZEROCOPY, RCE_PMTU_DISCOVERY, the in-process transports or redundant paths */
+    RCE_BUNDLE                    = 1 << 29,
+
+    RCE_LAST                      = 1 << 30,
 };
 
 /**
@@ -277,6 +392,93 @@ enum RTP_CTX_CONFIGURATION_FLAGS {
      * to use jumbo frames, it can set the MTU size to 9000 bytes */
     RCC_MTU_SIZE         = 5,
 
+    /** Number of receive shards, requires RCE_RECV_SHARDS
+     *
+     * Default is 1 and maximum is 64. Each shard is a SO_REUSEPORT socket on the port of the media
+     * stream with its own receiver thread and frame reassembly. Incoming packets are
+     * steered to the shards by SSRC so all packets of a source go to the same shard
+     * and multiple sources can be received in parallel.
+     *
+     * The frames of all shards are returned through the media stream. The receive hook is
+     * called from the receiver threads of the shards but never concurrently, so a slow hook
+     * stalls all shards. Can be set only once and not together with SRTP or AF_XDP */
+    RCC_RECV_SHARDS      = 6,
+
+    /** Minimum pacing rate of the sender in kbit/s
+     *
+     * Default is 0, i.e., no pacing. When pacing is enabled, the packets of a frame
+     * are not sent in one burst but spread over time so that at most RCC_PACING_BURST
+     * bytes are sent back-to-back. Pacing blocks push_frame() until the whole frame
+     * has been sent. See also RCC_PACING_FRACTION */
+    RCC_PACING_RATE      = 7,
+
+    /** How many bytes the pacer may send back-to-back
+     *
+     * Default is 15000 bytes. At least one packet is always sent at a time */
+    RCC_PACING_BURST     = 8,
+
+    /** Spread each frame over this percentage (1 - 100) of the frame interval
+     *
+     * Default is 0, i.e., not used. The frame interval is estimated from the times the frames
+     * are pushed and the pacing rate of a frame is raised above RCC_PACING_RATE if needed to send
+     * the frame in time. Setting this enables pacing even if RCC_PACING_RATE has not been set */
+    RCC_PACING_FRACTION  = 9,
+
+    /** Busy poll budget of the receiver in microseconds (Linux only)
+     *
+     * Default is 0, i.e., no busy polling. When a datagram has been received, the receiver thread
+     * keeps polling the socket without blocking until no datagram has arrived for this long and
+     * only then goes back to waiting. The socket is also configured with SO_BUSY_POLL and
+     * SO_PREFER_BUSY_POLL so that the kernel polls the device queue directly, which requires
+     * CAP_NET_ADMIN if the budget exceeds net.core.busy_read.
+     *
+     * Busy polling lowers the receive latency at the cost of one fully used CPU core per stream.
+     * It is not used if the stream runs on the reactor or receives with RCE_IO_URING */
+    RCC_BUSY_POLL        = 10,
+
+    /** Upper limit of the receive buffer size in bytes when RCE_ADAPTIVE_RCVBUF is used
+     *
+     * Default value is 64 MB */
+    RCC_UDP_RCV_BUF_MAX  = 11,
+
+    /** Time-to-live of the RTP and RTCP packets sent to a multicast group (0 - 255)
+     *
+     * Default is 1, i.e., the packets do not leave the local network. A media stream
+     * is a member of a multicast group if the remote address of the session is
+     * a multicast address, the local address of the session selects the interface */
+    RCC_MULTICAST_TTL    = 12,
+
+    /** Are the packets sent to a multicast group looped back to the local host (0 or 1)
+     *
+     * Default is 1 so that receivers on the same host get the packets */
+    RCC_MULTICAST_LOOP   = 13,
+
+    /** DSCP of the RTP packets (0 - 63), e.g., 46 for EF or 34 for AF41
+     *
+     * Default is 0. The DSCP is set with IP_TOS, from which Linux also derives
+     * the socket priority (SO_PRIORITY). Windows may ignore it */
+    RCC_DSCP             = 14,
+
+    /** DSCP of the RTP packets carrying H.26x parameter sets and intra pictures (0 - 63, Linux only)
+     *
+     * Default is -1, i.e., the same as RCC_DSCP. The network can then protect the
+     * packets the decoder cannot do without. Aggregation packets get the DSCP if one of
+     * their NAL units needs it. Not applied to the packets sent with RCE_IO_URING */
+    RCC_DSCP_INTRA       = 15,
+
+    /** Mark the packets ECT(1) instead of ECT(0) with RCE_ECN (0 or 1)
+     *
+     * Default is 0. ECT(1) identifies L4S traffic (RFC 9331) */
+    RCC_ECN_ECT1         = 16,
+
+    /** SSRC of the remote sender of a media stream created with RCE_BUNDLE
+     *
+     * Default is 0, i.e., the packets are given to the media stream by their payload type.
+     * Must be set to bundle several media streams of the same payload type. Setting this or
+     * RCC_DYN_PAYLOAD_TYPE fails with RTP_INITIALIZED if the stream would be routed by
+     * a payload type that another stream of the bundle already uses */
+    RCC_REMOTE_SSRC      = 17,
+
     RCC_LAST
 };
 
@@ -293,6 +495,76 @@ typedef struct rtp_ctx_conf {
     ssize_t ctx_values[RCC_LAST];
 } rtp_ctx_conf_t;
 
+/**
+ * \brief State of the send queue of a media stream, see uvgrtp::media_stream::get_send_status()
+ *
+ * \details If "queued_bytes" approaches "buffer_size" or "would_block" is set, the kernel
+ * is not keeping up with the sender and the application should lower its bitrate
+ */
+typedef struct send_status {
+    /** Bytes in the socket send queue that have not been sent yet (SIOCOUTQ, Linux only) */
+    size_t queued_bytes = 0;
+
+    /** Size of the socket send buffer (SO_SNDBUF) */
+    size_t buffer_size = 0;
+
+    /** True if the latest send had to wait for the kernel to accept the packets */
+    bool would_block = false;
+
+    /** How many times a send has had to wait for the kernel to accept the packets */
+    uint64_t blocked_sends = 0;
+
+    /** How many packets were dropped because the kernel did not accept them */
+    uint64_t dropped_packets = 0;
+
+    /** Path MTU to the remote address (IP packet size), 0 if RCE_PMTU_DISCOVERY is not used */
+    size_t path_mtu = 0;
+} send_status_t;
+
+/**
+ * \brief State of the receiver of a media stream, see uvgrtp::media_stream::get_recv_status()
+ *
+ * \details Datagrams dropped by the kernel are not visible to RTCP as such, they appear as
+ * network loss. If "kernel_drops" grows, the receive buffer is too small or the receiver
+ * cannot keep up, see RCC_UDP_RCV_BUF_SIZE and RCE_ADAPTIVE_RCVBUF
+ */
+typedef struct recv_status {
+    /** Datagrams dropped by the kernel on the sockets of the media stream, e.g., because the
+     * receive buffer was full (SO_RXQ_OVFL, Linux only). Updated only when datagrams are received */
+    uint64_t kernel_drops = 0;
+
+    /** Size of the socket receive buffer (SO_RCVBUF) */
+    size_t buffer_size = 0;
+
+    /** RTP packets dropped because they had already been received through the
+     * other path, see uvgrtp::media_stream::add_redundant_path() */
+    uint64_t duplicate_packets = 0;
+} recv_status_t;
+
+/**
+ * \brief State of the frame pool of a media stream
+ *
+ * \details The received frames and their payloads are taken from a pool of the media stream
+ * and returned to it by uvgrtp::frame::dealloc_frame(). If "allocated" keeps growing while
+ * "reused" does not, the application holds on to the frames for long
+ */
+typedef struct pool_status {
+    /** Frames and payload buffers taken from the pool without allocating memory */
+    uint64_t reused = 0;
+
+    /** Frames and payload buffers the pool had to allocate */
+    uint64_t allocated = 0;
+
+    /** Payload buffers larger than the largest size class of the pool, allocated and freed each time */
+    uint64_t oversized = 0;
+
+    /** Frames given to the media stream or the application and not yet deallocated */
+    size_t frames_in_use = 0;
+
+    /** Memory kept in the pool for reuse, in bytes */
+    size_t cached_bytes = 0;
+} pool_status_t;
+
 extern thread_local rtp_error_t rtp_errno;
 
 #define TIME_DIFF(s, e, u) ((ssize_t)std::chrono::duration_cast<std::chrono::u>(e - s).count())
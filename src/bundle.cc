@@ -0,0 +1,14 @@
+#include "bundle.hh"
+
+#include "pkt_dispatch.hh"
+#include "socket.hh"
+
+uvgrtp::bundle::~bundle()
+{
+    if (dispatcher) {
+        dispatcher->stop();
+        delete dispatcher;
+    }
+
+    delete socket;
+}
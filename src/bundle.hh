@@ -0,0 +1,27 @@
+#pragma once
+
+#include "util.hh"
+
+namespace uvgrtp {
+
+    class socket;
+    class pkt_dispatcher;
+
+    /* UDP socket and receive loop shared by the media streams of a session that are created
+     * with RCE_BUNDLE on the same ports
+     *
+     * The dispatcher of the bundle routes the received datagrams to the dispatchers of
+     * the media streams, see uvgrtp::pkt_dispatcher::set_route(). The bundle is destroyed
+     * together with the last of its media streams */
+    struct bundle {
+        ~bundle();
+
+        /* Socket the media streams send through, created by the first media stream of the bundle */
+        uvgrtp::socket *socket = nullptr;
+
+        /* Dispatcher receiving from "socket", started by the first media stream of the bundle */
+        uvgrtp::pkt_dispatcher *dispatcher = nullptr;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -52,6 +52,11 @@ uint64_t uvgrtp::clock::ntp::diff_now(uint64_t then)
     return ntp_diff_ms(then, now);
 }
 
+uint64_t uvgrtp::clock::ntp::from_unix(uint64_t sec, uint64_t nsec)
+{
+    return ((sec + EPOCH) << 32) | ((nsec * NTP_SCALE_FRAC) / 1000000000ULL);
+}
+
 uvgrtp::clock::hrc::hrc_t uvgrtp::clock::hrc::now()
 {
     return std::chrono::high_resolution_clock::now();
@@ -0,0 +1,108 @@
+#include "dedup.hh"
+
+#include "debug.hh"
+
+/* One bit for each 16-bit sequence number */
+static const size_t DEDUP_WORDS = (1 << 16) / 64;
+
+uvgrtp::dedup_filter::dedup_filter():
+    checked_(0),
+    last_expiry_(std::chrono::steady_clock::now()),
+    duplicates_(0)
+{
+}
+
+uvgrtp::dedup_filter::~dedup_filter()
+{
+}
+
+void uvgrtp::dedup_filter::advance(seq_window& window, uint16_t seq)
+{
+    uint16_t count = seq - window.max_seq;
+    uint16_t pos   = window.max_seq + 1;
+
+    /* clear whole words at a time after the first partial word */
+    while (count) {
+        if (!(pos & 63) && count >= 64) {
+            window.bits[pos >> 6] = 0;
+            pos   += 64;
+            count -= 64;
+        } else {
+            window.bits[pos >> 6] &= ~(1ULL << (pos & 63));
+            ++pos;
+            --count;
+        }
+    }
+
+    window.max_seq = seq;
+}
+
+void uvgrtp::dedup_filter::expire()
+{
+    for (auto it = windows_.begin(); it != windows_.end(); ) {
+        if (!it->second.seen) {
+            it = windows_.erase(it);
+        } else {
+            it->second.seen = false;
+            ++it;
+        }
+    }
+
+    last_expiry_ = std::chrono::steady_clock::now();
+}
+
+bool uvgrtp::dedup_filter::is_duplicate(uint32_t ssrc, uint16_t seq)
+{
+    auto timeout = std::chrono::seconds(DEDUP_SSRC_TIMEOUT);
+
+    /* the clock is read only now and then, the SSRCs that have been silent
+     * for a whole expiry interval are forgotten */
+    if (!(++checked_ % DEDUP_EXPIRY_CHECK) && std::chrono::steady_clock::now() - last_expiry_ >= timeout)
+        expire();
+
+    auto it = windows_.find(ssrc);
+
+    if (it == windows_.end()) {
+        /* a full table is expired only as often as usual so that a flood of new SSRCs
+         * does not make the active ones look silent */
+        if (windows_.size() >= DEDUP_MAX_SSRCS && std::chrono::steady_clock::now() - last_expiry_ >= timeout)
+            expire();
+
+        if (windows_.size() >= DEDUP_MAX_SSRCS) {
+            LOG_DEBUG("Too many SSRCs on the redundant paths, not tracking SSRC 0x%x", ssrc);
+            return false;
+        }
+
+        seq_window& window = windows_[ssrc];
+
+        window.bits.assign(DEDUP_WORDS, 0);
+        window.max_seq = seq;
+        window.bits[seq >> 6] |= 1ULL << (seq & 63);
+        return false;
+    }
+
+    seq_window& window = it->second;
+    uint16_t ahead     = seq - window.max_seq;
+
+    window.seen = true;
+
+    /* a packet newer than anything received so far cannot be a duplicate */
+    if (ahead && ahead < DEDUP_WINDOW)
+        advance(window, seq);
+
+    uint64_t& word = window.bits[seq >> 6];
+    uint64_t  mask = 1ULL << (seq & 63);
+
+    if (word & mask) {
+        ++duplicates_;
+        return true;
+    }
+
+    word |= mask;
+    return false;
+}
+
+uint64_t uvgrtp::dedup_filter::get_duplicates()
+{
+    return duplicates_;
+}
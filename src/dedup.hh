@@ -0,0 +1,67 @@
+#pragma once
+
+#include "util.hh"
+
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+namespace uvgrtp {
+
+    /* How far behind the highest received sequence number (in packets) a packet can arrive
+     * and still be recognized as a duplicate. Half of the sequence number space so that
+     * a path can lag the other by up to 32767 packets */
+    const uint16_t DEDUP_WINDOW = 0x8000;
+
+    /* How many SSRCs are tracked at most, each takes 8 KB, and for how long, in seconds, an SSRC
+     * can be silent before it is forgotten. The clock is read once per DEDUP_EXPIRY_CHECK packets,
+     * so a silent SSRC is forgotten after one to two timeouts */
+    const size_t DEDUP_MAX_SSRCS     = 256;
+    const int    DEDUP_SSRC_TIMEOUT  = 30;
+    const size_t DEDUP_EXPIRY_CHECK  = 1024;
+
+    /* Drops the RTP packets that have already been received through another path
+     *
+     * Each SSRC has a bitmap with one bit per sequence number. The bits ahead of the highest
+     * sequence number received are cleared as the sequence number advances, so a lookup is
+     * a single bit test. See uvgrtp::media_stream::add_redundant_path() */
+    class dedup_filter {
+        public:
+            dedup_filter();
+            ~dedup_filter();
+
+            /* Record the packet "seq" of "ssrc" as received
+             *
+             * Return true if the packet has been received before. The packets of an SSRC
+             * that does not fit in the table are never reported as duplicates */
+            bool is_duplicate(uint32_t ssrc, uint16_t seq);
+
+            /* Return the number of duplicate packets found, may be called from any thread */
+            uint64_t get_duplicates();
+
+        private:
+            /* "seen" is cleared by expire() and set again when a packet of the SSRC arrives */
+            struct seq_window {
+                uint16_t max_seq = 0;
+                bool seen = true;
+                std::vector<uint64_t> bits;
+            };
+
+            /* Clear the bits of the sequence numbers after "window.max_seq" up to and including "seq" */
+            void advance(seq_window& window, uint16_t seq);
+
+            /* Forget the SSRCs that have not sent anything since the previous call */
+            void expire();
+
+            std::unordered_map<uint32_t, seq_window> windows_;
+
+            /* Packets checked and the time of the previous expiry, see expire() */
+            size_t checked_;
+            std::chrono::steady_clock::time_point last_expiry_;
+
+            std::atomic<uint64_t> duplicates_;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -1,5 +1,6 @@
 #include "h264.hh"
 
+#include "../frame_pool.hh"
 #include "../queue.hh"
 #include "../rtp.hh"
 #include "debug.hh"
@@ -61,13 +62,14 @@ static rtp_error_t __handle_stap_a(uvgrtp::formats::h264_frame_info_t* finfo, uv
     }
 
     for (size_t i = 0; i < nalus.size(); ++i) {
-        auto retframe = uvgrtp::frame::alloc_rtp_frame(nalus[i].first);
+        auto retframe = uvgrtp::frame::alloc_pooled_frame(frame->pool, nalus[i].first);
 
         std::memcpy(
             retframe->payload,
             nalus[i].second,
             nalus[i].first
         );
+        retframe->arrival = frame->arrival;
 
         finfo->queued.push_back(retframe);
     }
@@ -86,9 +88,11 @@ static inline uint8_t __get_nal(uvgrtp::frame::rtp_frame* frame)
     return uvgrtp::formats::NT_OTHER;
 }
 
-static inline bool __frame_late(uvgrtp::formats::h264_info_t& hinfo)
+static inline bool __frame_late(uvgrtp::formats::h264_info_t& hinfo, uint64_t arrival)
 {
-    return (uvgrtp::clock::hrc::diff_now(hinfo.sframe_time) >= RTP_FRAME_MAX_DELAY);
+    /* the age of the frame is measured at the arrival of its latest fragment */
+    return arrival > hinfo.sframe_time &&
+        uvgrtp::clock::ntp::diff(hinfo.sframe_time, arrival) >= RTP_FRAME_MAX_DELAY;
 }
 
 static void __drop_frame(uvgrtp::formats::h264_frame_info_t* finfo, uint32_t ts)
@@ -191,6 +195,12 @@ uint8_t uvgrtp::formats::h264::get_nal_type(uint8_t* data)
     return data[0] & 0x1f;
 }
 
+bool uvgrtp::formats::h264::is_priority_nal(uint8_t nal_type)
+{
+    /* 5 = IDR slice, 7 = SPS, 8 = PPS */
+    return nal_type == 5 || nal_type == 7 || nal_type == 8;
+}
+
 rtp_error_t uvgrtp::formats::h264::handle_small_packet(uint8_t* data, size_t data_len, bool more)
 {
     rtp_error_t ret = RTP_OK;
@@ -326,7 +336,7 @@ rtp_error_t uvgrtp::formats::h264::packet_handler(void* arg, int flags, uvgrtp::
         if (frag_type == FT_START) finfo->frames[c_ts].s_seq = c_seq;
         if (frag_type == FT_END)   finfo->frames[c_ts].e_seq = c_seq;
 
-        finfo->frames[c_ts].sframe_time = uvgrtp::clock::hrc::now();
+        finfo->frames[c_ts].sframe_time = frame->arrival;
         finfo->frames[c_ts].total_size = frame->payload_len - AVC_HDR_SIZE;
         finfo->frames[c_ts].pkts_received = 1;
 
@@ -398,12 +408,13 @@ rtp_error_t uvgrtp::formats::h264::packet_handler(void* arg, int flags, uvgrtp::
                 return RTP_OK;
             }
 
-            uvgrtp::frame::rtp_frame* complete = uvgrtp::frame::alloc_rtp_frame();
+            uvgrtp::frame::rtp_frame* complete = uvgrtp::frame::alloc_pooled_frame(frame->pool, 0);
 
             complete->payload_len = finfo->frames[c_ts].total_size + uvgrtp::frame::HEADER_SIZE_H264_NAL;
-            complete->payload = new uint8_t[complete->payload_len];
+            complete->payload = uvgrtp::frame::alloc_payload(complete, complete->payload_len, complete->payload_class);
 
             std::memcpy(&complete->header, &(*out)->header, RTP_HDR_SIZE);
+            complete->arrival = finfo->frames[c_ts].sframe_time;
             complete->payload[0] = (frame->payload[0] & 0xe0) | (frame->payload[1] & 0x1f);
 
             fptr += uvgrtp::frame::HEADER_SIZE_H264_NAL;
@@ -427,7 +438,7 @@ rtp_error_t uvgrtp::formats::h264::packet_handler(void* arg, int flags, uvgrtp::
         }
     }
 
-    if (__frame_late(finfo->frames.at(c_ts))) {
+    if (__frame_late(finfo->frames.at(c_ts), frame->arrival)) {
         if (nal_type != NT_INTRA || (nal_type == NT_INTRA && !enable_idelay)) {
             __drop_frame(finfo, c_ts);
             finfo->dropped.insert(c_ts);
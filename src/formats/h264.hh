@@ -36,8 +36,8 @@ namespace uvgrtp {
         };
 
         typedef struct h264_info {
-            /* clock reading when the first fragment is received */
-            uvgrtp::clock::hrc::hrc_t sframe_time;
+            /* arrival time (NTP) of the first fragment */
+            uint64_t sframe_time = 0;
 
             /* sequence number of the frame with s-bit */
             uint32_t s_seq = 0;
@@ -105,6 +105,9 @@ namespace uvgrtp {
                 // get h264 nal type
                 virtual uint8_t get_nal_type(uint8_t* data);
 
+                // IDR pictures, SPS and PPS
+                virtual bool is_priority_nal(uint8_t nal_type);
+
                 // the aggregation packet is not enabled
                 virtual rtp_error_t handle_small_packet(uint8_t* data, size_t data_len, bool more);
                 
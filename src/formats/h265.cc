@@ -1,6 +1,7 @@
 #include "h265.hh"
 
 #include "../srtp/srtcp.hh"
+#include "../frame_pool.hh"
 #include "../rtp.hh"
 #include "../queue.hh"
 #include "debug.hh"
@@ -53,9 +54,11 @@ static inline uint8_t __get_nal(uvgrtp::frame::rtp_frame* frame)
     return uvgrtp::formats::NT_OTHER;
 }
 
-static inline bool __frame_late(uvgrtp::formats::h265_info_t& hinfo, size_t max_delay)
+static inline bool __frame_late(uvgrtp::formats::h265_info_t& hinfo, uint64_t arrival, size_t max_delay)
 {
-    return (uvgrtp::clock::hrc::diff_now(hinfo.sframe_time) >= max_delay);
+    /* the age of the frame is measured at the arrival of its latest fragment */
+    return arrival > hinfo.sframe_time &&
+        uvgrtp::clock::ntp::diff(hinfo.sframe_time, arrival) >= max_delay;
 }
 
 static void __drop_frame(uvgrtp::formats::h265_frame_info_t* finfo, uint32_t ts)
@@ -91,13 +94,14 @@ static rtp_error_t __handle_ap(uvgrtp::formats::h265_frame_info_t* finfo, uvgrtp
     }
 
     for (size_t i = 0; i < nalus.size(); ++i) {
-        auto retframe = uvgrtp::frame::alloc_rtp_frame(nalus[i].first);
+        auto retframe = uvgrtp::frame::alloc_pooled_frame(frame->pool, nalus[i].first);
 
         std::memcpy(
             retframe->payload,
             nalus[i].second,
             nalus[i].first
         );
+        retframe->arrival = frame->arrival;
 
         finfo->queued.push_back(retframe);
     }
@@ -189,6 +193,12 @@ uint8_t uvgrtp::formats::h265::get_nal_type(uint8_t* data)
     return (data[0] >> 1) & 0x3f;
 }
 
+bool uvgrtp::formats::h265::is_priority_nal(uint8_t nal_type)
+{
+    /* 16 - 23 = IRAP (BLA, IDR, CRA), 32 = VPS, 33 = SPS, 34 = PPS */
+    return (nal_type >= 16 && nal_type <= 23) || (nal_type >= 32 && nal_type <= 34);
+}
+
 uvgrtp::formats::h265_frame_info_t *uvgrtp::formats::h265::get_h265_frame_info()
 {
     return &finfo_;
@@ -324,7 +334,7 @@ rtp_error_t uvgrtp::formats::h265::packet_handler(void* arg, int flags, uvgrtp::
         if (frag_type == FT_START) finfo->frames[c_ts].s_seq = c_seq;
         if (frag_type == FT_END)   finfo->frames[c_ts].e_seq = c_seq;
 
-        finfo->frames[c_ts].sframe_time = uvgrtp::clock::hrc::now();
+        finfo->frames[c_ts].sframe_time = frame->arrival;
         finfo->frames[c_ts].total_size = frame->payload_len - H265_HDR_SIZE;
         finfo->frames[c_ts].pkts_received = 1;
 
@@ -401,14 +411,14 @@ rtp_error_t uvgrtp::formats::h265::packet_handler(void* arg, int flags, uvgrtp::
                 (uint8_t)frame->payload[1]
             };
 
-            uvgrtp::frame::rtp_frame* complete = uvgrtp::frame::alloc_rtp_frame();
+            uvgrtp::frame::rtp_frame* complete = uvgrtp::frame::alloc_pooled_frame(frame->pool, 0);
 
             complete->payload_len =
                 finfo->frames[c_ts].total_size
                 + uvgrtp::frame::HEADER_SIZE_H265_NAL +
                 +((flags & RCE_H26X_PREPEND_SC) ? 4 : 0);
 
-            complete->payload = new uint8_t[complete->payload_len];
+            complete->payload = uvgrtp::frame::alloc_payload(complete, complete->payload_len, complete->payload_class);
 
             if (flags & RCE_H26X_PREPEND_SC) {
                 complete->payload[0] = 0;
@@ -419,6 +429,7 @@ rtp_error_t uvgrtp::formats::h265::packet_handler(void* arg, int flags, uvgrtp::
             }
 
             std::memcpy(&complete->header, &(*out)->header, RTP_HDR_SIZE);
+            complete->arrival = finfo->frames[c_ts].sframe_time;
             std::memcpy(&complete->payload[fptr], nal_header, NAL_HDR_SIZE);
 
             fptr += uvgrtp::frame::HEADER_SIZE_H265_NAL;
@@ -442,7 +453,7 @@ rtp_error_t uvgrtp::formats::h265::packet_handler(void* arg, int flags, uvgrtp::
         }
     }
 
-    if (__frame_late(finfo->frames.at(c_ts), finfo->rtp_ctx->get_pkt_max_delay())) {
+    if (__frame_late(finfo->frames.at(c_ts), frame->arrival, finfo->rtp_ctx->get_pkt_max_delay())) {
         if (nal_type != NT_INTRA || (nal_type == NT_INTRA && !enable_idelay)) {
             __drop_frame(finfo, c_ts);
             finfo->dropped.insert(c_ts);
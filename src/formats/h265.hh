@@ -37,8 +37,8 @@ namespace uvgrtp {
         };
 
         typedef struct h265_info {
-            /* clock reading when the first fragment is received */
-            uvgrtp::clock::hrc::hrc_t sframe_time;
+            /* arrival time (NTP) of the first fragment */
+            uint64_t sframe_time = 0;
 
             /* sequence number of the frame with s-bit */
             uint32_t s_seq = 0;
@@ -107,6 +107,9 @@ namespace uvgrtp {
                 // get H265 nal type
                 virtual uint8_t get_nal_type(uint8_t* data);
 
+                // IRAP pictures, VPS, SPS and PPS
+                virtual bool is_priority_nal(uint8_t nal_type);
+
                 /* Construct an aggregation packet from data in "aggr_pkt_info_" */
                 virtual rtp_error_t make_aggregation_pkt();
 
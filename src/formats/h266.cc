@@ -1,5 +1,6 @@
 #include "h266.hh"
 
+#include "../frame_pool.hh"
 #include "../rtp.hh"
 #include "../queue.hh"
 #include "frame.hh"
@@ -51,9 +52,11 @@ static inline uint8_t __get_nal(uvgrtp::frame::rtp_frame* frame)
     return uvgrtp::formats::NT_OTHER;
 }
 
-static inline bool __frame_late(uvgrtp::formats::h266_info_t& hinfo, size_t max_delay)
+static inline bool __frame_late(uvgrtp::formats::h266_info_t& hinfo, uint64_t arrival, size_t max_delay)
 {
-    return (uvgrtp::clock::hrc::diff_now(hinfo.sframe_time) >= max_delay);
+    /* the age of the frame is measured at the arrival of its latest fragment */
+    return arrival > hinfo.sframe_time &&
+        uvgrtp::clock::ntp::diff(hinfo.sframe_time, arrival) >= max_delay;
 }
 
 static void __drop_frame(uvgrtp::formats::h266_frame_info_t* finfo, uint32_t ts)
@@ -85,6 +88,12 @@ uint8_t uvgrtp::formats::h266::get_nal_type(uint8_t* data)
     return (data[1] >> 3) & 0x1f;
 }
 
+bool uvgrtp::formats::h266::is_priority_nal(uint8_t nal_type)
+{
+    /* 7 - 11 = IRAP and GDR, 12 - 18 = OPI, DCI, VPS, SPS, PPS and APS */
+    return nal_type >= 7 && nal_type <= 18;
+}
+
 uvgrtp::formats::h266_frame_info_t *uvgrtp::formats::h266::get_h266_frame_info()
 {
     return &finfo_;
@@ -195,7 +204,7 @@ rtp_error_t uvgrtp::formats::h266::packet_handler(void* arg, int flags, uvgrtp::
         if (frag_type == FT_START) finfo->frames[c_ts].s_seq = c_seq;
         if (frag_type == FT_END)   finfo->frames[c_ts].e_seq = c_seq;
 
-        finfo->frames[c_ts].sframe_time = uvgrtp::clock::hrc::now();
+        finfo->frames[c_ts].sframe_time = frame->arrival;
         finfo->frames[c_ts].total_size = frame->payload_len - H266_HDR_SIZE;
         finfo->frames[c_ts].pkts_received = 1;
 
@@ -272,14 +281,14 @@ rtp_error_t uvgrtp::formats::h266::packet_handler(void* arg, int flags, uvgrtp::
                 (uint8_t)frame->payload[1]
             };
 
-            uvgrtp::frame::rtp_frame* complete = uvgrtp::frame::alloc_rtp_frame();
+            uvgrtp::frame::rtp_frame* complete = uvgrtp::frame::alloc_pooled_frame(frame->pool, 0);
 
             complete->payload_len =
                 finfo->frames[c_ts].total_size
                 + uvgrtp::frame::HEADER_SIZE_H266_NAL +
                 +((flags & RCE_H26X_PREPEND_SC) ? 4 : 0);
 
-            complete->payload = new uint8_t[complete->payload_len];
+            complete->payload = uvgrtp::frame::alloc_payload(complete, complete->payload_len, complete->payload_class);
 
             if (flags & RCE_H26X_PREPEND_SC) {
                 complete->payload[0] = 0;
@@ -290,6 +299,7 @@ rtp_error_t uvgrtp::formats::h266::packet_handler(void* arg, int flags, uvgrtp::
             }
 
             std::memcpy(&complete->header, &(*out)->header, RTP_HDR_SIZE);
+            complete->arrival = finfo->frames[c_ts].sframe_time;
             std::memcpy(&complete->payload[fptr], nal_header, NAL_HDR_SIZE);
 
             fptr += uvgrtp::frame::HEADER_SIZE_H266_NAL;
@@ -313,7 +323,7 @@ rtp_error_t uvgrtp::formats::h266::packet_handler(void* arg, int flags, uvgrtp::
         }
     }
 
-    if (__frame_late(finfo->frames.at(c_ts), finfo->rtp_ctx->get_pkt_max_delay())) {
+    if (__frame_late(finfo->frames.at(c_ts), frame->arrival, finfo->rtp_ctx->get_pkt_max_delay())) {
         if (nal_type != NT_INTRA || (nal_type == NT_INTRA && !enable_idelay)) {
             __drop_frame(finfo, c_ts);
             finfo->dropped.insert(c_ts);
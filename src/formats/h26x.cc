@@ -1,11 +1,13 @@
 #include "h26x.hh"
 
+#include "../frame_pool.hh"
 #include "../rtp.hh"
 #include "../queue.hh"
 #include "socket.hh"
 #include "debug.hh"
 
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
@@ -75,7 +77,8 @@ static inline unsigned __find_h26x_start(uint32_t value)
 }
 
 uvgrtp::formats::h26x::h26x(uvgrtp::socket* socket, uvgrtp::rtp* rtp, int flags) :
-    media(socket, rtp, flags)
+    media(socket, rtp, flags),
+    aggr_class_(PKT_CLASS_NORMAL)
 {
 }
 
@@ -260,6 +263,8 @@ rtp_error_t uvgrtp::formats::h26x::push_h26x_frame(uint8_t *data, size_t data_le
         if (data_len > payload_size) {
             return push_nal_unit(data + r_off, data_len, false);
         } else {
+            fqueue_->set_packet_class(get_packet_class(data + r_off));
+
             if ((ret = fqueue_->enqueue_message(data + r_off, data_len - r_off)) != RTP_OK) {
                 LOG_ERROR("Failed to enqueue Single h26x NAL Unit packet!");
                 return ret;
@@ -301,17 +306,26 @@ rtp_error_t uvgrtp::formats::h26x::push_nal_unit(uint8_t *data, size_t data_len,
     rtp_error_t ret = RTP_OK;
 
     size_t payload_size = rtp_ctx_->get_payload_size();
+    uint8_t nal_class   = get_packet_class(data);
 
     if (data_len - 3 <= payload_size) {
+        /* an aggregation packet is marked with the highest class of its NAL units */
+        aggr_class_ = std::max(aggr_class_, nal_class);
+        fqueue_->set_packet_class(aggr_class_);
+
         if ((ret = handle_small_packet(data, data_len, more)) != RTP_OK)
             return ret;
     }
     else {
         /* If smaller NALUs were queued before this NALU,
          * send them in an aggregation packet before proceeding with fragmentation */
+        fqueue_->set_packet_class(aggr_class_);
         (void)make_aggregation_pkt();
     }
 
+    aggr_class_ = PKT_CLASS_NORMAL;
+    fqueue_->set_packet_class(nal_class);
+
     size_t data_left = data_len;
     size_t data_pos = 0;
 
@@ -354,9 +368,15 @@ rtp_error_t uvgrtp::formats::h26x::push_media_frame(uint8_t *data, size_t data_l
         return ret;
     }
 
+    aggr_class_ = PKT_CLASS_NORMAL;
     return push_h26x_frame(data, data_len, flags);
 }
 
+uint8_t uvgrtp::formats::h26x::get_packet_class(uint8_t* data)
+{
+    return is_priority_nal(get_nal_type(data)) ? PKT_CLASS_PRIORITY : PKT_CLASS_NORMAL;
+}
+
 
 rtp_error_t uvgrtp::formats::h26x::make_aggregation_pkt()
 {
@@ -408,7 +428,8 @@ void uvgrtp::formats::h26x::initialize_fu_headers(uint8_t nal_type, uint8_t fu_h
 void uvgrtp::formats::h26x::prepend_start_code(int flags, uvgrtp::frame::rtp_frame** out)
 {
     if (flags & RCE_H26X_PREPEND_SC) {
-        uint8_t* pl = new uint8_t[(*out)->payload_len + 4];
+        int old_class = (*out)->payload_class;
+        uint8_t* pl   = uvgrtp::frame::alloc_payload(*out, (*out)->payload_len + 4, (*out)->payload_class);
 
         pl[0] = 0;
         pl[1] = 0;
@@ -416,7 +437,7 @@ void uvgrtp::formats::h26x::prepend_start_code(int flags, uvgrtp::frame::rtp_fra
         pl[3] = 1;
 
         std::memcpy(pl + 4, (*out)->payload, (*out)->payload_len);
-        delete[](*out)->payload;
+        uvgrtp::frame::free_payload((*out)->pool, (*out)->payload, old_class);
 
         (*out)->payload = pl;
         (*out)->payload_len += 4;
@@ -66,6 +66,10 @@ namespace uvgrtp {
                 /* Gets the format specific nal type from data*/
                 virtual uint8_t get_nal_type(uint8_t* data) = 0;
 
+                /* Return true if NAL units of type "nal_type" are needed for decoding
+                 * the following pictures, i.e., parameter sets and intra (IRAP) pictures */
+                virtual bool is_priority_nal(uint8_t nal_type) = 0;
+
                 /* Handles small packets. May support aggregate packets or not*/
                 virtual rtp_error_t handle_small_packet(uint8_t* data, size_t data_len, bool more) = 0;
 
@@ -90,6 +94,12 @@ namespace uvgrtp {
         private:
             // constructs and sends the RTP packets with format specific stuff
             rtp_error_t push_nal_unit(uint8_t* data, size_t data_len, bool more);
+
+            /* Return the packet class of the NAL unit starting at "data", see RCC_DSCP_INTRA */
+            uint8_t get_packet_class(uint8_t* data);
+
+            /* Highest packet class of the NAL units waiting for an aggregation packet */
+            uint8_t aggr_class_;
         };
     };
 };
@@ -1,5 +1,6 @@
 #include "media.hh"
 
+#include "../frame_pool.hh"
 #include "../rtp.hh"
 #include "socket.hh"
 #include "../queue.hh"
@@ -35,7 +36,16 @@ rtp_error_t uvgrtp::formats::media::push_frame(std::unique_ptr<uint8_t[]> data,
     if (!data || !data_len)
         return RTP_INVALID_VALUE;
 
-    return push_media_frame(data.get(), data_len, flags);
+    /* the frame queue takes the ownership of the frame when the transaction is initialized */
+    uint8_t *ptr = data.get();
+    fqueue_->stage_frame(std::move(data));
+
+    rtp_error_t ret = push_media_frame(ptr, data_len, flags);
+
+    /* release the frame if push_media_frame() failed before initializing the transaction */
+    fqueue_->stage_frame(nullptr);
+
+    return ret;
 }
 
 rtp_error_t uvgrtp::formats::media::push_media_frame(uint8_t *data, size_t data_len, int flags)
@@ -128,10 +138,11 @@ rtp_error_t uvgrtp::formats::media::packet_handler(void *arg, int flags, uvgrtp:
                 recv = minfo->frames[ts].e_seq - minfo->frames[ts].s_seq + 1;
 
             if (recv == minfo->frames[ts].npkts) {
-                auto retframe = uvgrtp::frame::alloc_rtp_frame(minfo->frames[ts].size);
+                auto retframe = uvgrtp::frame::alloc_pooled_frame(frame->pool, minfo->frames[ts].size);
                 size_t ptr    = 0;
 
                 std::memcpy(&retframe->header, &frame->header, sizeof(frame->header));
+                retframe->arrival = minfo->frames[ts].fragments.begin()->second->arrival;
 
                 for (auto& frag : minfo->frames[ts].fragments) {
                     std::memcpy(
@@ -1,5 +1,7 @@
 #include "frame.hh"
 
+#include "frame_pool.hh"
+
 #include "util.hh"
 #include "debug.hh"
 
@@ -13,8 +15,9 @@ uvgrtp::frame::rtp_frame *uvgrtp::frame::alloc_rtp_frame()
     std::memset(&frame->header, 0, sizeof(uvgrtp::frame::rtp_header));
     std::memset(frame,          0, sizeof(uvgrtp::frame::rtp_frame));
 
-    frame->payload   = nullptr;
-    frame->probation = nullptr;
+    frame->payload       = nullptr;
+    frame->probation     = nullptr;
+    frame->payload_class = -1;
 
     return frame;
 }
@@ -64,11 +67,15 @@ rtp_error_t uvgrtp::frame::dealloc_frame(uvgrtp::frame::rtp_frame *frame)
         delete[] frame->probation;
 
     else if (frame->payload)
-        delete[] frame->payload;
+        uvgrtp::frame::free_payload(frame->pool, frame->payload, frame->payload_class);
 
     //LOG_DEBUG("Deallocating frame, type %u", frame->type);
 
-    delete frame;
+    if (frame->pool)
+        frame->pool->free_frame(frame);
+    else
+        delete frame;
+
     return RTP_OK;
 }
 
@@ -0,0 +1,178 @@
+#include "frame_pool.hh"
+
+uvgrtp::frame_pool::frame_pool():
+    frames_in_use_(0),
+    released_(false),
+    reused_(0),
+    allocated_(0),
+    oversized_(0)
+{
+}
+
+uvgrtp::frame_pool::~frame_pool()
+{
+    for (auto& frame : frames_)
+        delete frame;
+
+    for (auto& buffers : buffers_) {
+        for (auto& buffer : buffers)
+            delete[] buffer;
+    }
+}
+
+uvgrtp::frame::rtp_frame *uvgrtp::frame_pool::alloc_frame()
+{
+    uvgrtp::frame::rtp_frame *frame = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        ++frames_in_use_;
+
+        if (!frames_.empty()) {
+            frame = frames_.back();
+            frames_.pop_back();
+            ++reused_;
+        } else {
+            ++allocated_;
+        }
+    }
+
+    if (!frame)
+        frame = new uvgrtp::frame::rtp_frame;
+
+    *frame      = uvgrtp::frame::rtp_frame();
+    frame->pool = this;
+
+    return frame;
+}
+
+void uvgrtp::frame_pool::free_frame(uvgrtp::frame::rtp_frame *frame)
+{
+    bool destroy = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        if (frames_.size() < POOL_MAX_FRAMES) {
+            frames_.push_back(frame);
+            frame = nullptr;
+        }
+
+        destroy = (--frames_in_use_ == 0) && released_;
+    }
+
+    delete frame;
+
+    if (destroy)
+        delete this;
+}
+
+uint8_t *uvgrtp::frame_pool::alloc_buffer(size_t len, int& size_class)
+{
+    size_t i = 0;
+
+    while (i < POOL_CLASSES && POOL_CLASS_SIZES[i] < len)
+        ++i;
+
+    if (i == POOL_CLASSES) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ++oversized_;
+
+        size_class = -1;
+        return new uint8_t[len];
+    }
+
+    size_class = (int)i;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        if (!buffers_[i].empty()) {
+            uint8_t *buffer = buffers_[i].back();
+            buffers_[i].pop_back();
+            ++reused_;
+            return buffer;
+        }
+
+        ++allocated_;
+    }
+
+    return new uint8_t[POOL_CLASS_SIZES[i]];
+}
+
+void uvgrtp::frame_pool::free_buffer(uint8_t *buffer, int size_class)
+{
+    if (size_class >= 0) {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        if (buffers_[size_class].size() < POOL_CLASS_LIMITS[size_class]) {
+            buffers_[size_class].push_back(buffer);
+            return;
+        }
+    }
+
+    delete[] buffer;
+}
+
+void uvgrtp::frame_pool::release()
+{
+    bool destroy = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        released_ = true;
+        destroy   = frames_in_use_ == 0;
+    }
+
+    if (destroy)
+        delete this;
+}
+
+void uvgrtp::frame_pool::get_status(pool_status_t *status)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    status->reused        = reused_;
+    status->allocated     = allocated_;
+    status->oversized     = oversized_;
+    status->frames_in_use = frames_in_use_;
+    status->cached_bytes  = frames_.size() * sizeof(uvgrtp::frame::rtp_frame);
+
+    for (size_t i = 0; i < POOL_CLASSES; ++i)
+        status->cached_bytes += buffers_[i].size() * POOL_CLASS_SIZES[i];
+}
+
+uvgrtp::frame::rtp_frame *uvgrtp::frame::alloc_pooled_frame(uvgrtp::frame_pool *pool, size_t payload_len)
+{
+    if (!pool)
+        return payload_len ? uvgrtp::frame::alloc_rtp_frame(payload_len) : uvgrtp::frame::alloc_rtp_frame();
+
+    uvgrtp::frame::rtp_frame *frame = pool->alloc_frame();
+
+    if (payload_len) {
+        frame->payload     = pool->alloc_buffer(payload_len, frame->payload_class);
+        frame->payload_len = payload_len;
+    }
+
+    return frame;
+}
+
+uint8_t *uvgrtp::frame::alloc_payload(uvgrtp::frame::rtp_frame *frame, size_t len, int& size_class)
+{
+    if (!frame->pool) {
+        size_class = -1;
+        return new uint8_t[len];
+    }
+
+    return frame->pool->alloc_buffer(len, size_class);
+}
+
+void uvgrtp::frame::free_payload(uvgrtp::frame_pool *pool, uint8_t *payload, int size_class)
+{
+    if (pool)
+        pool->free_buffer(payload, size_class);
+    else
+        delete[] payload;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "frame.hh"
+#include "util.hh"
+
+#include <mutex>
+#include <vector>
+
+namespace uvgrtp {
+
+    /* Payload buffer size classes of the frame pool: the payload of an RTP packet, the payload
+     * of a maximum-sized datagram and a reassembled frame. Larger payloads are allocated with new */
+    const size_t POOL_CLASSES = 3;
+    const size_t POOL_CLASS_SIZES[POOL_CLASSES]  = { 2048, 65536, 1 << 20 };
+
+    /* How many free buffers of each class and free frames the pool keeps for reuse at most,
+     * the rest are deleted when they are returned */
+    const size_t POOL_CLASS_LIMITS[POOL_CLASSES] = { 2048, 64, 8 };
+    const size_t POOL_MAX_FRAMES                 = 4096;
+
+    /* Recycles the rtp_frame structs and payload buffers of the received frames of a media stream
+     *
+     * The frames are allocated by the packet dispatchers of the media stream and returned by
+     * uvgrtp::frame::dealloc_frame() from whichever thread the user calls it. The pool outlives
+     * the media stream until the user has returned all of its frames, see release() */
+    class frame_pool {
+        public:
+            frame_pool();
+
+            /* Return a frame whose fields have their default values, as with alloc_rtp_frame() */
+            uvgrtp::frame::rtp_frame *alloc_frame();
+
+            /* Return "frame" to the pool. Its payload, CSRCs and extension must have been freed */
+            void free_frame(uvgrtp::frame::rtp_frame *frame);
+
+            /* Return a buffer of at least "len" bytes and its size class,
+             * -1 if the buffer is larger than the classes and was allocated with new */
+            uint8_t *alloc_buffer(size_t len, int& size_class);
+
+            /* Return a buffer allocated with alloc_buffer() to the pool */
+            void free_buffer(uint8_t *buffer, int size_class);
+
+            /* Called by the owner when it does not allocate anything anymore,
+             * the pool deletes itself when the last frame has been returned */
+            void release();
+
+            void get_status(pool_status_t *status);
+
+        private:
+            ~frame_pool();
+
+            std::mutex mtx_;
+
+            std::vector<uvgrtp::frame::rtp_frame *> frames_;
+            std::vector<uint8_t *> buffers_[POOL_CLASSES];
+
+            /* Frames given out and not yet returned */
+            size_t frames_in_use_;
+            bool released_;
+
+            uint64_t reused_;
+            uint64_t allocated_;
+            uint64_t oversized_;
+    };
+
+    namespace frame {
+        /* Allocate a frame and, if "payload_len" is not 0, its payload from "pool".
+         * If "pool" is nullptr, this is the same as alloc_rtp_frame() */
+        rtp_frame *alloc_pooled_frame(uvgrtp::frame_pool *pool, size_t payload_len);
+
+        /* Return a buffer of "len" bytes for the payload of "frame" from the pool of the frame,
+         * if it has one, and set "size_class" to the class of the buffer. The payload of
+         * the frame is not changed */
+        uint8_t *alloc_payload(rtp_frame *frame, size_t len, int& size_class);
+
+        /* Free a payload buffer allocated with alloc_payload() for a frame of "pool" */
+        void free_payload(uvgrtp::frame_pool *pool, uint8_t *payload, int size_class);
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -1,6 +1,7 @@
 #include "holepuncher.hh"
 
 #include "clock.hh"
+#include "reactor.hh"
 #include "socket.hh"
 #include "debug.hh"
 
@@ -9,6 +10,8 @@
 
 uvgrtp::holepuncher::holepuncher(uvgrtp::socket *socket):
     socket_(socket),
+    reactor_(nullptr),
+    timer_(-1),
     last_dgram_sent_(0)
 {
 }
@@ -24,8 +27,26 @@ rtp_error_t uvgrtp::holepuncher::start()
     return uvgrtp::runner::start();
 }
 
+rtp_error_t uvgrtp::holepuncher::start(uvgrtp::reactor *reactor, size_t thread)
+{
+    if (!reactor)
+        return start();
+
+    if (reactor->add_timer(thread, 500, this, tick_handler, &timer_) != RTP_OK)
+        return RTP_GENERIC_ERROR;
+
+    reactor_ = reactor;
+    return uvgrtp::runner::start();
+}
+
 rtp_error_t uvgrtp::holepuncher::stop()
 {
+    if (reactor_) {
+        (void)reactor_->remove_source(timer_);
+        reactor_ = nullptr;
+        timer_   = -1;
+    }
+
     return uvgrtp::runner::stop(); 
 }
 
@@ -42,8 +63,21 @@ void uvgrtp::holepuncher::keepalive()
             continue;
         }
 
-        uint8_t payload = 0x00;
-        socket_->sendto(&payload, 1, 0);
-        last_dgram_sent_ = uvgrtp::clock::ntp::now();
+        tick();
     }
 }
+
+void uvgrtp::holepuncher::tick()
+{
+    if (uvgrtp::clock::ntp::diff_now(last_dgram_sent_) < THRESHOLD)
+        return;
+
+    uint8_t payload = 0x00;
+    socket_->sendto(&payload, 1, 0);
+    last_dgram_sent_ = uvgrtp::clock::ntp::now();
+}
+
+void uvgrtp::holepuncher::tick_handler(void *arg)
+{
+    ((uvgrtp::holepuncher *)arg)->tick();
+}
@@ -8,6 +8,7 @@
 namespace uvgrtp {
 
     class socket;
+    class reactor;
 
     class holepuncher : public runner {
         public:
@@ -20,6 +21,14 @@ namespace uvgrtp {
              * Return RTP_MEMORY_ERROR if allocation fails */
             rtp_error_t start();
 
+            /* Start the holepuncher on reactor thread "thread" instead of its own thread
+             *
+             * If "reactor" is nullptr, this is the same as start()
+             *
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR if the keepalive timer could not be added to the reactor */
+            rtp_error_t start(uvgrtp::reactor *reactor, size_t thread);
+
             /* Stop the holepuncher */
             rtp_error_t stop();
 
@@ -30,7 +39,14 @@ namespace uvgrtp {
         private:
             void keepalive();
 
+            /* Send keepalive datagram if nothing has been sent recently */
+            void tick();
+
+            static void tick_handler(void *arg);
+
             uvgrtp::socket *socket_;
+            uvgrtp::reactor *reactor_;
+            int timer_;
             std::atomic<uint64_t> last_dgram_sent_;
     };
 };
@@ -3,6 +3,7 @@
 #include "debug.hh"
 #include "hostname.hh"
 #include "random.hh"
+#include "reactor.hh"
 #include "session.hh"
 
 #include <cstdlib>
@@ -11,7 +12,8 @@
 
 thread_local rtp_error_t rtp_errno;
 
-uvgrtp::context::context()
+uvgrtp::context::context():
+    reactor_(nullptr)
 {
     cname_  = uvgrtp::context::generate_cname();
 
@@ -28,6 +30,8 @@ uvgrtp::context::context()
 
 uvgrtp::context::~context()
 {
+    delete reactor_;
+
 #ifdef _WIN32
     WSACleanup();
 #endif
@@ -38,7 +42,7 @@ uvgrtp::session *uvgrtp::context::create_session(std::string address)
     if (address == "")
         return nullptr;
 
-    return new uvgrtp::session(address);
+    return new uvgrtp::session(address, reactor_);
 }
 
 uvgrtp::session *uvgrtp::context::create_session(std::string remote_addr, std::string local_addr)
@@ -46,7 +50,24 @@ uvgrtp::session *uvgrtp::context::create_session(std::string remote_addr, std::s
     if (remote_addr == "" || local_addr == "")
         return nullptr;
 
-    return new uvgrtp::session(remote_addr, local_addr);
+    return new uvgrtp::session(remote_addr, local_addr, reactor_);
+}
+
+rtp_error_t uvgrtp::context::start_reactor(size_t threads)
+{
+    rtp_error_t ret;
+
+    if (reactor_)
+        return RTP_INITIALIZED;
+
+    reactor_ = new uvgrtp::reactor();
+
+    if ((ret = reactor_->start(threads)) != RTP_OK) {
+        delete reactor_;
+        reactor_ = nullptr;
+    }
+
+    return ret;
 }
 
 rtp_error_t uvgrtp::context::destroy_session(uvgrtp::session *session)
@@ -0,0 +1,244 @@
+#include "loopback.hh"
+
+#include "debug.hh"
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+/* Datagrams sent to one loopback transport, shared by its senders */
+struct uvgrtp::loopback_queue {
+    std::mutex mtx;
+    std::vector<uint8_t> data;
+    std::vector<size_t> lengths;
+
+    /* the receiver has found the queue empty and waits for "event_fd" */
+    bool sleeping = false;
+    int event_fd  = -1;
+
+    ~loopback_queue()
+    {
+#ifdef __linux__
+        if (event_fd != -1)
+            close(event_fd);
+#endif
+    }
+};
+
+/* Receive queues of the loopback transports of this process by UDP port */
+static std::mutex registry_mtx;
+static std::unordered_map<uint16_t, std::weak_ptr<uvgrtp::loopback_queue>> registry;
+
+uvgrtp::loopback::loopback():
+    port_(0),
+    peer_port_(0),
+    dropped_(0),
+    rx_next_(0),
+    rx_offset_(0),
+    armed_(false)
+{
+}
+
+uvgrtp::loopback::~loopback()
+{
+    if (!queue_)
+        return;
+
+    std::lock_guard<std::mutex> lock(registry_mtx);
+    registry.erase(port_);
+}
+
+rtp_error_t uvgrtp::loopback::init(uint16_t port)
+{
+    auto queue = std::make_shared<uvgrtp::loopback_queue>();
+
+#ifdef __linux__
+    if ((queue->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+        log_platform_error("Failed to create the loopback eventfd");
+        return RTP_GENERIC_ERROR;
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(registry_mtx);
+
+    if (!registry[port].expired()) {
+        LOG_ERROR("Port %u already has a loopback transport", port);
+        return RTP_INVALID_VALUE;
+    }
+
+    /* the dispatcher waits for the eventfd before it has read anything */
+    queue->sleeping = true;
+    armed_          = true;
+
+    registry[port] = queue;
+    queue_ = queue;
+    port_  = port;
+
+    return RTP_OK;
+}
+
+std::shared_ptr<uvgrtp::loopback_queue> uvgrtp::loopback::find_peer(uint16_t port)
+{
+    std::shared_ptr<uvgrtp::loopback_queue> peer;
+
+    if (port == peer_port_ && (peer = peer_.lock()))
+        return peer;
+
+    std::lock_guard<std::mutex> lock(registry_mtx);
+    auto it = registry.find(port);
+
+    if (it == registry.end() || !(peer = it->second.lock()))
+        return nullptr;
+
+    peer_port_ = port;
+    peer_      = peer;
+
+    return peer;
+}
+
+void uvgrtp::loopback::enqueue(uvgrtp::loopback_queue& peer, uvgrtp::buf_vec *buffers, size_t count, int *bytes_sent)
+{
+    int sent_bytes = 0;
+    bool wake      = false;
+
+    {
+        std::lock_guard<std::mutex> lock(peer.mtx);
+
+        for (size_t i = 0; i < count; ++i) {
+            size_t len = 0;
+
+            for (auto& chunk : buffers[i])
+                len += chunk.first;
+
+            sent_bytes += (int)len;
+
+            if (peer.data.size() + len > LOOPBACK_MAX_QUEUED) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            for (auto& chunk : buffers[i])
+                peer.data.insert(peer.data.end(), chunk.second, chunk.second + chunk.first);
+
+            peer.lengths.push_back(len);
+        }
+
+        if (peer.sleeping && !peer.lengths.empty()) {
+            peer.sleeping = false;
+            wake          = true;
+        }
+
+#ifdef __linux__
+        /* written under the lock so that the receiver knows the counter is set when it sees "sleeping" cleared */
+        if (wake) {
+            uint64_t one = 1;
+            (void)::write(peer.event_fd, &one, sizeof(one));
+        }
+#endif
+    }
+
+    set_bytes(bytes_sent, sent_bytes);
+}
+
+rtp_error_t uvgrtp::loopback::send(sockaddr_in& addr, uvgrtp::buf_vec& buffer, int *bytes_sent)
+{
+    auto peer = find_peer(ntohs(addr.sin_port));
+
+    if (!peer)
+        return RTP_NOT_SUPPORTED;
+
+    enqueue(*peer, &buffer, 1, bytes_sent);
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::loopback::send(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int *bytes_sent)
+{
+    auto peer = find_peer(ntohs(addr.sin_port));
+
+    if (!peer)
+        return RTP_NOT_SUPPORTED;
+
+    enqueue(*peer, buffers.data(), buffers.size(), bytes_sent);
+    return RTP_OK;
+}
+
+uint64_t uvgrtp::loopback::get_dropped()
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+int uvgrtp::loopback::get_fd()
+{
+    return queue_ ? queue_->event_fd : -1;
+}
+
+rtp_error_t uvgrtp::loopback::recv(uvgrtp::transport_datagram *dgrams, size_t count, size_t *ndgrams)
+{
+    if (!queue_)
+        return RTP_INTERRUPTED;
+
+    /* everything taken from the queue has been processed, take the datagrams queued since */
+    if (rx_next_ == rx_lengths_.size()) {
+        bool signaled = false;
+
+        rx_data_.clear();
+        rx_lengths_.clear();
+        rx_next_   = 0;
+        rx_offset_ = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(queue_->mtx);
+
+            /* the sender clears "sleeping" when it signals the eventfd */
+            signaled = armed_ && !queue_->sleeping;
+
+            if (queue_->lengths.empty()) {
+                queue_->sleeping = true;
+                armed_           = true;
+            } else {
+                /* the sender continues with the memory of the previous batch */
+                rx_data_.swap(queue_->data);
+                rx_lengths_.swap(queue_->lengths);
+                queue_->sleeping = false;
+                armed_           = false;
+            }
+        }
+
+#ifdef __linux__
+        if (signaled) {
+            uint64_t value;
+            (void)::read(queue_->event_fd, &value, sizeof(value));
+        }
+#else
+        (void)signaled;
+#endif
+
+        if (rx_lengths_.empty())
+            return RTP_INTERRUPTED;
+    }
+
+    size_t offset = rx_offset_;
+
+    *ndgrams = std::min(count, rx_lengths_.size() - rx_next_);
+
+    for (size_t i = 0; i < *ndgrams; ++i) {
+        dgrams[i].data = rx_data_.data() + offset;
+        dgrams[i].len  = rx_lengths_[rx_next_ + i];
+        offset        += dgrams[i].len;
+    }
+
+    return RTP_OK;
+}
+
+void uvgrtp::loopback::release(size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        rx_offset_ += rx_lengths_[rx_next_ + i];
+
+    rx_next_ += count;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "transport.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace uvgrtp {
+
+    /* Upper limit of the bytes queued for one loopback receiver. If the receiver
+     * does not keep up, the datagrams that do not fit are dropped */
+    const size_t LOOPBACK_MAX_QUEUED = 64 * 1024 * 1024;
+
+    struct loopback_queue;
+
+    /* In-process transport that connects media streams of the same process in memory
+     *
+     * Each loopback transport is registered with the UDP port of its media stream and the
+     * datagrams sent to a port are copied to the queue of the transport registered with that
+     * port. The remote address is not looked at. If no transport has been registered with the
+     * port, the datagrams are sent through the UDP socket.
+     *
+     * The datagrams are appended to a buffer that the receiver swaps with its own under
+     * a lock, once per batch. The receiver is woken up (eventfd, Linux only) only if it
+     * has found the queue empty. Elsewhere the packet dispatcher checks the queue
+     * whenever it wakes up to read the UDP socket */
+    class loopback : public transport {
+        public:
+            loopback();
+            ~loopback();
+
+            /* Receive the datagrams sent to port "port" of this process
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if another loopback transport uses "port"
+             * Return RTP_GENERIC_ERROR if creating the wakeup descriptor failed */
+            rtp_error_t init(uint16_t port);
+
+            /* Return RTP_NOT_SUPPORTED if there is no loopback transport with the port of "addr" */
+            rtp_error_t send(sockaddr_in& addr, uvgrtp::buf_vec& buffer, int *bytes_sent);
+            rtp_error_t send(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int *bytes_sent);
+
+            /* Return the number of datagrams dropped because the queue of the receiver was full */
+            uint64_t get_dropped();
+
+            int get_fd();
+
+            /* The datagrams point to the receive buffer and are valid until release() */
+            rtp_error_t recv(uvgrtp::transport_datagram *dgrams, size_t count, size_t *ndgrams);
+            void release(size_t count);
+
+        private:
+            /* Find the queue of port "port", the queue of the previous send is reused */
+            std::shared_ptr<uvgrtp::loopback_queue> find_peer(uint16_t port);
+
+            /* Append the "count" packets of "buffers" to "peer" and wake it up if needed */
+            void enqueue(uvgrtp::loopback_queue& peer, uvgrtp::buf_vec *buffers, size_t count, int *bytes_sent);
+
+            uint16_t port_;
+            std::shared_ptr<uvgrtp::loopback_queue> queue_;
+
+            /* queue of the previous send */
+            uint16_t peer_port_;
+            std::weak_ptr<uvgrtp::loopback_queue> peer_;
+
+            /* written by the sending thread and read by get_send_status() */
+            std::atomic<uint64_t> dropped_;
+
+            /* datagrams taken from the queue, "rx_next_" is the first one not returned by recv() */
+            std::vector<uint8_t> rx_data_;
+            std::vector<size_t> rx_lengths_;
+            size_t rx_next_;
+            size_t rx_offset_;
+
+            /* the receiver has asked to be woken up */
+            bool armed_;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -1,16 +1,24 @@
 #include "media_stream.hh"
 
+#include "bundle.hh"
 #include "formats/h264.hh"
 #include "formats/h265.hh"
 #include "formats/h266.hh"
 #include "debug.hh"
+#include "frame_pool.hh"
 #include "random.hh"
 #include "rtp.hh"
 #include "zrtp.hh"
 
 #include "holepuncher.hh"
+#include "loopback.hh"
+#include "multicast.hh"
+#include "pacer.hh"
 #include "pkt_dispatch.hh"
+#include "pmtu.hh"
+#include "reactor.hh"
 #include "rtcp.hh"
+#include "shm.hh"
 #include "socket.hh"
 #include "srtp/srtcp.hh"
 #include "srtp/srtp.hh"
@@ -19,7 +27,27 @@
 #include <cstring>
 #include <errno.h>
 
-uvgrtp::media_stream::media_stream(std::string addr, int src_port, int dst_port, rtp_format_t fmt, int flags):
+#ifdef __linux__
+#include <linux/filter.h>
+#include <netinet/udp.h>
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+#endif
+
+/* see RCC_BUSY_POLL, one second */
+#define MAX_BUSY_POLL 1000000
+
+/* see RCC_RECV_SHARDS */
+#define MAX_RECV_SHARDS 64
+
+uvgrtp::media_stream::media_stream(std::string addr, int src_port, int dst_port, rtp_format_t fmt, int flags,
+                                   uvgrtp::reactor *reactor):
     srtp_(nullptr),
     srtcp_(nullptr),
     socket_(nullptr),
@@ -31,7 +59,15 @@ uvgrtp::media_stream::media_stream(std::string addr, int src_port, int dst_port,
     rtp_handler_key_(0),
     pkt_dispatcher_(nullptr),
     media_(nullptr),
-    holepuncher_(nullptr)
+    frame_pool_(new uvgrtp::frame_pool()),
+    holepuncher_(nullptr),
+    path_socket_(nullptr),
+    bundle_(nullptr),
+    remote_ssrc_(0),
+    reactor_(reactor),
+    reactor_thread_(0),
+    busy_poll_(0),
+    rcvbuf_max_(0)
 {
     fmt_      = fmt;
     addr_     = addr;
@@ -42,20 +78,27 @@ uvgrtp::media_stream::media_stream(std::string addr, int src_port, int dst_port,
     key_      = uvgrtp::random::generate_32();
 
     ctx_config_.flags = flags;
+
+    if (reactor_)
+        reactor_thread_ = reactor_->assign_thread();
 }
 
 uvgrtp::media_stream::media_stream(
     std::string remote_addr, std::string local_addr,
     int src_port, int dst_port,
-    rtp_format_t fmt, int flags
+    rtp_format_t fmt, int flags,
+    uvgrtp::reactor *reactor
 ):
-    media_stream(remote_addr, src_port, dst_port, fmt, flags)
+    media_stream(remote_addr, src_port, dst_port, fmt, flags, reactor)
 {
     laddr_ = local_addr;
 }
 
 uvgrtp::media_stream::~media_stream()
 {
+    for (auto& shard : shards_)
+        shard.pkt_dispatcher->stop();
+
     pkt_dispatcher_->stop();
 
     if (ctx_config_.flags & RCE_RTCP)
@@ -67,10 +110,19 @@ uvgrtp::media_stream::~media_stream()
     (void)free_resources(RTP_OK);
 }
 
+void uvgrtp::media_stream::set_bundle(std::shared_ptr<uvgrtp::bundle> bundle)
+{
+    bundle_ = bundle;
+}
+
 rtp_error_t uvgrtp::media_stream::init_connection()
 {
     rtp_error_t ret = RTP_OK;
 
+    /* the first media stream of the bundle creates the socket below */
+    if (bundle_ && bundle_->socket)
+        return share_bundle_socket();
+
     socket_ = new uvgrtp::socket(ctx_config_.flags);
 
     if ((ret = socket_->init(AF_INET, SOCK_DGRAM, 0)) != RTP_OK)
@@ -84,16 +136,178 @@ rtp_error_t uvgrtp::media_stream::init_connection()
         LOG_ERROR("Failed to make the socket non-blocking!");
 #endif
 
-    if (laddr_ != "") {
-        sockaddr_in bind_addr = socket_->create_sockaddr(AF_INET, laddr_, src_port_);
-        socket_t socket       = socket_->get_raw_socket();
+    if ((ret = setup_socket(socket_, laddr_)) != RTP_OK)
+        return ret;
+
+    if (ctx_config_.flags & RCE_IO_URING) {
+        if (socket_->enable_io_uring() != RTP_OK)
+            LOG_WARN("io_uring is not available, using regular system calls");
+    }
+
+    addr_out_ = socket_->create_sockaddr(AF_INET, addr_, dst_port_);
+    socket_->set_sockaddr(addr_out_);
+
+    if (uvgrtp::multicast::is_multicast(addr_out_) && (ret = join_multicast(socket_->get_raw_socket())) != RTP_OK)
+        return ret;
+
+    if (ctx_config_.flags & RCE_AF_XDP) {
+        if (socket_->enable_xdp(addr_out_) != RTP_OK)
+            LOG_WARN("AF_XDP is not available, receiving datagrams through the socket");
+    }
+
+    if (ctx_config_.flags & RCE_PMTU_DISCOVERY) {
+        if (socket_->enable_pmtu_discovery(addr_out_) != RTP_OK)
+            LOG_WARN("Path MTU discovery is not available, using the configured MTU");
+    }
+
+    if (ctx_config_.flags & RCE_ECN) {
+        if (socket_->set_ecn(uvgrtp::ECN_ECT0) != RTP_OK)
+            LOG_WARN("ECN is not available, sending packets that are not ECN-capable");
+    }
+
+    if (bundle_) {
+        bundle_->socket = socket_;
+        return share_bundle_socket();
+    }
+
+    return ret;
+}
+
+rtp_error_t uvgrtp::media_stream::share_bundle_socket()
+{
+    socket_ = new uvgrtp::socket(ctx_config_.flags);
+    socket_->share(bundle_->socket);
+
+    addr_out_ = socket_->create_sockaddr(AF_INET, addr_, dst_port_);
+    socket_->set_sockaddr(addr_out_);
+
+    /* the members of the group would receive all media streams of the bundle */
+    if (uvgrtp::multicast::is_multicast(addr_out_)) {
+        LOG_ERROR("Media streams cannot be bundled on a multicast group");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::media_stream::start_dispatcher()
+{
+    if (!bundle_)
+        return pkt_dispatcher_->start(socket_, ctx_config_.flags, reactor_, reactor_thread_);
+
+    /* the first media stream of the bundle starts the receive loop on its reactor thread */
+    if (!bundle_->dispatcher) {
+        auto dispatcher = new uvgrtp::pkt_dispatcher();
+        rtp_error_t ret;
+
+        if ((ret = dispatcher->start(bundle_->socket, ctx_config_.flags, reactor_, reactor_thread_)) != RTP_OK) {
+            delete dispatcher;
+            return ret;
+        }
+
+        bundle_->dispatcher = dispatcher;
+    }
+
+    (void)pkt_dispatcher_->start(bundle_->dispatcher);
+
+    /* the remote SSRC and the payload type are usually configured only after the stream has been created */
+    rtp_error_t ret = update_route();
+
+    if (ret == RTP_INITIALIZED) {
+        LOG_WARN("Payload type %u is already used in the bundle, the media stream receives nothing "
+                 "until RCC_REMOTE_SSRC or RCC_DYN_PAYLOAD_TYPE is set", rtp_->get_payload_type());
+        return RTP_OK;
+    }
+
+    return ret;
+}
+
+rtp_error_t uvgrtp::media_stream::update_route()
+{
+    return bundle_->dispatcher->set_route(pkt_dispatcher_, rtp_->get_ssrc(), rtp_->get_payload_type(), remote_ssrc_);
+}
+
+void uvgrtp::media_stream::limit_payload_size()
+{
+    size_t hdr = IPV4_HDR_SIZE + UDP_HDR_SIZE + RTP_HDR_SIZE;
+    size_t mtu = socket_->get_pmtu()->get_mtu();
+
+    if (ctx_config_.flags & RCE_SRTP_AUTHENTICATE_RTP)
+        hdr += UVG_AUTH_TAG_LENGTH;
+
+    /* RCC_MTU_SIZE remains the upper limit */
+    rtp_->set_payload_limit(mtu > hdr ? mtu - hdr : 1);
+}
+
+void uvgrtp::media_stream::init_transport()
+{
+    if (ctx_config_.flags & RCE_LOOPBACK_TRANSPORT) {
+        if (ctx_config_.flags & RCE_SHM_TRANSPORT)
+            LOG_WARN("RCE_LOOPBACK_TRANSPORT takes precedence over RCE_SHM_TRANSPORT");
+
+        uvgrtp::loopback *loopback = new uvgrtp::loopback();
+
+        if (loopback->init((uint16_t)src_port_) != RTP_OK) {
+            LOG_WARN("Loopback transport is not available, using UDP");
+            delete loopback;
+            return;
+        }
+
+        socket_->set_transport(loopback);
+    } else if (ctx_config_.flags & RCE_SHM_TRANSPORT) {
+        uvgrtp::shm *shm = new uvgrtp::shm();
+
+        /* either direction alone is still useful */
+        bool receiving = shm->listen((uint16_t)src_port_) == RTP_OK;
+        bool sending   = shm->set_remote(addr_out_) == RTP_OK;
+
+        if (!receiving && !sending) {
+            LOG_WARN("Shared-memory transport is not available, using UDP");
+            delete shm;
+            return;
+        }
+
+        socket_->set_transport(shm);
+    }
+}
+
+rtp_error_t uvgrtp::media_stream::setup_socket(uvgrtp::socket *socket, std::string local_addr)
+{
+    rtp_error_t ret = RTP_OK;
+
+    if (ctx_config_.flags & RCE_RECV_SHARDS) {
+#ifdef __linux__
+        /* SO_REUSEPORT must be set before binding for the shards to be able to join the group */
+        int enabled = 1;
+
+        if ((ret = socket->setsockopt(SOL_SOCKET, SO_REUSEPORT, (const char *)&enabled, sizeof(int))) != RTP_OK)
+            return ret;
+#else
+        LOG_WARN("Receive shards are supported only on Linux");
+#endif
+    }
+
+    /* A multicast receiver binds to INADDR_ANY and the local address only selects the interface.
+     * SO_REUSEADDR lets several receivers on the same host join the group on the same port */
+    sockaddr_in remote = socket->create_sockaddr(AF_INET, addr_, dst_port_);
+    bool is_group      = uvgrtp::multicast::is_multicast(remote);
+
+    if (is_group) {
+        int enabled = 1;
+
+        if ((ret = socket->setsockopt(SOL_SOCKET, SO_REUSEADDR, (const char *)&enabled, sizeof(int))) != RTP_OK)
+            return ret;
+    }
 
-        if (bind(socket, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) == -1) {
+    if (local_addr != "" && !is_group) {
+        sockaddr_in bind_addr = socket->create_sockaddr(AF_INET, local_addr, src_port_);
+
+        if (bind(socket->get_raw_socket(), (struct sockaddr *)&bind_addr, sizeof(bind_addr)) == -1) {
             log_platform_error("bind(2) failed");
             return RTP_BIND_ERROR;
         }
     } else {
-        if ((ret = socket_->bind(AF_INET, INADDR_ANY, src_port_)) != RTP_OK)
+        if ((ret = socket->bind(AF_INET, INADDR_ANY, src_port_)) != RTP_OK)
             return ret;
     }
 
@@ -101,80 +315,187 @@ rtp_error_t uvgrtp::media_stream::init_connection()
      * the default size is way too small for a larger video conference */
     int buf_size = 4 * 1024 * 1024;
 
-    if ((ret = socket_->setsockopt(SOL_SOCKET, SO_SNDBUF, (const char *)&buf_size, sizeof(int))) != RTP_OK)
+    if ((ret = socket->setsockopt(SOL_SOCKET, SO_SNDBUF, (const char *)&buf_size, sizeof(int))) != RTP_OK)
         return ret;
 
-    if ((ret = socket_->setsockopt(SOL_SOCKET, SO_RCVBUF, (const char *)&buf_size, sizeof(int))) != RTP_OK)
+    if ((ret = socket->setsockopt(SOL_SOCKET, SO_RCVBUF, (const char *)&buf_size, sizeof(int))) != RTP_OK)
         return ret;
 
-    addr_out_ = socket_->create_sockaddr(AF_INET, addr_, dst_port_);
-    socket_->set_sockaddr(addr_out_);
+    if (ctx_config_.flags & RCE_UDP_GRO) {
+#ifdef __linux__
+        /* GRO is only an optimization so if it's not supported, packets are received normally */
+        int enabled = 1;
+
+        if (::setsockopt(socket->get_raw_socket(), SOL_UDP, UDP_GRO, &enabled, sizeof(enabled)) < 0)
+            LOG_WARN("UDP GRO is not supported: %s", strerror(errno));
+#else
+        LOG_WARN("UDP GRO is supported only on Linux");
+#endif
+    }
+
+#ifdef __linux__
+    /* Receive timestamps taken by the kernel are used for jitter calculation and frame
+     * reassembly. Without them, the time is read when the datagram is processed */
+    int enabled = 1;
+
+    if (::setsockopt(socket->get_raw_socket(), SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) < 0)
+        LOG_WARN("Failed to enable receive timestamps: %s", strerror(errno));
+
+    /* report the number of datagrams dropped by the kernel with each received datagram */
+    if (::setsockopt(socket->get_raw_socket(), SOL_SOCKET, SO_RXQ_OVFL, &enabled, sizeof(enabled)) < 0)
+        LOG_WARN("Failed to enable the kernel drop counter: %s", strerror(errno));
+#endif
 
     return ret;
 }
 
+rtp_error_t uvgrtp::media_stream::join_multicast(socket_t socket)
+{
+    rtp_error_t ret;
+    in_addr iface;
+
+    iface.s_addr = htonl(INADDR_ANY);
+
+    if (laddr_ != "")
+        iface = socket_->create_sockaddr(AF_INET, laddr_, 0).sin_addr;
+
+    auto group = new uvgrtp::multicast(socket);
+    multicast_.push_back(group);
+
+    if ((ret = group->join(addr_out_, iface)) != RTP_OK)
+        return ret;
+
+    if ((ret = group->set_ttl(MULTICAST_DEFAULT_TTL)) != RTP_OK)
+        return ret;
+
+    if (laddr_ != "")
+        return group->set_interface(iface);
+
+    return RTP_OK;
+}
+
+void uvgrtp::media_stream::join_rtcp_multicast()
+{
+    if (!uvgrtp::multicast::is_multicast(addr_out_))
+        return;
+
+    /* the RTCP reports of all members are sent to the group, one report reaches every member */
+    for (auto& socket : rtcp_->get_sockets()) {
+        if (join_multicast(socket->get_raw_socket()) != RTP_OK)
+            LOG_WARN("RTCP cannot receive the reports of the multicast group");
+    }
+}
+
+rtp_error_t uvgrtp::media_stream::start_rtcp()
+{
+    if (!(ctx_config_.flags & RCE_RTCP_MUX)) {
+        rtcp_->add_participant(addr_, src_port_ + 1, dst_port_ + 1, rtp_->get_clock_rate());
+        join_rtcp_multicast();
+        return rtcp_->start(reactor_, reactor_thread_);
+    }
+
+    /* the members of a group would receive the reports on their RTP ports */
+    if (uvgrtp::multicast::is_multicast(addr_out_)) {
+        LOG_ERROR("RTCP cannot be multiplexed on the RTP port of a multicast group");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    rtcp_->add_participant(socket_, addr_, dst_port_, rtp_->get_clock_rate());
+    pkt_dispatcher_->install_rtcp_handler(rtcp_, rtcp_->mux_packet_handler);
+
+    return rtcp_->start(reactor_, reactor_thread_);
+}
+
 rtp_error_t uvgrtp::media_stream::create_media(rtp_format_t fmt)
 {
+    (void)fmt;
+
+    if (!(media_ = new_media(pkt_dispatcher_, rtp_handler_key_)))
+        return RTP_NOT_SUPPORTED;
+
+    return RTP_OK;
+}
+
+uvgrtp::formats::media *uvgrtp::media_stream::new_media(uvgrtp::pkt_dispatcher *dispatcher, uint32_t key)
+{
+    uvgrtp::formats::media *media = nullptr;
+
     switch (fmt_) {
         case RTP_FORMAT_H264:
-            media_ = new uvgrtp::formats::h264(socket_, rtp_, ctx_config_.flags);
+            media = new uvgrtp::formats::h264(socket_, rtp_, ctx_config_.flags);
 
-            pkt_dispatcher_->install_aux_handler(
-                rtp_handler_key_,
-                dynamic_cast<uvgrtp::formats::h264 *>(media_)->get_h264_frame_info(),
-                dynamic_cast<uvgrtp::formats::h264 *>(media_)->packet_handler,
-                dynamic_cast<uvgrtp::formats::h264 *>(media_)->frame_getter
+            dispatcher->install_aux_handler(
+                key,
+                dynamic_cast<uvgrtp::formats::h264 *>(media)->get_h264_frame_info(),
+                dynamic_cast<uvgrtp::formats::h264 *>(media)->packet_handler,
+                dynamic_cast<uvgrtp::formats::h264 *>(media)->frame_getter
             );
-            return RTP_OK;
+            return media;
 
         case RTP_FORMAT_H265:
-            media_ = new uvgrtp::formats::h265(socket_, rtp_, ctx_config_.flags);
+            media = new uvgrtp::formats::h265(socket_, rtp_, ctx_config_.flags);
 
-            pkt_dispatcher_->install_aux_handler(
-                rtp_handler_key_,
-                dynamic_cast<uvgrtp::formats::h265 *>(media_)->get_h265_frame_info(),
-                dynamic_cast<uvgrtp::formats::h265 *>(media_)->packet_handler,
-                dynamic_cast<uvgrtp::formats::h265 *>(media_)->frame_getter
+            dispatcher->install_aux_handler(
+                key,
+                dynamic_cast<uvgrtp::formats::h265 *>(media)->get_h265_frame_info(),
+                dynamic_cast<uvgrtp::formats::h265 *>(media)->packet_handler,
+                dynamic_cast<uvgrtp::formats::h265 *>(media)->frame_getter
             );
-            return RTP_OK;
+            return media;
 
         case RTP_FORMAT_H266:
-            media_ = new uvgrtp::formats::h266(socket_, rtp_, ctx_config_.flags);
+            media = new uvgrtp::formats::h266(socket_, rtp_, ctx_config_.flags);
 
-            pkt_dispatcher_->install_aux_handler(
-                rtp_handler_key_,
-                dynamic_cast<uvgrtp::formats::h266 *>(media_)->get_h266_frame_info(),
-                dynamic_cast<uvgrtp::formats::h266 *>(media_)->packet_handler,
+            dispatcher->install_aux_handler(
+                key,
+                dynamic_cast<uvgrtp::formats::h266 *>(media)->get_h266_frame_info(),
+                dynamic_cast<uvgrtp::formats::h266 *>(media)->packet_handler,
                 nullptr
             );
-            return RTP_OK;
+            return media;
 
         case RTP_FORMAT_OPUS:
         case RTP_FORMAT_GENERIC:
-            media_ = new uvgrtp::formats::media(socket_, rtp_, ctx_config_.flags);
+            media = new uvgrtp::formats::media(socket_, rtp_, ctx_config_.flags);
 
-            pkt_dispatcher_->install_aux_handler(
-                rtp_handler_key_,
-                media_->get_media_frame_info(),
-                media_->packet_handler,
+            dispatcher->install_aux_handler(
+                key,
+                media->get_media_frame_info(),
+                media->packet_handler,
                 nullptr
             );
-            return RTP_OK;
+            return media;
 
         default:
             LOG_ERROR("Unknown payload format %u\n", fmt_);
-            media_ = nullptr;
-            return RTP_NOT_SUPPORTED;
+            return nullptr;
     }
 }
 
 rtp_error_t uvgrtp::media_stream::free_resources(rtp_error_t ret)
 {
+    /* the groups must be left before the sockets are closed */
+    for (auto& group : multicast_)
+        delete group;
+    multicast_.clear();
+
+    for (auto& shard : shards_) {
+        delete shard.pkt_dispatcher;
+        delete shard.media;
+        delete shard.socket;
+    }
+    shards_.clear();
+
     if (socket_)
     {
         delete socket_;
         socket_ = nullptr;
     }
+    if (path_socket_)
+    {
+        delete path_socket_;
+        path_socket_ = nullptr;
+    }
     if (rtcp_)
     {
         delete rtcp_;
@@ -211,11 +532,23 @@ rtp_error_t uvgrtp::media_stream::free_resources(rtp_error_t ret)
         media_ = nullptr;
     }
 
+    /* frames still held by the application keep the pool alive */
+    if (frame_pool_)
+    {
+        frame_pool_->release();
+        frame_pool_ = nullptr;
+    }
+
+    /* the last media stream of the bundle closes the shared socket */
+    bundle_ = nullptr;
+
     return ret;
 }
 
 rtp_error_t uvgrtp::media_stream::init()
 {
+    rtp_error_t ret = RTP_OK;
+
     if (init_connection() != RTP_OK) {
         LOG_ERROR("Failed to initialize the underlying socket");
         return free_resources(RTP_GENERIC_ERROR);
@@ -229,24 +562,27 @@ rtp_error_t uvgrtp::media_stream::init()
 
     socket_->install_handler(rtcp_, rtcp_->send_packet_handler_vec);
 
-    rtp_handler_key_ = pkt_dispatcher_->install_handler(rtp_->packet_handler);
+    rtp_handler_key_ = pkt_dispatcher_->install_handler(frame_pool_, rtp_->packet_handler);
     pkt_dispatcher_->install_aux_handler(rtp_handler_key_, rtcp_, rtcp_->recv_packet_handler, nullptr);
 
     if (create_media(fmt_) != RTP_OK)
         return free_resources(RTP_MEMORY_ERROR);
 
+    if ((ctx_config_.flags & RCE_RTCP) && (ret = start_rtcp()) != RTP_OK)
+        return free_resources(ret);
+
     if (ctx_config_.flags & RCE_HOLEPUNCH_KEEPALIVE) {
         holepuncher_ = new uvgrtp::holepuncher(socket_);
-        holepuncher_->start();
+        holepuncher_->start(reactor_, reactor_thread_);
     }
 
-    if (ctx_config_.flags & RCE_RTCP) {
-        rtcp_->add_participant(addr_, src_port_ + 1, dst_port_ + 1, rtp_->get_clock_rate());
-        rtcp_->start();
-    }
+    if (socket_->get_pmtu())
+        limit_payload_size();
+
+    init_transport();
 
     initialized_ = true;
-    return pkt_dispatcher_->start(socket_, ctx_config_.flags);
+    return start_dispatcher();
 }
 
 rtp_error_t uvgrtp::media_stream::init(uvgrtp::zrtp *zrtp)
@@ -280,8 +616,8 @@ rtp_error_t uvgrtp::media_stream::init(uvgrtp::zrtp *zrtp)
     socket_->install_handler(rtcp_, rtcp_->send_packet_handler_vec);
     socket_->install_handler(srtp_, srtp_->send_packet_handler);
 
-    rtp_handler_key_  = pkt_dispatcher_->install_handler(rtp_->packet_handler);
-    zrtp_handler_key_ = pkt_dispatcher_->install_handler(zrtp->packet_handler);
+    rtp_handler_key_  = pkt_dispatcher_->install_handler(frame_pool_, rtp_->packet_handler);
+    zrtp_handler_key_ = pkt_dispatcher_->install_handler(zrtp, zrtp->packet_handler);
 
     pkt_dispatcher_->install_aux_handler(rtp_handler_key_, rtcp_, rtcp_->recv_packet_handler, nullptr);
     pkt_dispatcher_->install_aux_handler(rtp_handler_key_, srtp_, srtp_->recv_packet_handler, nullptr);
@@ -289,21 +625,24 @@ rtp_error_t uvgrtp::media_stream::init(uvgrtp::zrtp *zrtp)
     if (create_media(fmt_) != RTP_OK)
         return free_resources(RTP_MEMORY_ERROR);
 
+    if ((ctx_config_.flags & RCE_RTCP) && (ret = start_rtcp()) != RTP_OK)
+        return free_resources(ret);
+
     if (ctx_config_.flags & RCE_HOLEPUNCH_KEEPALIVE) {
         holepuncher_ = new uvgrtp::holepuncher(socket_);
-        holepuncher_->start();
-    }
-
-    if (ctx_config_.flags & RCE_RTCP) {
-        rtcp_->add_participant(addr_, src_port_ + 1, dst_port_ + 1, rtp_->get_clock_rate());
-        rtcp_->start();
+        holepuncher_->start(reactor_, reactor_thread_);
     }
 
     if (ctx_config_.flags & RCE_SRTP_AUTHENTICATE_RTP)
         rtp_->set_payload_size(MAX_PAYLOAD - UVG_AUTH_TAG_LENGTH);
 
+    if (socket_->get_pmtu())
+        limit_payload_size();
+
+    init_transport();
+
     initialized_ = true;
-    return pkt_dispatcher_->start(socket_, ctx_config_.flags);
+    return start_dispatcher();
 }
 
 rtp_error_t uvgrtp::media_stream::add_srtp_ctx(uint8_t *key, uint8_t *salt)
@@ -346,7 +685,7 @@ rtp_error_t uvgrtp::media_stream::add_srtp_ctx(uint8_t *key, uint8_t *salt)
     socket_->install_handler(rtcp_, rtcp_->send_packet_handler_vec);
     socket_->install_handler(srtp_, srtp_->send_packet_handler);
 
-    rtp_handler_key_ = pkt_dispatcher_->install_handler(rtp_->packet_handler);
+    rtp_handler_key_ = pkt_dispatcher_->install_handler(frame_pool_, rtp_->packet_handler);
 
     pkt_dispatcher_->install_aux_handler(rtp_handler_key_, rtcp_, rtcp_->recv_packet_handler, nullptr);
     pkt_dispatcher_->install_aux_handler(rtp_handler_key_, srtp_, srtp_->recv_packet_handler, nullptr);
@@ -354,21 +693,24 @@ rtp_error_t uvgrtp::media_stream::add_srtp_ctx(uint8_t *key, uint8_t *salt)
     if (create_media(fmt_) != RTP_OK)
         return free_resources(RTP_MEMORY_ERROR);
 
+    if ((ctx_config_.flags & RCE_RTCP) && (ret = start_rtcp()) != RTP_OK)
+        return free_resources(ret);
+
     if (ctx_config_.flags & RCE_HOLEPUNCH_KEEPALIVE) {
         holepuncher_ = new uvgrtp::holepuncher(socket_);
-        holepuncher_->start();
-    }
-
-    if (ctx_config_.flags & RCE_RTCP) {
-        rtcp_->add_participant(addr_, src_port_ + 1, dst_port_ + 1, rtp_->get_clock_rate());
-        rtcp_->start();
+        holepuncher_->start(reactor_, reactor_thread_);
     }
 
     if (ctx_config_.flags & RCE_SRTP_AUTHENTICATE_RTP)
         rtp_->set_payload_size(MAX_PAYLOAD - UVG_AUTH_TAG_LENGTH);
 
+    if (socket_->get_pmtu())
+        limit_payload_size();
+
+    init_transport();
+
     initialized_ = true;
-    return pkt_dispatcher_->start(socket_, ctx_config_.flags);
+    return start_dispatcher();
 }
 
 rtp_error_t uvgrtp::media_stream::push_frame(uint8_t *data, size_t data_len, int flags)
@@ -381,6 +723,9 @@ rtp_error_t uvgrtp::media_stream::push_frame(uint8_t *data, size_t data_len, int
     if (ctx_config_.flags & RCE_HOLEPUNCH_KEEPALIVE)
         holepuncher_->notify();
 
+    if (socket_->get_pmtu() && socket_->get_pmtu()->update())
+        limit_payload_size();
+
     return media_->push_frame(data, data_len, flags);
 }
 
@@ -394,6 +739,9 @@ rtp_error_t uvgrtp::media_stream::push_frame(std::unique_ptr<uint8_t[]> data, si
     if (ctx_config_.flags & RCE_HOLEPUNCH_KEEPALIVE)
         holepuncher_->notify();
 
+    if (socket_->get_pmtu() && socket_->get_pmtu()->update())
+        limit_payload_size();
+
     return media_->push_frame(std::move(data), data_len, flags);
 }
 
@@ -409,6 +757,9 @@ rtp_error_t uvgrtp::media_stream::push_frame(uint8_t *data, size_t data_len, uin
     if (ctx_config_.flags & RCE_HOLEPUNCH_KEEPALIVE)
         holepuncher_->notify();
 
+    if (socket_->get_pmtu() && socket_->get_pmtu()->update())
+        limit_payload_size();
+
     rtp_->set_timestamp(ts);
     ret = media_->push_frame(data, data_len, flags);
     rtp_->set_timestamp(INVALID_TS);
@@ -428,6 +779,9 @@ rtp_error_t uvgrtp::media_stream::push_frame(std::unique_ptr<uint8_t[]> data, si
     if (ctx_config_.flags & RCE_HOLEPUNCH_KEEPALIVE)
         holepuncher_->notify();
 
+    if (socket_->get_pmtu() && socket_->get_pmtu()->update())
+        limit_payload_size();
+
     rtp_->set_timestamp(ts);
     ret = media_->push_frame(std::move(data), data_len, flags);
     rtp_->set_timestamp(INVALID_TS);
@@ -556,7 +910,14 @@ rtp_error_t uvgrtp::media_stream::configure_ctx(int flag, ssize_t value)
             if (value <= 0 || UINT8_MAX < value)
                 return RTP_INVALID_VALUE;
 
+            uint8_t old_payload = rtp_->get_payload_type();
             rtp_->set_dynamic_payload((uint8_t)value);
+
+            /* the payload type may already route the packets to another bundled media stream */
+            if (bundle_ && (ret = update_route()) != RTP_OK) {
+                LOG_ERROR("Payload type %u is already used in the bundle, set RCC_REMOTE_SSRC first", (uint8_t)value);
+                rtp_->set_dynamic_payload(old_payload);
+            }
         }
         break;
 
@@ -582,6 +943,140 @@ rtp_error_t uvgrtp::media_stream::configure_ctx(int flag, ssize_t value)
         }
         break;
 
+        case RCC_RECV_SHARDS: {
+            if (value <= 0 || value > MAX_RECV_SHARDS || !(ctx_config_.flags & RCE_RECV_SHARDS))
+                return RTP_INVALID_VALUE;
+
+            if (!shards_.empty())
+                return RTP_INITIALIZED;
+
+            /* the shards share the media stream's RTP/RTCP state but not its SRTP contexts,
+             * AF_XDP would steer the packets of every shard to the first socket and the
+             * duplicates of a redundant path would be reassembled by different shards.
+             * Multiplexed RTCP packets are handled only by the dispatcher of the stream */
+            if ((ctx_config_.flags & (RCE_SRTP | RCE_RTCP_MUX)) || socket_->get_xdp() || path_socket_)
+                return RTP_NOT_SUPPORTED;
+
+            ret = create_recv_shards((size_t)value - 1);
+        }
+        break;
+
+        case RCC_REMOTE_SSRC: {
+            if (!bundle_)
+                return RTP_NOT_SUPPORTED;
+
+            if (value < 0 || UINT32_MAX < value)
+                return RTP_INVALID_VALUE;
+
+            uint32_t old_ssrc = remote_ssrc_;
+            remote_ssrc_      = (uint32_t)value;
+
+            if ((ret = update_route()) != RTP_OK) {
+                LOG_ERROR("Payload type %u is already used in the bundle", rtp_->get_payload_type());
+                remote_ssrc_ = old_ssrc;
+            }
+        }
+        break;
+
+        case RCC_BUSY_POLL: {
+            if (value < 0 || value > MAX_BUSY_POLL)
+                return RTP_INVALID_VALUE;
+
+            busy_poll_ = (uint32_t)value;
+
+            /* the dispatcher spins even if the kernel does not busy poll the device queue */
+            (void)socket_->set_busy_poll((int)value);
+            pkt_dispatcher_->set_busy_poll(busy_poll_);
+
+            for (auto& shard : shards_) {
+                (void)shard.socket->set_busy_poll((int)value);
+                shard.pkt_dispatcher->set_busy_poll(busy_poll_);
+            }
+        }
+        break;
+
+        case RCC_UDP_RCV_BUF_MAX: {
+            if (value <= 0 || !(ctx_config_.flags & RCE_ADAPTIVE_RCVBUF))
+                return RTP_INVALID_VALUE;
+
+            rcvbuf_max_ = (size_t)value;
+            pkt_dispatcher_->set_rcvbuf_max(rcvbuf_max_);
+
+            for (auto& shard : shards_)
+                shard.pkt_dispatcher->set_rcvbuf_max(rcvbuf_max_);
+        }
+        break;
+
+        case RCC_MULTICAST_TTL: {
+            if (value < 0 || value > 255 || multicast_.empty())
+                return RTP_INVALID_VALUE;
+
+            for (auto& group : multicast_) {
+                if ((ret = group->set_ttl((int)value)) != RTP_OK)
+                    return ret;
+            }
+        }
+        break;
+
+        case RCC_MULTICAST_LOOP: {
+            if (value < 0 || value > 1 || multicast_.empty())
+                return RTP_INVALID_VALUE;
+
+            for (auto& group : multicast_) {
+                if ((ret = group->set_loop(value == 1)) != RTP_OK)
+                    return ret;
+            }
+        }
+        break;
+
+        case RCC_DSCP: {
+            if (value < 0 || value > 63)
+                return RTP_INVALID_VALUE;
+
+            ret = socket_->set_dscp((int)value);
+        }
+        break;
+
+        case RCC_DSCP_INTRA: {
+            if (value < -1 || value > 63)
+                return RTP_INVALID_VALUE;
+
+            ret = socket_->set_priority_dscp((int)value);
+        }
+        break;
+
+        case RCC_ECN_ECT1: {
+            if (value < 0 || value > 1 || !(ctx_config_.flags & RCE_ECN))
+                return RTP_INVALID_VALUE;
+
+            ret = socket_->set_ecn(value ? uvgrtp::ECN_ECT1 : uvgrtp::ECN_ECT0);
+        }
+        break;
+
+        case RCC_PACING_RATE: {
+            if (value < 0)
+                return RTP_INVALID_VALUE;
+
+            socket_->enable_pacing()->set_rate((uint64_t)value * 1000);
+        }
+        break;
+
+        case RCC_PACING_BURST: {
+            if (value <= 0)
+                return RTP_INVALID_VALUE;
+
+            socket_->enable_pacing()->set_burst((size_t)value);
+        }
+        break;
+
+        case RCC_PACING_FRACTION: {
+            if (value < 0 || value > 100)
+                return RTP_INVALID_VALUE;
+
+            socket_->enable_pacing()->set_fraction((unsigned)value);
+        }
+        break;
+
         default:
             return RTP_INVALID_VALUE;
     }
@@ -589,6 +1084,234 @@ rtp_error_t uvgrtp::media_stream::configure_ctx(int flag, ssize_t value)
     return ret;
 }
 
+rtp_error_t uvgrtp::media_stream::get_send_status(send_status_t *status)
+{
+    if (!initialized_) {
+        LOG_ERROR("RTP context has not been initialized fully, cannot continue!");
+        return RTP_NOT_INITIALIZED;
+    }
+
+    return socket_->get_send_status(status);
+}
+
+rtp_error_t uvgrtp::media_stream::get_recv_status(recv_status_t *status)
+{
+    if (!initialized_) {
+        LOG_ERROR("RTP context has not been initialized fully, cannot continue!");
+        return RTP_NOT_INITIALIZED;
+    }
+
+    if (!status)
+        return RTP_INVALID_VALUE;
+
+    int buf_size      = 0;
+    socklen_t opt_len = sizeof(buf_size);
+
+    if (::getsockopt(socket_->get_raw_socket(), SOL_SOCKET, SO_RCVBUF, (char *)&buf_size, &opt_len) < 0) {
+        log_platform_error("getsockopt(2) failed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    status->buffer_size  = (size_t)buf_size;
+    status->kernel_drops = pkt_dispatcher_->get_kernel_drops();
+
+    for (auto& shard : shards_)
+        status->kernel_drops += shard.pkt_dispatcher->get_kernel_drops();
+
+    status->duplicate_packets = pkt_dispatcher_->get_duplicates();
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::media_stream::get_pool_status(pool_status_t *status)
+{
+    if (!initialized_) {
+        LOG_ERROR("RTP context has not been initialized fully, cannot continue!");
+        return RTP_NOT_INITIALIZED;
+    }
+
+    if (!status)
+        return RTP_INVALID_VALUE;
+
+    frame_pool_->get_status(status);
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::media_stream::add_destination(std::string addr, uint16_t port)
+{
+    if (!initialized_) {
+        LOG_ERROR("RTP context has not been initialized fully, cannot continue!");
+        return RTP_NOT_INITIALIZED;
+    }
+
+    /* SRTP would have to encrypt each packet separately for each destination */
+    if (ctx_config_.flags & RCE_SRTP)
+        return RTP_NOT_SUPPORTED;
+
+    sockaddr_in dest = socket_->create_sockaddr(AF_INET, addr, port);
+
+    return socket_->add_destination(dest);
+}
+
+rtp_error_t uvgrtp::media_stream::remove_destination(std::string addr, uint16_t port)
+{
+    if (!initialized_) {
+        LOG_ERROR("RTP context has not been initialized fully, cannot continue!");
+        return RTP_NOT_INITIALIZED;
+    }
+
+    sockaddr_in dest = socket_->create_sockaddr(AF_INET, addr, port);
+
+    return socket_->remove_destination(dest);
+}
+
+rtp_error_t uvgrtp::media_stream::add_redundant_path(std::string remote_addr, std::string local_addr)
+{
+    rtp_error_t ret = RTP_OK;
+
+    if (!initialized_) {
+        LOG_ERROR("RTP context has not been initialized fully, cannot continue!");
+        return RTP_NOT_INITIALIZED;
+    }
+
+    if (path_socket_)
+        return RTP_INITIALIZED;
+
+    /* the packets of the other path would arrive through other sockets or the transport,
+     * and the io_uring receive loop reads only the ring of the socket of the media stream */
+    if (!shards_.empty() || socket_->get_transport() || socket_->get_uring() || bundle_)
+        return RTP_NOT_SUPPORTED;
+
+    /* Duplicates are dropped before SRTP authenticates the packets, so a forged packet with
+     * the SSRC and sequence number of a real one would make the real copy of the other path
+     * look like a duplicate */
+    if (ctx_config_.flags & RCE_SRTP) {
+        LOG_ERROR("Redundant paths are not supported with SRTP");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    /* the socket of the media stream would already be bound to the port on all interfaces */
+    if (laddr_ == "") {
+        LOG_ERROR("A redundant path requires the media stream to be bound to a local address");
+        return RTP_INVALID_VALUE;
+    }
+
+    sockaddr_in remote = socket_->create_sockaddr(AF_INET, remote_addr, dst_port_);
+
+    if (uvgrtp::multicast::is_multicast(remote) || uvgrtp::multicast::is_multicast(addr_out_)) {
+        LOG_ERROR("Redundant paths are not supported for multicast groups");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    /* the zero-copy completions are tracked only for the socket of the media stream */
+    auto path = new uvgrtp::socket(ctx_config_.flags & ~RCE_MSG_ZEROCOPY);
+
+    if ((ret = path->init(AF_INET, SOCK_DGRAM, 0)) != RTP_OK ||
+        (ret = setup_socket(path, local_addr)) != RTP_OK) {
+        delete path;
+        return ret;
+    }
+
+#ifdef _WIN32
+    int enabled = 1;
+
+    if (::ioctlsocket(path->get_raw_socket(), FIONBIO, (u_long *)&enabled) < 0)
+        LOG_ERROR("Failed to make the socket non-blocking!");
+#endif
+
+    path->set_sockaddr(remote);
+
+    if ((ret = pkt_dispatcher_->add_redundant_path(path)) != RTP_OK) {
+        delete path;
+        return ret;
+    }
+
+    path_socket_ = path;
+    socket_->set_redundant_path(path);
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::media_stream::create_recv_shards(size_t count)
+{
+#ifdef __linux__
+    rtp_error_t ret = RTP_OK;
+
+    for (size_t i = 0; i < count; ++i) {
+        recv_shard shard;
+
+        shard.socket         = new uvgrtp::socket(ctx_config_.flags);
+        shard.pkt_dispatcher = new uvgrtp::pkt_dispatcher();
+        shard.media          = nullptr;
+        shards_.push_back(shard);
+
+        if ((ret = shard.socket->init(AF_INET, SOCK_DGRAM, 0)) != RTP_OK ||
+            (ret = setup_socket(shard.socket, laddr_)) != RTP_OK)
+            goto error;
+
+        uint32_t key = shard.pkt_dispatcher->install_handler(frame_pool_, rtp_->packet_handler);
+        shard.pkt_dispatcher->install_aux_handler(key, rtcp_, rtcp_->recv_packet_handler, nullptr);
+
+        if (!(shards_.back().media = new_media(shard.pkt_dispatcher, key))) {
+            ret = RTP_NOT_SUPPORTED;
+            goto error;
+        }
+
+        shard.pkt_dispatcher->install_receive_hook(pkt_dispatcher_, uvgrtp::pkt_dispatcher::forward_frame);
+    }
+
+    {
+        /* Steer the packets to the sockets by SSRC. The sockets are indexed in the
+         * order they joined the group so index 0 is the socket of the media stream.
+         * Packets shorter than an RTP header fail the load and are given to socket 0 */
+        struct sock_filter code[] = {
+            { BPF_LD  | BPF_W   | BPF_ABS, 0, 0, 8 },                          /* A = SSRC */
+            { BPF_ALU | BPF_MOD | BPF_K,   0, 0, (uint32_t)shards_.size() + 1 },
+            { BPF_RET | BPF_A,             0, 0, 0 },
+        };
+        struct sock_fprog prog = { sizeof(code) / sizeof(code[0]), code };
+
+        if (::setsockopt(socket_->get_raw_socket(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+            log_platform_error("Failed to attach SSRC steering program, packets are distributed by flow hash");
+        }
+    }
+
+    for (auto& shard : shards_) {
+        size_t thread = reactor_ ? reactor_->assign_thread() : 0;
+
+        if ((ret = shard.pkt_dispatcher->start(shard.socket, ctx_config_.flags, reactor_, thread)) != RTP_OK)
+            goto error;
+
+        if (busy_poll_) {
+            (void)shard.socket->set_busy_poll((int)busy_poll_);
+            shard.pkt_dispatcher->set_busy_poll(busy_poll_);
+        }
+
+        if (rcvbuf_max_)
+            shard.pkt_dispatcher->set_rcvbuf_max(rcvbuf_max_);
+    }
+
+    return RTP_OK;
+
+error:
+    LOG_ERROR("Failed to create receive shards");
+
+    for (auto& shard : shards_) {
+        shard.pkt_dispatcher->stop();
+        delete shard.pkt_dispatcher;
+        delete shard.media;
+        delete shard.socket;
+    }
+    shards_.clear();
+
+    return ret;
+#else
+    (void)count;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
 uint32_t uvgrtp::media_stream::get_key()
 {
     return key_;
@@ -1,43 +1,116 @@
 #include "multicast.hh"
 
-#include "frame.hh"
+#include "debug.hh"
 
-uvgrtp::multicast::multicast()
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/socket.h>
+
+#ifndef IP_MULTICAST_ALL
+#define IP_MULTICAST_ALL 49
+#endif
+#endif
+
+uvgrtp::multicast::multicast(socket_t socket):
+    socket_(socket)
 {
 }
 
 uvgrtp::multicast::~multicast()
 {
+    for (auto& mreq : groups_)
+        (void)::setsockopt(socket_, IPPROTO_IP, IP_DROP_MEMBERSHIP, (const char *)&mreq, sizeof(mreq));
+}
+
+bool uvgrtp::multicast::is_multicast(const sockaddr_in& addr)
+{
+    return (ntohl(addr.sin_addr.s_addr) & 0xf0000000) == 0xe0000000;
 }
 
-rtp_error_t uvgrtp::multicast::join_multicast(uvgrtp::connection *conn)
+rtp_error_t uvgrtp::multicast::join(const sockaddr_in& group, in_addr iface)
 {
-    (void)conn;
+    if (!is_multicast(group))
+        return RTP_INVALID_VALUE;
+
+    struct ip_mreq mreq;
+
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr = group.sin_addr;
+    mreq.imr_interface = iface;
+
+    if (::setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *)&mreq, sizeof(mreq)) < 0) {
+        log_platform_error("Failed to join the multicast group");
+        return RTP_GENERIC_ERROR;
+    }
+
+#ifdef __linux__
+    /* A socket bound to INADDR_ANY receives the datagrams of every group joined
+     * by any socket on the host if they use the same port, limit it to its own groups */
+    int disabled = 0;
 
+    if (::setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_ALL, &disabled, sizeof(disabled)) < 0)
+        LOG_WARN("Failed to disable IP_MULTICAST_ALL: %s", strerror(errno));
+#endif
+
+    groups_.push_back(mreq);
     return RTP_OK;
 }
 
-rtp_error_t uvgrtp::multicast::leave_multicast(uvgrtp::connection *conn)
+rtp_error_t uvgrtp::multicast::leave(const sockaddr_in& group)
 {
-    (void)conn;
+    for (auto it = groups_.begin(); it != groups_.end(); ++it) {
+        if (it->imr_multiaddr.s_addr != group.sin_addr.s_addr)
+            continue;
+
+        if (::setsockopt(socket_, IPPROTO_IP, IP_DROP_MEMBERSHIP, (const char *)&(*it), sizeof(*it)) < 0)
+            log_platform_error("Failed to leave the multicast group");
+
+        groups_.erase(it);
+        return RTP_OK;
+    }
+
+    return RTP_INVALID_VALUE;
+}
+
+rtp_error_t uvgrtp::multicast::set_ttl(int ttl)
+{
+#ifdef _WIN32
+    DWORD value = (DWORD)ttl;
+#else
+    int value = ttl;
+#endif
+
+    if (::setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, (const char *)&value, sizeof(value)) < 0) {
+        log_platform_error("Failed to set multicast TTL");
+        return RTP_GENERIC_ERROR;
+    }
 
     return RTP_OK;
 }
 
-rtp_error_t uvgrtp::multicast::push_frame_multicast(
-    uvgrtp::connection *sender,
-    uint8_t *data, uint32_t data_len,
-    rtp_format_t fmt, uint32_t timestamp
-)
+rtp_error_t uvgrtp::multicast::set_loop(bool enabled)
 {
-    (void)sender, (void)data, (void)data_len, (void)fmt, (void)timestamp;
+#ifdef _WIN32
+    DWORD value = enabled;
+#else
+    int value = enabled;
+#endif
+
+    if (::setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, (const char *)&value, sizeof(value)) < 0) {
+        log_platform_error("Failed to set multicast loopback");
+        return RTP_GENERIC_ERROR;
+    }
 
     return RTP_OK;
 }
 
-rtp_error_t uvgrtp::multicast::push_frame_multicast(uvgrtp::connection *sender, uvgrtp::frame::rtp_frame *frame)
+rtp_error_t uvgrtp::multicast::set_interface(in_addr iface)
 {
-    (void)sender, (void)frame;
+    if (::setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, (const char *)&iface, sizeof(iface)) < 0) {
+        log_platform_error("Failed to select the multicast interface");
+        return RTP_GENERIC_ERROR;
+    }
 
     return RTP_OK;
 }
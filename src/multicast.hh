@@ -2,35 +2,71 @@
 
 #include "util.hh"
 
-namespace uvgrtp {
-    class connection;
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#endif
 
-    namespace frame {
-        struct rtp_frame;
-    };
+#include <vector>
+
+namespace uvgrtp {
 
     const int MULTICAST_MAX_PEERS = 64;
 
+    /* Default time-to-live of sent multicast datagrams, see RCC_MULTICAST_TTL */
+    const int MULTICAST_DEFAULT_TTL = 1;
+
+    /* IPv4 multicast group membership and send options of one socket
+     *
+     * The groups joined through this object are left when it is destroyed.
+     * Closing the socket leaves the groups too */
     class multicast {
         public:
-           multicast();
-           ~multicast();
+            multicast(socket_t socket);
+            ~multicast();
+
+            /* Return true if "addr" is an IPv4 multicast address (224.0.0.0/4) */
+            static bool is_multicast(const sockaddr_in& addr);
+
+            /* Join "group" on the interface that has the address "iface",
+             * INADDR_ANY lets the kernel select the interface
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "group" is not a multicast address
+             * Return RTP_GENERIC_ERROR if joining failed */
+            rtp_error_t join(const sockaddr_in& group, in_addr iface);
+
+            /* Leave "group"
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if the group has not been joined */
+            rtp_error_t leave(const sockaddr_in& group);
+
+            /* Set the time-to-live of sent multicast datagrams
+             *
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR if setsockopt failed */
+            rtp_error_t set_ttl(int ttl);
 
-           /* Add RTP connection to multicast group */
-           rtp_error_t join_multicast(uvgrtp::connection *conn);
+            /* Select whether sent multicast datagrams are looped back to the local host
+             *
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR if setsockopt failed */
+            rtp_error_t set_loop(bool enabled);
 
-           /* TODO:  */
-           rtp_error_t leave_multicast(uvgrtp::connection *conn);
+            /* Send multicast datagrams through the interface that has the address "iface"
+             *
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR if setsockopt failed */
+            rtp_error_t set_interface(in_addr iface);
 
-           /* TODO:  */
-           rtp_error_t push_frame_multicast(uvgrtp::connection *sender, uvgrtp::frame::rtp_frame *frame);
+        private:
+            socket_t socket_;
 
-           /* TODO:  */
-           rtp_error_t push_frame_multicast(
-                uvgrtp::connection *sender,
-                uint8_t *data, uint32_t data_len,
-                rtp_format_t fmt, uint32_t timestamp
-           );
+            /* groups joined through this object */
+            std::vector<struct ip_mreq> groups_;
     };
 };
 
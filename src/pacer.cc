@@ -0,0 +1,98 @@
+#include "pacer.hh"
+
+#include <algorithm>
+#include <thread>
+
+uvgrtp::pacer::pacer():
+    rate_(0),
+    frame_rate_(0),
+    burst_(PACING_DEFAULT_BURST),
+    fraction_(0),
+    tokens_((double)PACING_DEFAULT_BURST),
+    last_refill_(std::chrono::steady_clock::now()),
+    interval_(0),
+    first_frame_(true)
+{
+}
+
+uvgrtp::pacer::~pacer()
+{
+}
+
+void uvgrtp::pacer::set_rate(uint64_t rate)
+{
+    rate_ = rate / 8;
+}
+
+void uvgrtp::pacer::set_burst(size_t burst)
+{
+    burst_  = burst;
+    tokens_ = std::min(tokens_, (double)burst_);
+}
+
+void uvgrtp::pacer::set_fraction(unsigned fraction)
+{
+    fraction_ = fraction;
+}
+
+bool uvgrtp::pacer::enabled()
+{
+    return rate_ || fraction_;
+}
+
+void uvgrtp::pacer::begin_frame(size_t frame_size)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (!first_frame_) {
+        double elapsed = (double)std::chrono::duration_cast<std::chrono::microseconds>(now - last_frame_).count();
+
+        if (elapsed < PACING_MAX_FRAME_INTERVAL * 1000.0)
+            interval_ = interval_ ? (7 * interval_ + elapsed) / 8 : elapsed;
+    }
+
+    first_frame_ = false;
+    last_frame_  = now;
+    frame_rate_  = rate_;
+
+    /* rate needed to send the frame within "fraction_" percent of the frame interval */
+    if (fraction_ && interval_ > 0) {
+        double window = interval_ * fraction_ / 100.0;
+        frame_rate_   = std::max(frame_rate_, (uint64_t)(frame_size * 1000000.0 / window));
+    }
+}
+
+size_t uvgrtp::pacer::get_burst()
+{
+    return burst_;
+}
+
+void uvgrtp::pacer::refill()
+{
+    auto now     = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_refill_).count();
+
+    tokens_      = std::min((double)burst_, tokens_ + elapsed * (frame_rate_ / 1e9));
+    last_refill_ = now;
+}
+
+void uvgrtp::pacer::wait(size_t bytes)
+{
+    /* the frame interval is not known yet and no minimum rate has been set */
+    if (!frame_rate_)
+        return;
+
+    refill();
+
+    /* a burst larger than the bucket can be sent once the bucket is full */
+    double needed = std::min((double)bytes, (double)burst_);
+
+    if (tokens_ < needed) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(
+            (int64_t)((needed - tokens_) * 1e9 / frame_rate_)
+        ));
+        refill();
+    }
+
+    tokens_ -= (double)bytes;
+}
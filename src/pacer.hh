@@ -0,0 +1,69 @@
+#pragma once
+
+#include "util.hh"
+
+#include <chrono>
+
+namespace uvgrtp {
+
+    /* Default burst size of the pacer in bytes, see RCC_PACING_BURST */
+    const size_t PACING_DEFAULT_BURST = 15000;
+
+    /* Frame intervals longer than this (milliseconds) are considered pauses in
+     * the stream and are not used for estimating the frame interval */
+    const int PACING_MAX_FRAME_INTERVAL = 1000;
+
+    /* Token bucket that spreads the packets of a frame over time
+     *
+     * The bucket is filled at the pacing rate and it holds at most "burst" bytes.
+     * The pacing rate is the larger of the configured rate (RCC_PACING_RATE) and
+     * the rate needed to send the frame in the configured fraction of the frame
+     * interval (RCC_PACING_FRACTION). The frame interval is estimated from the
+     * times the frames are given to the pacer */
+    class pacer {
+        public:
+            pacer();
+            ~pacer();
+
+            /* Set the minimum pacing rate in bits per second, 0 means no minimum */
+            void set_rate(uint64_t rate);
+
+            /* Set the largest number of bytes sent back-to-back */
+            void set_burst(size_t burst);
+
+            /* Set the share (percent) of the frame interval the frame is spread over, 0 means not used */
+            void set_fraction(unsigned fraction);
+
+            /* Return true if a rate or a fraction has been set */
+            bool enabled();
+
+            /* Start pacing a new frame of "frame_size" bytes
+             *
+             * Update the frame interval estimate and select the pacing rate of the frame */
+            void begin_frame(size_t frame_size);
+
+            /* Return the number of bytes that can be sent back-to-back */
+            size_t get_burst();
+
+            /* Block until "bytes" bytes can be sent and consume the tokens */
+            void wait(size_t bytes);
+
+        private:
+            void refill();
+
+            uint64_t rate_;       /* configured rate, bytes per second */
+            uint64_t frame_rate_; /* rate of the current frame, bytes per second */
+            size_t burst_;
+            unsigned fraction_;
+
+            double tokens_;
+            std::chrono::steady_clock::time_point last_refill_;
+
+            /* estimated frame interval in microseconds, 0 if not known yet */
+            double interval_;
+            std::chrono::steady_clock::time_point last_frame_;
+            bool first_frame_;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -1,40 +1,176 @@
 #include "pkt_dispatch.hh"
 
+#include "clock.hh"
 #include "frame.hh"
 #include "socket.hh"
+#include "reactor.hh"
+#include "transport.hh"
+#include "uring.hh"
+#include "xdp.hh"
 #include "debug.hh"
 #include "random.hh"
 #include "util.hh"
 
 #ifdef __linux__
 #include <errno.h>
+#include <netinet/udp.h>
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
 #else
 #define MSG_DONTWAIT 0
 #endif
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 uvgrtp::pkt_dispatcher::pkt_dispatcher():
+    socket_(nullptr),
+    flags_(0),
+    reactor_(nullptr),
+    reactor_thread_(0),
+    path_socket_(nullptr),
+    path_drops_(0),
+    routing_(false),
+    payloads_(),
+    routed_(0),
+    last_expiry_(std::chrono::steady_clock::now()),
+    bundle_(nullptr),
+    busy_poll_(0),
+    arrival_(0),
+    ecn_(0),
+    kernel_drops_(0),
+    recv_batch_(0),
+    slots_(nullptr),
+    own_slots_(nullptr),
     recv_hook_arg_(nullptr),
-    recv_hook_(nullptr)
+    recv_hook_(nullptr),
+    rtcp_handler_arg_(nullptr),
+    rtcp_handler_(nullptr)
 {
 }
 
 uvgrtp::pkt_dispatcher::~pkt_dispatcher()
 {
+    delete own_slots_;
+}
+
+void uvgrtp::pkt_dispatcher::init_slots(int flags)
+{
+    recv_batch_ = (flags & RCE_NO_SYSTEM_CALL_CLUSTERING) ? 1 : RECV_BATCH_SIZE;
+
+    if (reactor_)
+        slots_ = reactor_->get_slots(reactor_thread_);
+
+    if (!slots_)
+        slots_ = own_slots_ = new uvgrtp::recv_slots(recv_batch_);
 }
 
 rtp_error_t uvgrtp::pkt_dispatcher::start(uvgrtp::socket *socket, int flags)
 {
+    socket_ = socket;
+    flags_  = flags;
+    init_slots(flags);
+
+    if (flags & RCE_ADAPTIVE_RCVBUF)
+        rcvbuf_.set_max(RCVBUF_DEFAULT_MAX);
+
     runner_ = new std::thread(&uvgrtp::pkt_dispatcher::runner, this, socket, flags);
     runner_->detach();
     return uvgrtp::runner::start();
 }
 
+rtp_error_t uvgrtp::pkt_dispatcher::start(uvgrtp::socket *socket, int flags, uvgrtp::reactor *reactor, size_t thread)
+{
+    if (!reactor)
+        return start(socket, flags);
+
+    socket_         = socket;
+    flags_          = flags;
+    reactor_        = reactor;
+    reactor_thread_ = thread;
+    init_slots(flags);
+
+    if (flags & RCE_ADAPTIVE_RCVBUF)
+        rcvbuf_.set_max(RCVBUF_DEFAULT_MAX);
+
+    if (socket->get_uring())
+        LOG_WARN("io_uring is not used for receiving when the media stream runs on a reactor");
+
+    /* the dispatcher must be active before the reactor calls drain() for the first time */
+    (void)uvgrtp::runner::start();
+
+    if (reactor->add_source(thread, socket->get_raw_socket(), this, drain_handler) != RTP_OK) {
+        active_ = false;
+        return RTP_GENERIC_ERROR;
+    }
+
+    if (socket->get_xdp() && reactor->add_source(thread, socket->get_xdp()->get_fd(), this, drain_handler) != RTP_OK) {
+        (void)reactor->remove_source((int)socket->get_raw_socket());
+        active_ = false;
+        return RTP_GENERIC_ERROR;
+    }
+
+    if (socket->get_transport() && socket->get_transport()->get_fd() != -1 &&
+        reactor->add_source(thread, socket->get_transport()->get_fd(), this, drain_handler) != RTP_OK) {
+        (void)reactor->remove_source((int)socket->get_raw_socket());
+
+        if (socket->get_xdp())
+            (void)reactor->remove_source(socket->get_xdp()->get_fd());
+
+        active_ = false;
+        return RTP_GENERIC_ERROR;
+    }
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::pkt_dispatcher::start(uvgrtp::pkt_dispatcher *bundle)
+{
+    bundle_ = bundle;
+
+    return uvgrtp::runner::start();
+}
+
 rtp_error_t uvgrtp::pkt_dispatcher::stop()
 {
+    if (bundle_) {
+        bundle_->remove_route(this);
+        bundle_ = nullptr;
+        active_  = false;
+        return RTP_OK;
+    }
+
+    /* when remove_source() returns, drain() is not running and won't be called again */
+    if (reactor_) {
+        (void)reactor_->remove_source((int)socket_->get_raw_socket());
+
+        if (socket_->get_xdp())
+            (void)reactor_->remove_source(socket_->get_xdp()->get_fd());
+
+        if (socket_->get_transport() && socket_->get_transport()->get_fd() != -1)
+            (void)reactor_->remove_source(socket_->get_transport()->get_fd());
+
+        if (path_socket_)
+            (void)reactor_->remove_source((int)path_socket_.load()->get_raw_socket());
+
+        reactor_ = nullptr;
+        active_  = false;
+        return RTP_OK;
+    }
+
     active_ = false;
 
+    /* the io_uring receive does not time out so it must be woken up */
+    if (socket_ && socket_->get_uring())
+        socket_->get_uring()->wake();
+
     while (!exit_mtx_.try_lock())
         ;
 
@@ -56,6 +192,25 @@ rtp_error_t uvgrtp::pkt_dispatcher::install_receive_hook(
     return RTP_OK;
 }
 
+rtp_error_t uvgrtp::pkt_dispatcher::install_rtcp_handler(
+    void *arg,
+    rtp_error_t (*handler)(void *, uint8_t *, size_t)
+)
+{
+    if (!handler)
+        return RTP_INVALID_VALUE;
+
+    rtcp_handler_     = handler;
+    rtcp_handler_arg_ = arg;
+
+    return RTP_OK;
+}
+
+void uvgrtp::pkt_dispatcher::forward_frame(void *arg, uvgrtp::frame::rtp_frame *frame)
+{
+    ((uvgrtp::pkt_dispatcher *)arg)->return_frame(frame);
+}
+
 uvgrtp::frame::rtp_frame *uvgrtp::pkt_dispatcher::pull_frame()
 {
     while (frames_.empty() && this->active())
@@ -90,7 +245,7 @@ uvgrtp::frame::rtp_frame *uvgrtp::pkt_dispatcher::pull_frame(size_t timeout)
     return frame;
 }
 
-uint32_t uvgrtp::pkt_dispatcher::install_handler(uvgrtp::packet_handler handler)
+uint32_t uvgrtp::pkt_dispatcher::install_handler(void *arg, uvgrtp::packet_handler handler)
 {
     uint32_t key;
 
@@ -101,6 +256,7 @@ uint32_t uvgrtp::pkt_dispatcher::install_handler(uvgrtp::packet_handler handler)
         key = uvgrtp::random::generate_32();
     } while (!key || (packet_handlers_.find(key) != packet_handlers_.end()));
 
+    packet_handlers_[key].arg     = arg;
     packet_handlers_[key].primary = handler;
     return key;
 }
@@ -130,6 +286,8 @@ rtp_error_t uvgrtp::pkt_dispatcher::install_aux_handler(
 void uvgrtp::pkt_dispatcher::return_frame(uvgrtp::frame::rtp_frame *frame)
 {
     if (recv_hook_) {
+        /* the receive shards return their frames through this dispatcher from their own threads */
+        std::lock_guard<std::mutex> lock(hook_mtx_);
         recv_hook_(recv_hook_arg_, frame);
     } else {
         frames_mtx_.lock();
@@ -176,6 +334,143 @@ void uvgrtp::pkt_dispatcher::call_aux_handlers(uint32_t key, int flags, uvgrtp::
     }
 }
 
+void uvgrtp::pkt_dispatcher::call_primary_handlers(ssize_t size, void *packet, int flags)
+{
+    rtp_error_t ret;
+    uvgrtp::frame::rtp_frame *frame = nullptr;
+
+    if (routing_) {
+        route_datagram(size, (uint8_t *)packet, flags);
+        return;
+    }
+
+    /* RTCP packet types 192 - 223 overlap RTP payload types 64 - 95 with the marker bit set,
+     * which must not be used when RTCP is multiplexed on the RTP port (RFC 5761, section 4) */
+    if (rtcp_handler_ && size >= 2) {
+        uint8_t *bytes = (uint8_t *)packet;
+
+        if ((bytes[0] >> 6) == 2 && bytes[1] >= 192 && bytes[1] <= 223) {
+            (void)rtcp_handler_(rtcp_handler_arg_, bytes, (size_t)size);
+            return;
+        }
+    }
+
+    for (auto& handler : packet_handlers_) {
+        switch ((ret = (*handler.second.primary)(handler.second.arg, size, packet, flags, &frame))) {
+            /* packet was handled successfully */
+            case RTP_OK:
+                break;
+
+            /* packet was not handled by this primary handlers, proceed to the next one */
+            case RTP_PKT_NOT_HANDLED:
+                continue;
+
+            /* packet was handled by the primary handler
+             * and should be dispatched to the auxiliary handler(s) */
+            case RTP_PKT_MODIFIED:
+                /* the packet has already been received through the other path */
+                if (frame && path_socket_ && dedup_.is_duplicate(frame->header.ssrc, frame->header.seq)) {
+                    (void)uvgrtp::frame::dealloc_frame(frame);
+                    return;
+                }
+
+                if (frame) {
+                    frame->arrival = arrival_ ? arrival_ : uvgrtp::clock::ntp::now();
+                    frame->ecn     = ecn_;
+                }
+                this->call_aux_handlers(handler.first, flags, &frame);
+                break;
+
+            case RTP_GENERIC_ERROR:
+                LOG_DEBUG("Received a corrupted packet!");
+                break;
+
+            default:
+                LOG_ERROR("Unknown error code from packet handler: %d", ret);
+                break;
+        }
+    }
+}
+
+void uvgrtp::pkt_dispatcher::call_primary_handlers(ssize_t size, size_t seg_size, uint8_t *packet, int flags)
+{
+    if (!seg_size || (ssize_t)seg_size >= size) {
+        this->call_primary_handlers(size, packet, flags);
+        return;
+    }
+
+    /* Each segment is processed in place, only the last segment may be shorter than "seg_size" */
+    for (ssize_t offset = 0; offset < size; offset += seg_size)
+        this->call_primary_handlers(std::min((ssize_t)seg_size, size - offset), packet + offset, flags);
+}
+
+#ifdef __linux__
+void uvgrtp::pkt_dispatcher::process_datagram(uint8_t *packet, size_t size, struct msghdr *hdr, int flags,
+                                              std::atomic<uint32_t>& drops)
+{
+    size_t seg_size = size;
+
+    arrival_ = 0;
+    ecn_     = 0;
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(hdr); cm; cm = CMSG_NXTHDR(hdr, cm)) {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            seg_size = *((int *)CMSG_DATA(cm));
+        } else if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+
+            memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+            arrival_ = uvgrtp::clock::ntp::from_unix(ts.tv_sec, ts.tv_nsec);
+        } else if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t count;
+
+            memcpy(&count, CMSG_DATA(cm), sizeof(count));
+            drops = count;
+        } else if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_TOS) {
+            ecn_ = *CMSG_DATA(cm) & 0x3;
+        }
+    }
+
+    this->call_primary_handlers(size, seg_size, packet, flags);
+}
+
+rtp_error_t uvgrtp::pkt_dispatcher::uring_runner(uvgrtp::uring *uring, int flags)
+{
+    rtp_error_t ret;
+    size_t ndgrams = 0;
+    uvgrtp::uring_datagram dgrams[RECV_BATCH_SIZE];
+
+    if ((ret = uring->start_recv(RECV_CONTROL_SIZE)) != RTP_OK)
+        return ret;
+
+    while (this->active()) {
+        if ((ret = uring->recv(dgrams, RECV_BATCH_SIZE, &ndgrams)) == RTP_INTERRUPTED)
+            continue;
+
+        if (ret != RTP_OK)
+            return ret;
+
+        size_t nbytes = 0;
+
+        for (size_t i = 0; i < ndgrams; ++i) {
+            struct msghdr hdr;
+
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_control    = dgrams[i].control;
+            hdr.msg_controllen = dgrams[i].controllen;
+
+            this->process_datagram(dgrams[i].data, dgrams[i].len, &hdr, flags, kernel_drops_);
+            nbytes += dgrams[i].len;
+        }
+
+        uring->release(dgrams, ndgrams);
+        rcvbuf_.update(socket_, nbytes, kernel_drops_);
+    }
+
+    return RTP_OK;
+}
+#endif
+
 /* The point of packet dispatcher is to provide much-needed isolation between different layers
  * of uvgRTP. For example, HEVC handler should not concern itself with RTP packet validation
  * because that should be a global operation done for all packets.
@@ -214,15 +509,8 @@ void uvgrtp::pkt_dispatcher::call_aux_handlers(uint32_t key, int flags, uvgrtp::
  * the "out" parameter because at that point it already contains all needed information. */
 void uvgrtp::pkt_dispatcher::runner(uvgrtp::socket *socket, int flags)
 {
-    int nread;
     fd_set read_fds;
-    rtp_error_t ret;
     struct timeval t_val;
-    uvgrtp::frame::rtp_frame *frame;
-    
-    // stack size isn't enough for this so we allocate temporary memory for it from heap
-    const size_t recv_buffer_len = 0xffff - IPV4_HDR_SIZE - UDP_HDR_SIZE;
-    uint8_t* recv_buffer = new uint8_t[recv_buffer_len];
 
     FD_ZERO(&read_fds);
 
@@ -231,57 +519,424 @@ void uvgrtp::pkt_dispatcher::runner(uvgrtp::socket *socket, int flags)
 
     exit_mtx_.lock();
 
+    /* The datagrams that a transport carries arrive through it and the rest through the socket */
+    int transport_fd = socket->get_transport() ? socket->get_transport()->get_fd() : -1;
+
+#ifdef __linux__
+    /* If io_uring is enabled, datagrams are received through it and the select-based
+     * receive loop below is used only if the kernel does not support multishot receive */
+    if (socket->get_uring() && !socket->get_xdp() && !socket->get_transport() &&
+        this->uring_runner(socket->get_uring(), flags) != RTP_OK)
+        LOG_WARN("Cannot receive datagrams using io_uring, using regular system calls");
+
+    /* With AF_XDP, the datagrams steered by the XDP program arrive to the AF_XDP socket
+     * and the rest to the regular socket so both of them must be polled */
+    int xdp_fd = socket->get_xdp() ? socket->get_xdp()->get_fd() : -1;
+#else
+    (void)flags;
+    int xdp_fd = -1;
+#endif
+
     while (this->active()) {
         /* reset state before each call */
         t_val.tv_sec  = 0;
         t_val.tv_usec = 1500;
         FD_SET(socket->get_raw_socket(), &read_fds);
 
-        int sret = ::select((int)socket->get_raw_socket() + 1, &read_fds, nullptr, nullptr, &t_val);
+        if (xdp_fd != -1)
+            FD_SET(xdp_fd, &read_fds);
+
+        if (transport_fd != -1)
+            FD_SET(transport_fd, &read_fds);
+
+        uvgrtp::socket *path = path_socket_;
+        int path_fd          = path ? (int)path->get_raw_socket() : -1;
+
+        if (path_fd != -1)
+            FD_SET(path_fd, &read_fds);
+
+        int nfds = std::max({ (int)socket->get_raw_socket(), xdp_fd, transport_fd, path_fd }) + 1;
+        int sret = ::select(nfds, &read_fds, nullptr, nullptr, &t_val);
 
         if (sret < 0) {
             log_platform_error("select(2) failed");
             break;
         }
 
-        do {
-            if ((ret = socket->recvfrom(recv_buffer, recv_buffer_len, MSG_DONTWAIT, &nread)) == RTP_INTERRUPTED)
+        /* Keep polling without blocking while datagrams keep arriving within the busy poll
+         * budget, this avoids the wake-up latency of select() for back-to-back packets */
+        uint32_t budget = busy_poll_;
+
+        if (this->drain() && budget) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(budget);
+
+            while (this->active() && std::chrono::steady_clock::now() < deadline) {
+                if (this->drain())
+                    deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(budget);
+            }
+        }
+    }
+    exit_mtx_.unlock();
+}
+
+void uvgrtp::pkt_dispatcher::drain_handler(void *arg)
+{
+    ((uvgrtp::pkt_dispatcher *)arg)->drain();
+}
+
+void uvgrtp::pkt_dispatcher::set_busy_poll(uint32_t budget)
+{
+    busy_poll_ = budget;
+}
+
+void uvgrtp::pkt_dispatcher::set_rcvbuf_max(size_t max_size)
+{
+    rcvbuf_.set_max(max_size);
+}
+
+uint32_t uvgrtp::pkt_dispatcher::get_kernel_drops()
+{
+    return kernel_drops_ + path_drops_;
+}
+
+rtp_error_t uvgrtp::pkt_dispatcher::add_redundant_path(uvgrtp::socket *socket)
+{
+    if (path_socket_)
+        return RTP_INITIALIZED;
+
+    path_socket_ = socket;
+
+    if (reactor_ && reactor_->add_source(reactor_thread_, socket->get_raw_socket(), this, drain_handler) != RTP_OK) {
+        path_socket_ = nullptr;
+        return RTP_GENERIC_ERROR;
+    }
+
+    return RTP_OK;
+}
+
+uint64_t uvgrtp::pkt_dispatcher::get_duplicates()
+{
+    return dedup_.get_duplicates();
+}
+
+rtp_error_t uvgrtp::pkt_dispatcher::set_route(
+    uvgrtp::pkt_dispatcher *member,
+    uint32_t local_ssrc,
+    uint8_t payload,
+    uint32_t remote_ssrc
+)
+{
+    if (!member || payload > 0x7f)
+        return RTP_INVALID_VALUE;
+
+    std::lock_guard<std::mutex> lock(routes_mtx_);
+
+    /* overwriting the route would silently take all packets of the other media stream */
+    if (!remote_ssrc && payloads_[payload] && payloads_[payload] != member)
+        return RTP_INITIALIZED;
+
+    erase_routes(member);
+
+    local_ssrcs_[local_ssrc] = member;
+
+    /* streams of the same payload type are told apart by the SSRCs of their senders */
+    if (remote_ssrc) {
+        remote_ssrcs_[remote_ssrc] = member;
+        learned_ssrcs_.erase(remote_ssrc);
+    } else {
+        payloads_[payload] = member;
+    }
+
+    routing_ = true;
+    return RTP_OK;
+}
+
+void uvgrtp::pkt_dispatcher::remove_route(uvgrtp::pkt_dispatcher *member)
+{
+    std::lock_guard<std::mutex> lock(routes_mtx_);
+
+    erase_routes(member);
+}
+
+void uvgrtp::pkt_dispatcher::erase_routes(uvgrtp::pkt_dispatcher *member)
+{
+    for (auto *table : { &remote_ssrcs_, &local_ssrcs_ }) {
+        for (auto it = table->begin(); it != table->end(); ) {
+            if (it->second == member)
+                it = table->erase(it);
+            else
+                ++it;
+        }
+    }
+
+    for (auto it = learned_ssrcs_.begin(); it != learned_ssrcs_.end(); ) {
+        if (it->second.member == member)
+            it = learned_ssrcs_.erase(it);
+        else
+            ++it;
+    }
+
+    for (auto& route : payloads_) {
+        if (route == member)
+            route = nullptr;
+    }
+}
+
+uvgrtp::pkt_dispatcher *uvgrtp::pkt_dispatcher::find_remote_ssrc(uint32_t ssrc)
+{
+    auto it = remote_ssrcs_.find(ssrc);
+
+    if (it != remote_ssrcs_.end())
+        return it->second;
+
+    auto learned = learned_ssrcs_.find(ssrc);
+
+    if (learned == learned_ssrcs_.end())
+        return nullptr;
+
+    learned->second.seen = true;
+    return learned->second.member;
+}
+
+void uvgrtp::pkt_dispatcher::learn_ssrc(uint32_t ssrc, uvgrtp::pkt_dispatcher *member)
+{
+    /* a full table is expired only as often as usual so that a flood of new SSRCs does not
+     * make the active senders look silent */
+    if (learned_ssrcs_.size() >= BUNDLE_MAX_LEARNED_SSRCS &&
+        std::chrono::steady_clock::now() - last_expiry_ >= std::chrono::seconds(BUNDLE_SSRC_TIMEOUT))
+        expire_ssrcs();
+
+    /* the packet is still routed by its payload type, only its RTCP is not */
+    if (learned_ssrcs_.size() >= BUNDLE_MAX_LEARNED_SSRCS) {
+        LOG_DEBUG("Too many senders in the bundle, not remembering SSRC 0x%x", ssrc);
+        return;
+    }
+
+    learned_ssrcs_[ssrc] = { member, true };
+}
+
+void uvgrtp::pkt_dispatcher::expire_ssrcs()
+{
+    for (auto it = learned_ssrcs_.begin(); it != learned_ssrcs_.end(); ) {
+        if (!it->second.seen) {
+            it = learned_ssrcs_.erase(it);
+        } else {
+            it->second.seen = false;
+            ++it;
+        }
+    }
+
+    last_expiry_ = std::chrono::steady_clock::now();
+}
+
+void uvgrtp::pkt_dispatcher::forget_ssrcs(uint8_t *packet, size_t size)
+{
+    /* walk the packets of the compound RTCP packet, the length is in 32-bit words minus one */
+    for (size_t off = 0; off + 4 <= size; ) {
+        size_t len = ((size_t)ntohs(*(uint16_t *)&packet[off + 2]) + 1) * 4;
+
+        if ((packet[off] >> 6) != 2 || off + len > size)
+            break;
+
+        if (packet[off + 1] == uvgrtp::frame::RTCP_FT_BYE) {
+            for (size_t i = 0; i < (size_t)(packet[off] & 0x1f) && (i + 2) * 4 <= len; ++i)
+                learned_ssrcs_.erase(ntohl(*(uint32_t *)&packet[off + (i + 1) * 4]));
+        }
+
+        off += len;
+    }
+}
+
+void uvgrtp::pkt_dispatcher::route_datagram(ssize_t size, uint8_t *packet, int flags)
+{
+    /* RTP and RTCP headers are both at least 8 bytes, ZRTP and other protocols are not routed */
+    if (size < 8 || (packet[0] >> 6) != 2) {
+        LOG_DEBUG("Dropping a datagram that is not RTP or RTCP");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(routes_mtx_);
+
+    uvgrtp::pkt_dispatcher *member = nullptr;
+    uint32_t ssrc                  = ntohl(*(uint32_t *)&packet[4]);
+
+    if (packet[1] >= 192 && packet[1] <= 223) {
+        /* RTCP: the sender SSRC follows the header. A packet of an unknown sender is routed by
+         * the SSRC of its first report block, which follows the sender info in an SR, or by
+         * the SSRC of the media source of a feedback message */
+        ssize_t block_off = 0;
+
+        switch (packet[1]) {
+            case uvgrtp::frame::RTCP_FT_SR:
+                block_off = (packet[0] & 0x1f) ? 28 : 0;
+                break;
+
+            case uvgrtp::frame::RTCP_FT_RR:
+                block_off = (packet[0] & 0x1f) ? 8 : 0;
                 break;
 
-            if (ret != RTP_OK) {
-                LOG_ERROR("recvfrom(2) failed! Packet dispatcher cannot continue %d!", ret);
+            case uvgrtp::frame::RTCP_FT_RTPFB:
+            case uvgrtp::frame::RTCP_FT_PSFB:
+                block_off = 8;
                 break;
+        }
+
+        if (!(member = find_remote_ssrc(ssrc)) && block_off && size >= block_off + 4) {
+            auto it = local_ssrcs_.find(ntohl(*(uint32_t *)&packet[block_off]));
+
+            if (it != local_ssrcs_.end())
+                member = it->second;
+        }
+    } else if (size >= 12) {
+        ssrc = ntohl(*(uint32_t *)&packet[8]);
+
+        if (!(member = find_remote_ssrc(ssrc)) && (member = payloads_[packet[1] & 0x7f]))
+            learn_ssrc(ssrc, member);
+
+        /* the clock is read only now and then, the senders that have been silent for
+         * a whole expiry interval are forgotten */
+        if (!(++routed_ % BUNDLE_EXPIRY_CHECK) &&
+            std::chrono::steady_clock::now() - last_expiry_ >= std::chrono::seconds(BUNDLE_SSRC_TIMEOUT))
+            expire_ssrcs();
+    }
+
+    if (!member) {
+        LOG_DEBUG("No bundled media stream for SSRC 0x%x, dropping the datagram", ssrc);
+        return;
+    }
+
+    member->arrival_ = arrival_;
+    member->ecn_     = ecn_;
+    member->call_primary_handlers(size, packet, flags);
+
+    /* the member has processed the BYE, the sender won't send anything anymore */
+    if (packet[1] >= 192 && packet[1] <= 223)
+        forget_ssrcs(packet, (size_t)size);
+}
+
+size_t uvgrtp::pkt_dispatcher::drain()
+{
+    size_t ndrained = 0;
+    size_t nbytes   = 0;
+
+    if (socket_->get_transport()) {
+        uvgrtp::transport *transport = socket_->get_transport();
+        uvgrtp::transport_datagram dgrams[RECV_BATCH_SIZE];
+        size_t ndgrams = 0;
+
+        /* there are no kernel timestamps, the clock is read when the datagram is processed */
+        arrival_ = 0;
+        ecn_     = 0;
+
+        /* The datagrams are processed in place. The transport must be read until it is empty
+         * because only then it knows that the dispatcher is going to wait for its descriptor */
+        while (transport->recv(dgrams, recv_batch_, &ndgrams) == RTP_OK) {
+            for (size_t i = 0; i < ndgrams; ++i) {
+                if (dgrams[i].len)
+                    this->call_primary_handlers(dgrams[i].len, dgrams[i].data, flags_);
             }
+            transport->release(ndgrams);
+            ndrained += ndgrams;
+        }
+    }
 
-            for (auto& handler : packet_handlers_) {
-                switch ((ret = (*handler.second.primary)(nread, recv_buffer, flags, &frame))) {
-                    /* packet was handled successfully */
-                    case RTP_OK:
-                        break;
-
-                    /* packet was not handled by this primary handlers, proceed to the next one */
-                    case RTP_PKT_NOT_HANDLED:
-                        continue;
-
-                    /* packet was handled by the primary handler
-                     * and should be dispatched to the auxiliary handler(s) */
-                    case RTP_PKT_MODIFIED:
-                        this->call_aux_handlers(handler.first, flags, &frame);
-                        break;
-
-                    case RTP_GENERIC_ERROR:
-                        LOG_DEBUG("Received a corrupted packet!");
-                        break;
-
-                    default:
-                        LOG_ERROR("Unknown error code from packet handler: %d", ret);
-                        break;
-                }
+#ifdef __linux__
+    /* zero-copy completions in the error queue keep the socket readable */
+    socket_->reap_zerocopy();
+
+    if (socket_->get_xdp()) {
+        uvgrtp::xdp *xdp = socket_->get_xdp();
+        uvgrtp::xdp_datagram dgrams[RECV_BATCH_SIZE];
+        size_t ndgrams = 0;
+
+        /* the datagrams are processed in place in UMEM */
+        while (xdp->recv(dgrams, recv_batch_, &ndgrams) == RTP_OK) {
+            for (size_t i = 0; i < ndgrams; ++i) {
+                if (dgrams[i].len)
+                    this->call_primary_handlers(dgrams[i].len, dgrams[i].data, flags_);
             }
-        } while (ret == RTP_OK);
+            xdp->release(ndgrams);
+            ndrained += ndgrams;
+
+            if (ndgrams < recv_batch_)
+                break;
+        }
     }
-    exit_mtx_.unlock();
+#endif
 
-    delete[] recv_buffer;
+    ndrained += this->drain_socket(socket_, kernel_drops_, nbytes);
+
+    /* the receive buffer of the redundant path is not tuned */
+    if (uvgrtp::socket *path = path_socket_) {
+        size_t path_bytes = 0;
+        ndrained += this->drain_socket(path, path_drops_, path_bytes);
+    }
+
+    /* the datagrams read at once were queued in the socket, i.e., "nbytes" is the burst the buffer had to hold */
+    rcvbuf_.update(socket_, nbytes, kernel_drops_);
+
+    return ndrained;
+}
+
+size_t uvgrtp::pkt_dispatcher::drain_socket(uvgrtp::socket *socket, std::atomic<uint32_t>& drops, size_t& nbytes)
+{
+    rtp_error_t ret;
+    size_t ndrained = 0;
+    size_t batch    = std::min(recv_batch_, slots_->batch);
+
+#ifdef __linux__
+    struct mmsghdr *headers = slots_->headers;
+
+    /* Drain the socket one batch at a time. A short batch means that the socket
+     * receive queue is empty and we can go back to waiting for new datagrams */
+    for (;;) {
+        int npkts = 0;
+
+        /* the kernel overwrites the length of the ancillary data buffer, reset it */
+        for (size_t i = 0; i < batch; ++i) {
+            headers[i].msg_hdr.msg_control    = slots_->control + i * RECV_CONTROL_SIZE;
+            headers[i].msg_hdr.msg_controllen = RECV_CONTROL_SIZE;
+        }
+
+        if ((ret = socket->recvmmsg(headers, (unsigned)batch, MSG_DONTWAIT, &npkts)) == RTP_INTERRUPTED)
+            break;
+
+        if (ret != RTP_OK) {
+            LOG_ERROR("recvmmsg(2) failed! Packet dispatcher cannot continue %d!", ret);
+            break;
+        }
+
+        for (int i = 0; i < npkts; ++i) {
+            this->process_datagram((uint8_t *)slots_->chunks[i].iov_base, headers[i].msg_len,
+                                   &headers[i].msg_hdr, flags_, drops);
+            nbytes += headers[i].msg_len;
+        }
+
+        ndrained += npkts;
+
+        if ((size_t)npkts < batch)
+            break;
+    }
+#else
+    int nread;
+
+    (void)drops;
+    (void)batch;
+
+    for (;;) {
+        if ((ret = socket->recvfrom(slots_->buffer, slots_->len, MSG_DONTWAIT, &nread)) == RTP_INTERRUPTED)
+            break;
+
+        if (ret != RTP_OK) {
+            LOG_ERROR("recvfrom(2) failed! Packet dispatcher cannot continue %d!", ret);
+            break;
+        }
+
+        this->call_primary_handlers(nread, slots_->buffer, flags_);
+        nbytes += nread;
+        ++ndrained;
+    }
+#endif
 
+    return ndrained;
 }
@@ -1,13 +1,22 @@
 #pragma once
 
+#include "dedup.hh"
+#include "rcvbuf.hh"
+#include "recv_slots.hh"
 #include "runner.hh"
 
 #include "util.hh"
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
 
+#ifdef __linux__
+struct msghdr;
+#endif
+
 namespace uvgrtp {
 
     namespace frame {
@@ -15,8 +24,18 @@ namespace uvgrtp {
     };
 
     class socket;
+    class uring;
+    class reactor;
+
+    /* How many SSRCs of senders routed by payload type a bundle remembers at most, see set_route()
+     * and for how long, in seconds, a sender can be silent before it is forgotten. The clock is
+     * read once per BUNDLE_EXPIRY_CHECK routed RTP packets, so a silent sender is forgotten after
+     * one to two timeouts */
+    const size_t BUNDLE_MAX_LEARNED_SSRCS = 4096;
+    const int    BUNDLE_SSRC_TIMEOUT      = 30;
+    const size_t BUNDLE_EXPIRY_CHECK      = 1024;
 
-    typedef rtp_error_t (*packet_handler)(ssize_t, void *, int, uvgrtp::frame::rtp_frame **);
+    typedef rtp_error_t (*packet_handler)(void *, ssize_t, void *, int, uvgrtp::frame::rtp_frame **);
     typedef rtp_error_t (*packet_handler_aux)(void *, int, uvgrtp::frame::rtp_frame **);
     typedef rtp_error_t (*frame_getter)(void *, uvgrtp::frame::rtp_frame **);
 
@@ -27,6 +46,7 @@ namespace uvgrtp {
     };
 
     struct packet_handlers {
+        void *arg = nullptr;
         packet_handler primary = nullptr;
         std::vector<auxiliary_handler> auxiliary;
     };
@@ -44,9 +64,11 @@ namespace uvgrtp {
              * It is also responsible for validating the packet on a high level
              * (ZRTP checksum/RTP version etc) before passing it onto other handlers.
              *
+             * "arg" is passed to the handler, e.g., the frame pool of the media stream
+             *
              * Return a key on success that differentiates primary packet handlers
              * Return 0 "handler" is nullptr */
-            uint32_t install_handler(packet_handler handler);
+            uint32_t install_handler(void *arg, packet_handler handler);
 
             /* Install auxiliary handler for the packet
              *
@@ -65,17 +87,50 @@ namespace uvgrtp {
             rtp_error_t install_aux_handler(uint32_t key, void *arg, packet_handler_aux handler, frame_getter getter);
 
             /* Install receive hook for the RTP packet dispatcher
+             *
+             * The calls of the hook are serialized, so the hook is never called concurrently
+             * even if frames are returned by several receive shards, see forward_frame()
              *
              * Return RTP_OK on success
              * Return RTP_INVALID_VALUE if "hook" is nullptr */
             rtp_error_t install_receive_hook(void *arg, void (*hook)(void *, uvgrtp::frame::rtp_frame *));
 
+            /* Receive hook that returns "frame" to user through the dispatcher "arg"
+             *
+             * This is used to return the frames of a receive shard through the dispatcher of the media stream */
+            static void forward_frame(void *arg, uvgrtp::frame::rtp_frame *frame);
+
+            /* Install handler for the RTCP packets multiplexed on the RTP socket (RFC 5761)
+             *
+             * Packets whose second byte is an RTCP packet type (192 - 223) are passed to "handler"
+             * instead of the primary handlers, see RCE_RTCP_MUX
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "handler" is nullptr */
+            rtp_error_t install_rtcp_handler(void *arg, rtp_error_t (*handler)(void *, uint8_t *, size_t));
+
             /* Start the RTP packet dispatcher
              *
              * Return RTP_OK on success
              * Return RTP_MEMORY_ERROR if allocation of a thread object fails */
             rtp_error_t start(uvgrtp::socket *socket, int flags);
 
+            /* Start the RTP packet dispatcher on reactor thread "thread" instead of its own thread
+             *
+             * If "reactor" is nullptr, this is the same as start(socket, flags)
+             *
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR if the socket could not be added to the reactor */
+            rtp_error_t start(uvgrtp::socket *socket, int flags, uvgrtp::reactor *reactor, size_t thread);
+
+            /* Process the datagrams routed to this dispatcher by the dispatcher "bundle"
+             * instead of receiving from a socket, see set_route()
+             *
+             * The dispatcher has no receive loop of its own and stop() removes its route
+             *
+             * Return RTP_OK on success */
+            rtp_error_t start(uvgrtp::pkt_dispatcher *bundle);
+
             /* Stop the RTP packet dispatcher and wait until the receive loop is exited
              * to make sure that destroying the object in media_stream.cc is safe
              *
@@ -93,13 +148,127 @@ namespace uvgrtp {
             uvgrtp::frame::rtp_frame *pull_frame();
             uvgrtp::frame::rtp_frame *pull_frame(size_t ms);
 
+            /* Receive and process all datagrams that can be read from the socket without blocking
+             *
+             * Return the number of datagrams processed */
+            size_t drain();
+
+            /* Set the busy poll budget in microseconds, 0 disables busy polling
+             *
+             * After receiving datagrams, the dispatcher thread keeps polling the socket
+             * without blocking until no datagram has been received for "budget" microseconds.
+             * Not used if the dispatcher runs on a reactor or receives through io_uring */
+            void set_busy_poll(uint32_t budget);
+
+            /* Set the upper limit of the socket receive buffer, 0 disables growing the buffer
+             *
+             * The receive buffer is grown based on the observed bitrate, the burst size and
+             * the datagrams dropped by the kernel, see rcvbuf_tuner */
+            void set_rcvbuf_max(size_t max_size);
+
+            /* Return the number of datagrams the kernel has dropped on the sockets (SO_RXQ_OVFL)
+             *
+             * The counter is updated only when a datagram is received */
+            uint32_t get_kernel_drops();
+
+            /* Receive also from "socket", the socket of a redundant path of the media stream
+             *
+             * The datagrams of both sockets are processed by the same handlers and an RTP packet
+             * that has already been received through the other path is dropped before the
+             * auxiliary handlers, i.e., before RTCP statistics and frame reassembly
+             *
+             * Return RTP_OK on success
+             * Return RTP_INITIALIZED if the dispatcher already has a redundant path
+             * Return RTP_GENERIC_ERROR if the socket could not be added to the reactor */
+            rtp_error_t add_redundant_path(uvgrtp::socket *socket);
+
+            /* Return the number of duplicate RTP packets dropped, see add_redundant_path() */
+            uint64_t get_duplicates();
+
+            /* Route the datagrams received by this dispatcher to the dispatcher "member"
+             * of a media stream sharing the socket, see RCE_BUNDLE
+             *
+             * RTP packets are routed by their SSRC if it is "remote_ssrc", or by their payload
+             * type if "remote_ssrc" is 0. The SSRC of a packet routed by payload type is remembered
+             * so that the RTCP packets of that sender are routed to "member" too, until the sender
+             * sends an RTCP BYE or has been silent for BUNDLE_SSRC_TIMEOUT seconds. At most
+             * BUNDLE_MAX_LEARNED_SSRCS SSRCs are remembered. RTCP packets of
+             * unknown senders are routed by the SSRC of the first report block of an SR or RR or
+             * the media source of an RTPFB or PSFB, i.e., "local_ssrc". Datagrams that match no
+             * route are dropped.
+             * Calling this again for the same "member" replaces its route
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "member" is nullptr or the payload type is not valid
+             * Return RTP_INITIALIZED if "remote_ssrc" is 0 and the payload type is routed to
+             * another member. The routes are not changed */
+            rtp_error_t set_route(uvgrtp::pkt_dispatcher *member, uint32_t local_ssrc, uint8_t payload, uint32_t remote_ssrc);
+
+            /* Remove the route of "member"
+             *
+             * When this returns, "member" is not processing a routed datagram and won't be given one */
+            void remove_route(uvgrtp::pkt_dispatcher *member);
+
         private:
             /* RTP packet dispatcher thread */
             void runner(uvgrtp::socket *socket, int flags);
 
+            /* Reactor calls this when the socket is readable, "arg" is the dispatcher */
+            static void drain_handler(void *arg);
+
+            /* Allocate the receive slots used by drain() or use the slots of the reactor thread */
+            void init_slots(int flags);
+
             /* Return a processed RTP frame to user either through frame queue or receive hook */
             void return_frame(uvgrtp::frame::rtp_frame *frame);
 
+            /* Call primary handlers for a received datagram and the auxiliary
+             * handlers of the primary handler that processed the datagram */
+            void call_primary_handlers(ssize_t size, void *packet, int flags);
+
+            /* Give a datagram to the dispatcher of the bundled media stream it belongs to, see set_route() */
+            void route_datagram(ssize_t size, uint8_t *packet, int flags);
+
+            /* Remove all routes to "member", called with "routes_mtx_" held */
+            void erase_routes(uvgrtp::pkt_dispatcher *member);
+
+            /* Return the member of the configured or learned SSRC "ssrc", nullptr if there is none.
+             * These are called with "routes_mtx_" held */
+            uvgrtp::pkt_dispatcher *find_remote_ssrc(uint32_t ssrc);
+
+            /* Remember that "ssrc" was routed to "member" by payload type */
+            void learn_ssrc(uint32_t ssrc, uvgrtp::pkt_dispatcher *member);
+
+            /* Forget the learned SSRCs that have not been seen since the previous call */
+            void expire_ssrcs();
+
+            /* Forget the learned SSRCs of the BYE packets of a compound RTCP packet */
+            void forget_ssrcs(uint8_t *packet, size_t size);
+
+            /* Split a coalesced datagram into segments of "seg_size" bytes
+             * and call the primary handlers for each segment (UDP GRO) */
+            void call_primary_handlers(ssize_t size, size_t seg_size, uint8_t *packet, int flags);
+
+#ifdef __linux__
+            /* Parse the ancillary data of a received datagram and call the primary handlers for it
+             *
+             * "drops" is the kernel drop counter of the socket the datagram was received from */
+            void process_datagram(uint8_t *packet, size_t size, struct msghdr *hdr, int flags,
+                                  std::atomic<uint32_t>& drops);
+
+            /* Receive datagrams through the io_uring backend of the socket until the dispatcher is stopped
+             *
+             * Return RTP_OK if the dispatcher was stopped
+             * Return RTP_NOT_SUPPORTED if io_uring cannot be used for receiving */
+            rtp_error_t uring_runner(uvgrtp::uring *uring, int flags);
+#endif
+
+            /* Receive and process the datagrams of "socket" until it has no more datagrams
+             *
+             * "nbytes" is increased by the number of bytes received.
+             * Return the number of datagrams processed */
+            size_t drain_socket(uvgrtp::socket *socket, std::atomic<uint32_t>& drops, size_t& nbytes);
+
             /* Call auxiliary handlers of a primary handler */
             void call_aux_handlers(uint32_t key, int flags, uvgrtp::frame::rtp_frame **frame);
 
@@ -112,8 +281,75 @@ namespace uvgrtp {
             std::mutex frames_mtx_;
             std::mutex exit_mtx_;
 
+            /* Socket the dispatcher is receiving from */
+            uvgrtp::socket *socket_;
+            int flags_;
+
+            /* Reactor the dispatcher is running on and the reactor thread,
+             * nullptr if the dispatcher has its own thread */
+            uvgrtp::reactor *reactor_;
+            size_t reactor_thread_;
+
+            /* Socket of the redundant path and its kernel drop counter, see add_redundant_path() */
+            std::atomic<uvgrtp::socket *> path_socket_;
+            std::atomic<uint32_t> path_drops_;
+
+            /* Duplicates received through the redundant path. Used only by the receiving thread */
+            dedup_filter dedup_;
+
+            /* Routes to the dispatchers of bundled media streams, see set_route(). "routes_mtx_"
+             * is held while a routed datagram is processed so that a route can be removed safely */
+            std::atomic<bool> routing_;
+            std::mutex routes_mtx_;
+            std::unordered_map<uint32_t, uvgrtp::pkt_dispatcher *> remote_ssrcs_;
+            std::unordered_map<uint32_t, uvgrtp::pkt_dispatcher *> local_ssrcs_;
+            uvgrtp::pkt_dispatcher *payloads_[128];
+
+            /* SSRCs learned from the packets routed by payload type. "seen" is cleared by
+             * expire_ssrcs() and set again when the sender sends something */
+            struct learned_ssrc {
+                uvgrtp::pkt_dispatcher *member;
+                bool seen;
+            };
+            std::unordered_map<uint32_t, learned_ssrc> learned_ssrcs_;
+
+            /* RTP packets routed and the time of the previous expiry, see expire_ssrcs() */
+            size_t routed_;
+            std::chrono::steady_clock::time_point last_expiry_;
+
+            /* Dispatcher that routes datagrams to this one, nullptr if this dispatcher receives itself */
+            uvgrtp::pkt_dispatcher *bundle_;
+
+            /* Busy poll budget in microseconds, see set_busy_poll() */
+            std::atomic<uint32_t> busy_poll_;
+
+            /* Kernel receive timestamp (NTP) of the datagram being processed,
+             * 0 if it is not available and the clock must be read instead */
+            uint64_t arrival_;
+
+            /* ECN codepoint of the datagram being processed (IP_RECVTOS), see RCE_ECN */
+            uint8_t ecn_;
+
+            /* Kernel drop counter of the socket, see get_kernel_drops() */
+            std::atomic<uint32_t> kernel_drops_;
+
+            rcvbuf_tuner rcvbuf_;
+
+            /* Receive slots used by drain(), either "own_slots_" or the slots of the reactor thread.
+             * "recv_batch_" datagrams are read at once, see RCE_NO_SYSTEM_CALL_CLUSTERING */
+            size_t recv_batch_;
+            uvgrtp::recv_slots *slots_;
+            uvgrtp::recv_slots *own_slots_;
+
             void *recv_hook_arg_;
             void (*recv_hook_)(void *arg, uvgrtp::frame::rtp_frame *frame);
+
+            /* Held while the receive hook is called, see install_receive_hook() */
+            std::mutex hook_mtx_;
+
+            /* RTCP packets multiplexed on the RTP socket, see install_rtcp_handler() */
+            void *rtcp_handler_arg_;
+            rtp_error_t (*rtcp_handler_)(void *arg, uint8_t *packet, size_t size);
     };
 }
 
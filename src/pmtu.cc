@@ -0,0 +1,116 @@
+#include "pmtu.hh"
+
+#include "debug.hh"
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+uvgrtp::pmtu::pmtu():
+    socket_(-1),
+    mtu_(0),
+    exceeded_(false),
+    last_query_(std::chrono::steady_clock::now())
+{
+}
+
+uvgrtp::pmtu::~pmtu()
+{
+#ifdef __linux__
+    if (socket_ != -1)
+        close(socket_);
+#endif
+}
+
+#ifdef __linux__
+rtp_error_t uvgrtp::pmtu::init(socket_t socket, sockaddr_in& remote)
+{
+    rtp_error_t ret;
+    int discover = IP_PMTUDISC_DO;
+
+    if (::setsockopt(socket, IPPROTO_IP, IP_MTU_DISCOVER, &discover, sizeof(discover)) < 0) {
+        LOG_WARN("Failed to set IP_MTU_DISCOVER: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    if ((socket_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0) {
+        log_platform_error("Failed to create the path MTU socket");
+        return RTP_GENERIC_ERROR;
+    }
+
+    /* connecting a UDP socket only selects the route, no packets are sent */
+    if (::connect(socket_, (const struct sockaddr *)&remote, sizeof(remote)) < 0) {
+        log_platform_error("Failed to connect the path MTU socket");
+        return RTP_GENERIC_ERROR;
+    }
+
+    if ((ret = query(&mtu_)) != RTP_OK)
+        return ret;
+
+    LOG_DEBUG("Path MTU is %zu bytes", mtu_);
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::pmtu::query(size_t *mtu)
+{
+    int value         = 0;
+    socklen_t opt_len = sizeof(value);
+
+    if (::getsockopt(socket_, IPPROTO_IP, IP_MTU, &value, &opt_len) < 0 || value <= 0) {
+        LOG_WARN("Failed to get IP_MTU: %s", strerror(errno));
+        return RTP_GENERIC_ERROR;
+    }
+
+    *mtu = (size_t)value;
+    return RTP_OK;
+}
+#else
+rtp_error_t uvgrtp::pmtu::init(socket_t socket, sockaddr_in& remote)
+{
+    (void)socket, (void)remote;
+
+    LOG_WARN("Path MTU discovery is supported only on Linux");
+    return RTP_NOT_SUPPORTED;
+}
+
+rtp_error_t uvgrtp::pmtu::query(size_t *mtu)
+{
+    (void)mtu;
+    return RTP_NOT_SUPPORTED;
+}
+#endif
+
+void uvgrtp::pmtu::set_exceeded()
+{
+    exceeded_.store(true, std::memory_order_relaxed);
+}
+
+bool uvgrtp::pmtu::update()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (!exceeded_.load(std::memory_order_relaxed) &&
+        now - last_query_ < std::chrono::milliseconds(PMTU_QUERY_INTERVAL))
+        return false;
+
+    size_t mtu  = 0;
+    last_query_ = now;
+    exceeded_.store(false, std::memory_order_relaxed);
+
+    if (query(&mtu) != RTP_OK || mtu == mtu_)
+        return false;
+
+    LOG_DEBUG("Path MTU changed from %zu to %zu bytes", mtu_, mtu);
+    mtu_ = mtu;
+
+    return true;
+}
+
+size_t uvgrtp::pmtu::get_mtu()
+{
+    return mtu_;
+}
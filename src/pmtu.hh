@@ -0,0 +1,58 @@
+#pragma once
+
+#include "socket.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <chrono>
+
+namespace uvgrtp {
+
+    /* How often the path MTU is queried if no send has failed (milliseconds).
+     * The kernel forgets a learned path MTU after net.ipv4.route.mtu_expires (10 minutes),
+     * the payload size grows back only after that */
+    const int PMTU_QUERY_INTERVAL = 1000;
+
+    /* Path MTU discovery of a media stream, see RCE_PMTU_DISCOVERY
+     *
+     * The Don't Fragment bit is set on the packets of the media stream socket so the
+     * kernel returns EMSGSIZE instead of fragmenting a datagram larger than the path MTU
+     * it knows of. The path MTU the kernel has learned from ICMP "fragmentation needed"
+     * messages is read (IP_MTU) through a second socket connected to the remote address
+     * because the media stream socket is not connected. Nothing is sent through it */
+    class pmtu {
+        public:
+            pmtu();
+            ~pmtu();
+
+            /* Set the Don't Fragment bit on "socket" and start following the path MTU to "remote"
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if path MTU discovery is not supported
+             * Return RTP_GENERIC_ERROR if creating the query socket failed */
+            rtp_error_t init(socket_t socket, sockaddr_in& remote);
+
+            /* Called by the sending thread when a datagram was larger than the path MTU */
+            void set_exceeded();
+
+            /* Query the path MTU if a datagram has been too large or if
+             * PMTU_QUERY_INTERVAL has passed since the previous query
+             *
+             * Return true if the path MTU has changed */
+            bool update();
+
+            /* Return the latest path MTU, the size of the IP packet */
+            size_t get_mtu();
+
+        private:
+            rtp_error_t query(size_t *mtu);
+
+            socket_t socket_;
+            size_t mtu_;
+
+            std::atomic<bool> exceeded_;
+            std::chrono::steady_clock::time_point last_query_;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -16,7 +16,7 @@ namespace uvgrtp {
          *
          * If some actions happens with the socket, return status
          * If the timeout is exceeded, return RTP_INTERRUPTED */
-        rtp_error_t poll(std::vector<uvgrtp::socket>& sockets, uint8_t *buf, size_t buf_len, int timeout, int *bytes_read);
+        rtp_error_t poll(std::vector<uvgrtp::socket *>& sockets, uint8_t *buf, size_t buf_len, int timeout, int *bytes_read);
 
         /* TODO:  */
         rtp_error_t blocked_recv(uvgrtp::socket *socket, uint8_t *buf, size_t buf_len, int timeout, int *bytes_read);
@@ -23,8 +23,11 @@
 uvgrtp::frame_queue::frame_queue(uvgrtp::socket *socket, uvgrtp::rtp *rtp, int flags):
     rtp_(rtp), socket_(socket), flags_(flags)
 {
-    active_     = nullptr;
-    dispatcher_ = nullptr;
+    active_       = nullptr;
+    dispatcher_   = nullptr;
+    dealloc_hook_ = nullptr;
+    pkt_class_    = PKT_CLASS_NORMAL;
+    classify_     = false;
 
     max_queued_ = MAX_QUEUED_MSGS;
     max_mcount_ = MAX_MSG_COUNT;
@@ -33,6 +36,14 @@ uvgrtp::frame_queue::frame_queue(uvgrtp::socket *socket, uvgrtp::rtp *rtp, int f
 
 uvgrtp::frame_queue::~frame_queue()
 {
+    /* The socket may already be gone so the completions cannot be waited for.
+     * The kernel holds its own references to the pages it has not sent yet */
+    for (auto& i : zc_pending_) {
+        i->zerocopy = false;
+        recycle_transaction(i);
+    }
+    zc_pending_.clear();
+
     for (auto& i : free_) {
         (void)destroy_transaction(i);
     }
@@ -44,6 +55,9 @@ uvgrtp::frame_queue::~frame_queue()
 
 rtp_error_t uvgrtp::frame_queue::init_transaction()
 {
+    if (!zc_pending_.empty())
+        release_zerocopy(zc_pending_.size() >= MAX_ZEROCOPY_PENDING);
+
     std::lock_guard<std::mutex> lock(transaction_mtx_);
 
     if (active_ != nullptr)
@@ -53,13 +67,7 @@ rtp_error_t uvgrtp::frame_queue::init_transaction()
         active_      = new transaction_t;
         active_->key = uvgrtp::random::generate_32();
 
-#ifdef __linux__
-        active_->headers     = new struct mmsghdr[max_mcount_];
-        active_->chunks      = new struct iovec[max_ccount_];
-#else
-        active_->headers     = nullptr;
-        active_->chunks      = nullptr;
-#endif
+        /* the send descriptors are built by the socket, see uvgrtp::socket::__sendtov() */
         active_->rtp_headers = new uvgrtp::frame::rtp_header[max_mcount_];
 
         switch (rtp_->get_payload()) {
@@ -93,6 +101,7 @@ rtp_error_t uvgrtp::frame_queue::init_transaction()
     active_->data_raw     = nullptr;
     active_->data_smart   = nullptr;
     active_->dealloc_hook = dealloc_hook_;
+    active_->zerocopy     = false;
 
     if (flags_ & RCE_SRTP_AUTHENTICATE_RTP)
         active_->rtp_auth_tags = new uint8_t[10 * max_mcount_];
@@ -102,6 +111,11 @@ rtp_error_t uvgrtp::frame_queue::init_transaction()
     active_->out_addr = socket_->get_out_address();
     rtp_->fill_header((uint8_t *)&active_->rtp_common);
     active_->buffers.clear();
+    active_->classes.clear();
+
+    /* the classes are recorded only if the socket marks them differently */
+    classify_  = socket_->priority_marking();
+    pkt_class_ = PKT_CLASS_NORMAL;
 
     return RTP_OK;
 }
@@ -117,7 +131,10 @@ rtp_error_t uvgrtp::frame_queue::init_transaction(uint8_t *data)
     }
 
     /* The transaction has been initialized to "active_" */
-    active_->data_raw = data;
+    if (staged_ && staged_.get() == data)
+        active_->data_smart = std::move(staged_);
+    else
+        active_->data_raw = data;
 
     return RTP_OK;
 }
@@ -143,13 +160,9 @@ rtp_error_t uvgrtp::frame_queue::destroy_transaction(uvgrtp::transaction_t *t)
     if (!t)
         return RTP_INVALID_VALUE;
 
-    delete[] t->headers;
-    delete[] t->chunks;
     delete[] t->rtp_headers;
     delete[] t->rtp_auth_tags;
 
-    t->headers     = nullptr;
-    t->chunks      = nullptr;
     t->rtp_headers = nullptr;
 
     switch (rtp_->get_payload()) {
@@ -195,6 +208,15 @@ rtp_error_t uvgrtp::frame_queue::deinit_transaction(uint32_t key)
         return RTP_INVALID_VALUE;
     }
 
+    if (active_ && active_->key == key && active_->zerocopy) {
+        /* the kernel may still be reading the memory of the transaction,
+         * it is released by release_zerocopy() once the sends have completed */
+        queued_.erase(transaction_it);
+        zc_pending_.push_back(active_);
+        active_ = nullptr;
+        return RTP_OK;
+    }
+
     if (active_ && active_->key == key) {
         /* free all temporary buffers */
         if ((flags_ & (RCE_SRTP | RCE_SRTP_INPLACE_ENCRYPTION | RCE_SRTP_NULL_CIPHER)) == RCE_SRTP) {
@@ -204,7 +226,8 @@ rtp_error_t uvgrtp::frame_queue::deinit_transaction(uint32_t key)
                 }
             }
         }
-        active_->packets.clear();
+        release_packets(active_);
+        active_->data_smart = nullptr;
         free_.push_back(active_);
         active_ = nullptr;
         return RTP_OK;
@@ -238,8 +261,6 @@ rtp_error_t uvgrtp::frame_queue::deinit_transaction(uint32_t key)
         }
 
         delete[] transaction_it->second->rtp_auth_tags;
-        delete[] transaction_it->second->headers;
-        delete[] transaction_it->second->chunks;
         delete[] transaction_it->second->rtp_headers;
         delete   transaction_it->second;
     } else {
@@ -276,7 +297,8 @@ rtp_error_t uvgrtp::frame_queue::enqueue_message(uint8_t *message, size_t messag
 
     /* Create buffer vector where the full packet is constructed
      * and which is then pushed to "active_"'s pkt_vec structure */
-    uvgrtp::buf_vec tmp;
+    uvgrtp::buf_vec tmp = next_packet();
+    tmp.reserve(MAX_CHUNK_COUNT);
 
     /* update the RTP header at "rtpheaders_ptr_" */
     uvgrtp::frame_queue::update_rtp_header();
@@ -304,7 +326,11 @@ rtp_error_t uvgrtp::frame_queue::enqueue_message(uint8_t *message, size_t messag
         });
     }
 
-    active_->packets.push_back(tmp);
+    active_->packets.push_back(std::move(tmp));
+
+    if (classify_)
+        active_->classes.push_back(pkt_class_);
+
     rtp_->inc_sequence();
     rtp_->inc_sent_pkts();
 
@@ -326,7 +352,8 @@ rtp_error_t uvgrtp::frame_queue::enqueue_message(std::vector<std::pair<size_t, u
 
     /* Create buffer vector where the full packet is constructed
      * and which is then pushed to "active_"'s pkt_vec structure */
-    uvgrtp::buf_vec tmp;
+    uvgrtp::buf_vec tmp = next_packet();
+    tmp.reserve(buffers.size() + 2);
 
     /* update the RTP header at "rtpheaders_ptr_" */
     uvgrtp::frame_queue::update_rtp_header();
@@ -368,7 +395,11 @@ rtp_error_t uvgrtp::frame_queue::enqueue_message(std::vector<std::pair<size_t, u
         });
     }
 
-    active_->packets.push_back(tmp);
+    active_->packets.push_back(std::move(tmp));
+
+    if (classify_)
+        active_->classes.push_back(pkt_class_);
+
     rtp_->inc_sequence();
     rtp_->inc_sent_pkts();
 
@@ -391,7 +422,21 @@ rtp_error_t uvgrtp::frame_queue::flush_queue()
     queued_.insert(std::make_pair(active_->key, active_));
     transaction_mtx_.unlock();
 
-    if (socket_->sendto(active_->packets, 0) != RTP_OK) {
+    int send_flags = 0;
+
+#ifdef __linux__
+    if ((active_->zerocopy = use_zerocopy()))
+        send_flags = MSG_ZEROCOPY;
+#endif
+
+    rtp_error_t ret = classify_ ? socket_->sendto(active_->packets, active_->classes, send_flags)
+                                : socket_->sendto(active_->packets, send_flags);
+
+    /* part of the frame may have been sent even if the send failed */
+    if (active_->zerocopy)
+        active_->zc_id = socket_->zerocopy_sent();
+
+    if (ret != RTP_OK) {
         LOG_ERROR("Failed to flush the message queue: %s", strerror(errno));
         (void)deinit_transaction();
         return RTP_SEND_ERROR;
@@ -401,6 +446,11 @@ rtp_error_t uvgrtp::frame_queue::flush_queue()
     return deinit_transaction();
 }
 
+void uvgrtp::frame_queue::set_packet_class(uint8_t pkt_class)
+{
+    pkt_class_ = pkt_class;
+}
+
 void uvgrtp::frame_queue::update_rtp_header()
 {
     memcpy(&active_->rtp_headers[active_->rtphdr_ptr], &active_->rtp_common, sizeof(active_->rtp_common));
@@ -427,6 +477,93 @@ uint8_t *uvgrtp::frame_queue::get_active_dataptr()
     return active_->data_raw;
 }
 
+void uvgrtp::frame_queue::stage_frame(std::unique_ptr<uint8_t[]> data)
+{
+    staged_ = std::move(data);
+}
+
+bool uvgrtp::frame_queue::use_zerocopy()
+{
+    /* SRTP encrypts copies of the frame or the frame in place, neither of which works
+     * if the kernel reads the frame after sendmmsg() has returned */
+    if (!(flags_ & RCE_MSG_ZEROCOPY) || (flags_ & RCE_SRTP) || !socket_->zerocopy_enabled())
+        return false;
+
+    /* the memory must be owned by uvgRTP, otherwise the application
+     * could reuse it as soon as push_frame() returns */
+    if (!active_->data_smart && !(active_->data_raw && active_->dealloc_hook))
+        return false;
+
+    size_t frame_size = 0;
+
+    for (auto& packet : active_->packets) {
+        for (auto& buffer : packet)
+            frame_size += buffer.first;
+    }
+
+    return frame_size >= ZEROCOPY_MIN_FRAME_SIZE;
+}
+
+void uvgrtp::frame_queue::release_zerocopy(bool wait)
+{
+    if (wait && socket_->wait_zerocopy(zc_pending_.front()->zc_id, ZEROCOPY_TIMEOUT) != RTP_OK) {
+        LOG_WARN("Zero-copy send did not complete in %d ms, releasing the frame", ZEROCOPY_TIMEOUT);
+        zc_pending_.front()->zerocopy = false;
+    }
+
+    socket_->reap_zerocopy();
+
+    while (!zc_pending_.empty()) {
+        transaction_t *t = zc_pending_.front();
+
+        if (t->zerocopy && !socket_->zerocopy_completed(t->zc_id))
+            break;
+
+        zc_pending_.pop_front();
+        recycle_transaction(t);
+    }
+}
+
+void uvgrtp::frame_queue::recycle_transaction(transaction_t *t)
+{
+    std::lock_guard<std::mutex> lock(transaction_mtx_);
+
+    if (t->data_raw && t->dealloc_hook)
+        t->dealloc_hook(t->data_raw);
+
+    t->data_raw   = nullptr;
+    t->data_smart = nullptr;
+    t->zerocopy   = false;
+    release_packets(t);
+
+    if (free_.size() >= (size_t)max_queued_)
+        (void)destroy_transaction(t);
+    else
+        free_.push_back(t);
+}
+
+uvgrtp::buf_vec uvgrtp::frame_queue::next_packet()
+{
+    if (active_->spare_packets.empty())
+        return uvgrtp::buf_vec();
+
+    /* moving the vector keeps its memory */
+    uvgrtp::buf_vec packet = std::move(active_->spare_packets.back());
+    active_->spare_packets.pop_back();
+
+    return packet;
+}
+
+void uvgrtp::frame_queue::release_packets(transaction_t *t)
+{
+    for (auto& packet : t->packets) {
+        packet.clear();
+        t->spare_packets.push_back(std::move(packet));
+    }
+
+    t->packets.clear();
+}
+
 void uvgrtp::frame_queue::install_dealloc_hook(void (*dealloc_hook)(void *))
 {
     if (!dealloc_hook)
@@ -6,6 +6,7 @@
 #include "util.hh"
 
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -19,6 +20,15 @@ const int MAX_MSG_COUNT   = 5000;
 const int MAX_QUEUED_MSGS =  10;
 const int MAX_CHUNK_COUNT =   4;
 
+/* Frames smaller than this are never sent with MSG_ZEROCOPY, for them
+ * pinning the pages and reaping the completion is costlier than copying */
+const size_t ZEROCOPY_MIN_FRAME_SIZE = 10000;
+
+/* How many zero-copy transactions may wait for completion before the sender
+ * blocks and for how long (milliseconds) it waits before releasing them anyway */
+const size_t MAX_ZEROCOPY_PENDING = 64;
+const int ZEROCOPY_TIMEOUT        = 100;
+
 namespace uvgrtp {
 
     class dispatcher;
@@ -47,20 +57,20 @@ namespace uvgrtp {
          * each buf_vec structure is pushed to pkt_vec */
         uvgrtp::pkt_vec packets;
 
+        /* Emptied buf_vecs of the previous frames. They are moved back to "packets" by
+         * enqueue_message() so that their memory is reused, see release_packets() */
+        uvgrtp::pkt_vec spare_packets;
+
+        /* Packet class of each packet of "packets", see frame_queue::set_packet_class().
+         * Empty if the socket does not mark the classes differently */
+        std::vector<uint8_t> classes;
+
         /* All packets of a transaction share the common RTP header only differing in sequence number.
          * Keeping a separate common RTP header and then just copying this is cleaner than initializing
          * RTP header for each packet */
         uvgrtp::frame::rtp_header rtp_common;
         uvgrtp::frame::rtp_header *rtp_headers = nullptr;
 
-#ifdef __linux__
-        struct mmsghdr *headers = nullptr;
-        struct iovec   *chunks = nullptr;
-#else
-        char *headers = nullptr;
-        char *chunks = nullptr;
-#endif
-
         /* Media may need space for additional buffers,
          * this pointer is initialized with uvgrtp::MEDIA_TYPE::media_headers
          * when the transaction is initialized for the first time
@@ -100,6 +110,11 @@ namespace uvgrtp {
          * When SCD finishes processing a transaction, it will call this hook with "data_raw" pointer */
         void (*dealloc_hook)(void *);
 
+        /* If the transaction was sent with MSG_ZEROCOPY, its memory (data and headers)
+         * is released only after the kernel has completed the sends below "zc_id" */
+        bool zerocopy = false;
+        uint32_t zc_id = 0;
+
     } transaction_t;
 
     class frame_queue {
@@ -169,6 +184,11 @@ namespace uvgrtp {
              * Return nullptr if they're not set */
             void *get_media_headers();
 
+            /* Set the class (see uvgrtp::PACKET_CLASSES) of the packets enqueued next
+             *
+             * The class is reset to PKT_CLASS_NORMAL when a transaction is initialized */
+            void set_packet_class(uint8_t pkt_class);
+
             /* Update the active task's current packet's sequence number */
             void update_rtp_header();
 
@@ -192,7 +212,32 @@ namespace uvgrtp {
              * significant memory leaks */
             void install_dealloc_hook(void (*dealloc_hook)(void *));
 
+            /* Give the ownership of the frame that is pushed next to frame queue
+             *
+             * init_transaction(uint8_t *) takes the ownership if it is called with the
+             * same pointer, which allows a frame pushed as std::unique_ptr to outlive
+             * push_frame() when it is sent with MSG_ZEROCOPY */
+            void stage_frame(std::unique_ptr<uint8_t[]> data);
+
         private:
+            /* Can the active transaction be sent with MSG_ZEROCOPY */
+            bool use_zerocopy();
+
+            /* Release the zero-copy transactions the kernel has completed
+             *
+             * If "wait" is true, wait until there is room for a new zero-copy transaction */
+            void release_zerocopy(bool wait);
+
+            /* Release the memory of a completed transaction and move it to "free_" or destroy it */
+            void recycle_transaction(transaction_t *t);
+
+            /* Return an empty buffer vector for the next packet of the active transaction,
+             * a spare one of the transaction if there is any */
+            uvgrtp::buf_vec next_packet();
+
+            /* Empty the packets of "t" and keep their buffer vectors as spares */
+            void release_packets(transaction_t *t);
+
             /* Both the application and SCD access "free_" and "queued_" structures so the
              * access must be protected by a mutex
              *
@@ -202,6 +247,16 @@ namespace uvgrtp {
             std::vector<transaction_t *> free_;
             std::unordered_map<uint32_t, transaction_t *> queued_;
 
+            /* Transactions sent with MSG_ZEROCOPY, in the order they were sent */
+            std::deque<transaction_t *> zc_pending_;
+
+            /* Class of the packets enqueued next and are the classes recorded at all */
+            uint8_t pkt_class_;
+            bool classify_;
+
+            /* See stage_frame() */
+            std::unique_ptr<uint8_t[]> staged_;
+
             transaction_t *active_;
 
             /* Set to nullptr if this frame queue doesn't use dispatcher */
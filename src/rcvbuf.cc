@@ -0,0 +1,104 @@
+#include "rcvbuf.hh"
+
+#include "debug.hh"
+#include "socket.hh"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+#include <algorithm>
+
+uvgrtp::rcvbuf_tuner::rcvbuf_tuner():
+    max_(0),
+    window_start_(std::chrono::steady_clock::now()),
+    window_bytes_(0),
+    window_burst_(0),
+    drops_(0),
+    limited_(false)
+{
+}
+
+uvgrtp::rcvbuf_tuner::~rcvbuf_tuner()
+{
+}
+
+void uvgrtp::rcvbuf_tuner::set_max(size_t max_size)
+{
+    max_ = max_size;
+}
+
+size_t uvgrtp::rcvbuf_tuner::get_size(uvgrtp::socket *socket)
+{
+    int buf_size      = 0;
+    socklen_t opt_len = sizeof(buf_size);
+
+    if (::getsockopt(socket->get_raw_socket(), SOL_SOCKET, SO_RCVBUF, (char *)&buf_size, &opt_len) < 0)
+        return 0;
+
+#ifdef __linux__
+    /* Linux doubles the requested size to account for bookkeeping overhead */
+    return (size_t)buf_size / 2;
+#else
+    return (size_t)buf_size;
+#endif
+}
+
+void uvgrtp::rcvbuf_tuner::grow(uvgrtp::socket *socket, size_t target)
+{
+    size_t current = get_size(socket);
+    size_t max     = max_;
+
+    if (!current || current >= max || target <= current)
+        return;
+
+    int buf_size = (int)std::min(target, max);
+
+#ifdef __linux__
+    /* SO_RCVBUFFORCE is not limited by net.core.rmem_max but it requires CAP_NET_ADMIN */
+    if (::setsockopt(socket->get_raw_socket(), SOL_SOCKET, SO_RCVBUFFORCE, &buf_size, sizeof(buf_size)) < 0)
+#endif
+    (void)socket->setsockopt(SOL_SOCKET, SO_RCVBUF, (const char *)&buf_size, sizeof(buf_size));
+
+    size_t updated = get_size(socket);
+
+    if (updated <= current) {
+        LOG_WARN("Receive buffer cannot grow beyond %zu bytes, raise net.core.rmem_max to avoid drops", current);
+        limited_ = true;
+        return;
+    }
+
+    LOG_DEBUG("Receive buffer grown from %zu to %zu bytes", current, updated);
+}
+
+void uvgrtp::rcvbuf_tuner::update(uvgrtp::socket *socket, size_t bytes, uint32_t drops)
+{
+    if (!max_ || limited_)
+        return;
+
+    window_bytes_ += bytes;
+    window_burst_  = std::max(window_burst_, bytes);
+
+    auto now     = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - window_start_).count();
+
+    if (elapsed < RCVBUF_TUNE_INTERVAL && drops == drops_)
+        return;
+
+    /* enough room for RCVBUF_TARGET_TIME worth of data and for the largest burst */
+    size_t rate   = window_bytes_ * 1000 / (size_t)std::max((int64_t)elapsed, (int64_t)1);
+    size_t target = std::max(rate * RCVBUF_TARGET_TIME / 1000, 2 * window_burst_);
+
+    /* the kernel has dropped datagrams, the buffer is too small for the bursts regardless of the estimate */
+    if (drops != drops_) {
+        LOG_DEBUG("Kernel dropped %u datagrams", drops - drops_);
+        target = std::max(target, 2 * get_size(socket));
+    }
+
+    grow(socket, target);
+
+    drops_        = drops;
+    window_start_ = now;
+    window_bytes_ = 0;
+    window_burst_ = 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "util.hh"
+
+#include <atomic>
+#include <chrono>
+
+namespace uvgrtp {
+
+    class socket;
+
+    /* Default upper limit of the receive buffer size in bytes, see RCC_UDP_RCV_BUF_MAX */
+    const size_t RCVBUF_DEFAULT_MAX = 64 * 1024 * 1024;
+
+    /* How often (milliseconds) the receive statistics are evaluated */
+    const int RCVBUF_TUNE_INTERVAL = 100;
+
+    /* The receive buffer should hold this many milliseconds of data at the observed bitrate */
+    const int RCVBUF_TARGET_TIME = 200;
+
+    /* Grows the receive buffer of a socket based on the received traffic
+     *
+     * The buffer is grown to hold RCVBUF_TARGET_TIME milliseconds of data at the observed
+     * bitrate and at least twice the largest burst read from the socket at once. If the kernel
+     * has dropped datagrams, the buffer is doubled. The buffer is never shrunk.
+     *
+     * The kernel limits the size to net.core.rmem_max unless the process has CAP_NET_ADMIN */
+    class rcvbuf_tuner {
+        public:
+            rcvbuf_tuner();
+            ~rcvbuf_tuner();
+
+            /* Set the upper limit of the receive buffer size, 0 disables tuning */
+            void set_max(size_t max_size);
+
+            /* Account "bytes" read from "socket" in one go and grow the receive buffer if needed
+             *
+             * "drops" is the kernel drop counter of the socket (SO_RXQ_OVFL) */
+            void update(uvgrtp::socket *socket, size_t bytes, uint32_t drops);
+
+        private:
+            /* Return the current receive buffer size of "socket" or 0 if it cannot be queried */
+            size_t get_size(uvgrtp::socket *socket);
+
+            void grow(uvgrtp::socket *socket, size_t target);
+
+            std::atomic<size_t> max_;
+
+            std::chrono::steady_clock::time_point window_start_;
+            size_t window_bytes_;
+            size_t window_burst_;
+
+            /* kernel drop counter when the buffer was last evaluated */
+            uint32_t drops_;
+
+            /* the kernel did not let the buffer grow, stop trying */
+            bool limited_;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -0,0 +1,295 @@
+#include "reactor.hh"
+
+#include "debug.hh"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+uvgrtp::reactor::reactor():
+    active_(false)
+{
+}
+
+uvgrtp::reactor::~reactor()
+{
+    (void)stop();
+
+    for (auto& src : sources_)
+        delete src.second;
+}
+
+rtp_error_t uvgrtp::reactor::start(size_t threads)
+{
+    if (!threads)
+        return RTP_INVALID_VALUE;
+
+    if (!threads_.empty())
+        return RTP_INITIALIZED;
+
+#ifdef __linux__
+    for (size_t i = 0; i < threads; ++i) {
+        thread_ctx *ctx = new thread_ctx();
+        threads_.push_back(ctx);
+
+        if ((ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+            log_platform_error("epoll_create1(2) failed");
+            (void)stop();
+            return RTP_GENERIC_ERROR;
+        }
+
+        /* the wake-up eventfd is the only source without a source object */
+        struct epoll_event event;
+
+        memset(&event, 0, sizeof(event));
+        event.events   = EPOLLIN;
+        event.data.ptr = nullptr;
+
+        if ((ctx->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0 ||
+            epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, ctx->wake_fd, &event) < 0) {
+            log_platform_error("Failed to create wake-up event for reactor");
+            (void)stop();
+            return RTP_GENERIC_ERROR;
+        }
+    }
+
+    active_ = true;
+
+    for (auto& ctx : threads_)
+        ctx->thread = new std::thread(&uvgrtp::reactor::runner, this, ctx);
+
+    return RTP_OK;
+#else
+    LOG_ERROR("Reactor is supported only on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::reactor::stop()
+{
+#ifdef __linux__
+    active_ = false;
+
+    for (auto& ctx : threads_) {
+        uint64_t value = 1;
+
+        if (ctx->wake_fd != -1 && write(ctx->wake_fd, &value, sizeof(value)) < 0)
+            log_platform_error("write(2) failed");
+
+        if (ctx->thread) {
+            ctx->thread->join();
+            delete ctx->thread;
+        }
+
+        for (auto& src : ctx->removed)
+            delete src;
+
+        if (ctx->wake_fd != -1)
+            close(ctx->wake_fd);
+
+        if (ctx->epoll_fd != -1)
+            close(ctx->epoll_fd);
+
+        delete ctx;
+    }
+#endif
+    threads_.clear();
+
+    return RTP_OK;
+}
+
+uvgrtp::recv_slots *uvgrtp::reactor::get_slots(size_t thread)
+{
+    if (thread >= threads_.size())
+        return nullptr;
+
+    return &threads_[thread]->slots;
+}
+
+size_t uvgrtp::reactor::assign_thread()
+{
+    std::lock_guard<std::mutex> lock(sources_mtx_);
+    size_t thread = 0;
+
+    for (size_t i = 1; i < threads_.size(); ++i) {
+        if (threads_[i]->nsources < threads_[thread]->nsources)
+            thread = i;
+    }
+
+    return thread;
+}
+
+rtp_error_t uvgrtp::reactor::add(size_t thread, int fd, bool timer, void *arg, uvgrtp::reactor_handler handler)
+{
+#ifdef __linux__
+    std::lock_guard<std::mutex> lock(sources_mtx_);
+
+    source *src  = new source();
+    src->fd      = fd;
+    src->timer   = timer;
+    src->thread  = thread;
+    src->arg     = arg;
+    src->handler = handler;
+
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events   = EPOLLIN;
+    event.data.ptr = src;
+
+    if (epoll_ctl(threads_[thread]->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        log_platform_error("epoll_ctl(2) failed");
+        delete src;
+        return RTP_GENERIC_ERROR;
+    }
+
+    sources_[fd] = src;
+    ++threads_[thread]->nsources;
+
+    return RTP_OK;
+#else
+    (void)thread, (void)fd, (void)timer, (void)arg, (void)handler;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::reactor::add_source(size_t thread, socket_t fd, void *arg, uvgrtp::reactor_handler handler)
+{
+    if (!handler || thread >= threads_.size())
+        return RTP_INVALID_VALUE;
+
+    return add(thread, (int)fd, false, arg, handler);
+}
+
+rtp_error_t uvgrtp::reactor::add_timer(size_t thread, uint32_t interval, void *arg, uvgrtp::reactor_handler handler, int *timer)
+{
+    if (!handler || !timer || thread >= threads_.size())
+        return RTP_INVALID_VALUE;
+
+#ifdef __linux__
+    rtp_error_t ret;
+    struct itimerspec spec;
+    int fd;
+
+    if ((fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) < 0) {
+        log_platform_error("timerfd_create(2) failed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    spec.it_interval.tv_sec  = interval / 1000;
+    spec.it_interval.tv_nsec = (interval % 1000) * 1000000;
+    spec.it_value            = spec.it_interval;
+
+    if (timerfd_settime(fd, 0, &spec, nullptr) < 0) {
+        log_platform_error("timerfd_settime(2) failed");
+        close(fd);
+        return RTP_GENERIC_ERROR;
+    }
+
+    if ((ret = add(thread, fd, true, arg, handler)) != RTP_OK) {
+        close(fd);
+        return ret;
+    }
+
+    *timer = fd;
+    return RTP_OK;
+#else
+    (void)interval, (void)arg;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::reactor::remove_source(int fd)
+{
+#ifdef __linux__
+    source *src = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(sources_mtx_);
+        auto it = sources_.find(fd);
+
+        if (it == sources_.end())
+            return RTP_NOT_FOUND;
+
+        src = it->second;
+        sources_.erase(it);
+
+        if (src->thread < threads_.size())
+            --threads_[src->thread]->nsources;
+    }
+
+    /* if the reactor has been stopped, there is no thread that could be calling the handler */
+    if (src->thread >= threads_.size()) {
+        if (src->timer)
+            close(src->fd);
+        delete src;
+        return RTP_OK;
+    }
+
+    thread_ctx *ctx = threads_[src->thread];
+    std::lock_guard<std::recursive_mutex> lock(ctx->mtx);
+
+    if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_DEL, src->fd, nullptr) < 0)
+        log_platform_error("epoll_ctl(2) failed");
+
+    if (src->timer)
+        close(src->fd);
+
+    src->active = false;
+    ctx->removed.push_back(src);
+
+    return RTP_OK;
+#else
+    (void)fd;
+    return RTP_NOT_FOUND;
+#endif
+}
+
+void uvgrtp::reactor::runner(thread_ctx *ctx)
+{
+#ifdef __linux__
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    while (active_) {
+        int nevents = epoll_wait(ctx->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+
+        if (nevents < 0) {
+            if (errno == EINTR)
+                continue;
+
+            log_platform_error("epoll_wait(2) failed");
+            break;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(ctx->mtx);
+
+        for (int i = 0; i < nevents; ++i) {
+            source *src = (source *)events[i].data.ptr;
+
+            /* wake-up event or a source that was removed after the events were fetched */
+            if (!src || !src->active)
+                continue;
+
+            if (src->timer) {
+                uint64_t expirations;
+
+                if (read(src->fd, &expirations, sizeof(expirations)) < 0)
+                    continue;
+            }
+
+            src->handler(src->arg);
+        }
+
+        for (auto& src : ctx->removed)
+            delete src;
+        ctx->removed.clear();
+    }
+#else
+    (void)ctx;
+#endif
+}
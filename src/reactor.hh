@@ -0,0 +1,123 @@
+#pragma once
+
+#include "recv_slots.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace uvgrtp {
+
+    /* How many events a reactor thread processes per epoll_wait(2) call */
+    const int REACTOR_MAX_EVENTS = 64;
+
+    typedef void (*reactor_handler)(void *arg);
+
+    /* Reactor multiplexes the sockets and timers of all media streams of a context
+     * on a fixed number of epoll threads so that idle media streams do not need their
+     * own threads waking up periodically.
+     *
+     * All sources of one media stream should be added to the same reactor thread
+     * (see assign_thread()) so that their handlers are never called concurrently,
+     * just like when each media stream had its own threads */
+    class reactor {
+        public:
+            reactor();
+            ~reactor();
+
+            /* Start "threads" reactor threads
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "threads" is 0
+             * Return RTP_INITIALIZED if the reactor has already been started
+             * Return RTP_NOT_SUPPORTED if the platform does not support epoll
+             * Return RTP_GENERIC_ERROR if creating the epoll instances failed */
+            rtp_error_t start(size_t threads);
+
+            /* Stop all reactor threads and wait until they have exited */
+            rtp_error_t stop();
+
+            /* Select the reactor thread for a new media stream
+             *
+             * Return the index of the thread that has the fewest sources */
+            size_t assign_thread();
+
+            /* Call "handler" from reactor thread "thread" when "fd" is readable
+             *
+             * The handler should read everything there is to read but if it
+             * does not, it is called again (level-triggered)
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "handler" is nullptr or "thread" is not valid
+             * Return RTP_GENERIC_ERROR if adding "fd" to epoll failed */
+            rtp_error_t add_source(size_t thread, socket_t fd, void *arg, uvgrtp::reactor_handler handler);
+
+            /* Call "handler" from reactor thread "thread" every "interval" milliseconds
+             *
+             * Write the identifier of the timer to "timer". The timer is removed with remove_source()
+             *
+             * Return RTP_OK on success
+             * Return RTP_INVALID_VALUE if "handler" is nullptr or "thread" is not valid
+             * Return RTP_GENERIC_ERROR if creating the timer failed */
+            rtp_error_t add_timer(size_t thread, uint32_t interval, void *arg, uvgrtp::reactor_handler handler, int *timer);
+
+            /* Remove a source or a timer from the reactor
+             *
+             * When remove_source() returns, the handler of the source is not running
+             * and it is not called again
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_FOUND if "fd" has not been added to the reactor */
+            rtp_error_t remove_source(int fd);
+
+            /* Return the receive slots shared by the packet dispatchers of reactor thread "thread"
+             *
+             * Return nullptr if "thread" is not valid */
+            uvgrtp::recv_slots *get_slots(size_t thread);
+
+        private:
+            struct source {
+                int fd = -1;
+                bool timer = false;
+                bool active = true;
+                size_t thread = 0;
+                void *arg = nullptr;
+                uvgrtp::reactor_handler handler = nullptr;
+            };
+
+            struct thread_ctx {
+                int epoll_fd = -1;
+                int wake_fd = -1;
+                size_t nsources = 0;
+                std::thread *thread = nullptr;
+
+                /* the handlers are called one at a time so the dispatchers can receive into the same slots */
+                uvgrtp::recv_slots slots{ uvgrtp::RECV_BATCH_SIZE };
+
+                /* held while the handlers are called so that a source can be removed safely.
+                 * Recursive because a handler may end up removing its own media stream */
+                std::recursive_mutex mtx;
+
+                /* removed sources are freed only after the events fetched
+                 * together with them have been processed */
+                std::vector<source *> removed;
+            };
+
+            /* Reactor thread, wait for events and call the handlers of the sources */
+            void runner(thread_ctx *ctx);
+
+            rtp_error_t add(size_t thread, int fd, bool timer, void *arg, uvgrtp::reactor_handler handler);
+
+            std::vector<thread_ctx *> threads_;
+
+            std::unordered_map<int, source *> sources_;
+            std::mutex sources_mtx_;
+
+            std::atomic<bool> active_;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -0,0 +1,42 @@
+#include "recv_slots.hh"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#include <cstring>
+
+uvgrtp::recv_slots::recv_slots(size_t nslots):
+    batch(nslots),
+    len(0xffff - IPV4_HDR_SIZE - UDP_HDR_SIZE),
+    buffer(nullptr)
+{
+    /* Stack size isn't enough for this so we allocate the memory from heap */
+    buffer = new uint8_t[batch * len];
+
+#ifdef __linux__
+    headers = new struct mmsghdr[batch];
+    chunks  = new struct iovec[batch];
+    control = new uint8_t[batch * RECV_CONTROL_SIZE];
+
+    for (size_t i = 0; i < batch; ++i) {
+        chunks[i].iov_base = buffer + i * len;
+        chunks[i].iov_len  = len;
+
+        memset(&headers[i], 0, sizeof(headers[i]));
+        headers[i].msg_hdr.msg_iov    = &chunks[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+}
+
+uvgrtp::recv_slots::~recv_slots()
+{
+#ifdef __linux__
+    delete[] headers;
+    delete[] chunks;
+    delete[] control;
+#endif
+    delete[] buffer;
+}
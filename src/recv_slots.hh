@@ -0,0 +1,46 @@
+#pragma once
+
+#include "util.hh"
+
+#ifdef __linux__
+struct mmsghdr;
+struct iovec;
+#endif
+
+namespace uvgrtp {
+
+    /* How many datagrams are read from the socket with one system call
+     *
+     * If RCE_NO_SYSTEM_CALL_CLUSTERING is given, datagrams are read one at a time */
+    const size_t RECV_BATCH_SIZE = 32;
+
+    /* Size of the ancillary data buffer of each receive slot, large enough for
+     * the UDP GRO segment size, the receive timestamp, the kernel drop counter and the TOS byte */
+    const size_t RECV_CONTROL_SIZE = 128;
+
+    /* Datagrams are received into a ring of receive slots so that the whole batch returned
+     * by one recvmmsg(2) call can be processed before the slots are reused.
+     *
+     * The slots are used only by the thread that receives. A dispatcher with its own thread
+     * has its own slots but all dispatchers of a reactor thread share the slots of that thread
+     * because the reactor calls them one at a time, see uvgrtp::reactor::get_slots().
+     *
+     * Each slot is large enough to hold a maximum-sized UDP payload */
+    class recv_slots {
+        public:
+            recv_slots(size_t nslots);
+            ~recv_slots();
+
+            size_t batch;
+            size_t len;
+            uint8_t *buffer;
+
+#ifdef __linux__
+            struct mmsghdr *headers;
+            struct iovec *chunks;
+            uint8_t *control;
+#endif
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -2,6 +2,7 @@
 
 #include "hostname.hh"
 #include "poll.hh"
+#include "reactor.hh"
 #include "debug.hh"
 #include "util.hh"
 #include "rtp.hh"
@@ -10,6 +11,8 @@
 
 #ifndef _WIN32
 #include <sys/time.h>
+#else
+#define MSG_DONTWAIT 0
 #endif
 
 #include <cassert>
@@ -22,6 +25,10 @@ const uint16_t SSRC_CSRC_SIZE = 4;
 const uint16_t SENDER_INFO_SIZE = 20;
 const uint16_t REPORT_BLOCK_SIZE = 24;
 const uint16_t APP_NAME_SIZE = 4;
+const uint16_t ECN_FEEDBACK_SIZE = 20;
+
+/* Feedback message type of RFC 6679 ECN feedback in transport layer feedback packets */
+const uint8_t RTPFB_FMT_ECN = 8;
 
 const uint32_t MAX_SUPPORTED_PARTICIPANTS = 31;
 
@@ -31,14 +38,19 @@ uvgrtp::rtcp::rtcp(uvgrtp::rtp *rtp, int flags):
     members_(0), senders_(0), rtcp_bandwidth_(0),
     we_sent_(0), avg_rtcp_pkt_pize_(0), rtcp_pkt_count_(0),
     rtcp_pkt_sent_count_(0), initial_(true), num_receivers_(0),
+    mux_socket_(nullptr),
+    reactor_(nullptr),
+    report_timer_(-1),
     sender_hook_(nullptr),
     receiver_hook_(nullptr),
     sdes_hook_(nullptr),
     app_hook_(nullptr),
+    ecn_hook_(nullptr),
     sr_hook_f_(nullptr),
     rr_hook_f_(nullptr),
     sdes_hook_f_(nullptr),
-    app_hook_f_(nullptr)
+    app_hook_f_(nullptr),
+    ecn_hook_f_(nullptr)
 {
     ssrc_         = rtp->get_ssrc();
     clock_rate_   = rtp->get_clock_rate();
@@ -63,22 +75,63 @@ uvgrtp::rtcp::~rtcp()
 
 rtp_error_t uvgrtp::rtcp::start()
 {
-    if (sockets_.empty()) {
+    if (sockets_.empty() && !mux_socket_) {
         LOG_ERROR("Cannot start RTCP Runner because no connections have been initialized");
         return RTP_INVALID_VALUE;
     }
     active_ = true;
 
-    runner_ = new std::thread(rtcp_runner, this);
-    runner_->detach();
+    runner_ = new std::thread(mux_socket_ ? rtcp_mux_runner : rtcp_runner, this);
+
+    /* the multiplexed runner sleeps only briefly so stop() waits for it to exit */
+    if (!mux_socket_)
+        runner_->detach();
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::rtcp::start(uvgrtp::reactor *reactor, size_t thread)
+{
+    if (!reactor)
+        return start();
+
+    if (sockets_.empty() && !mux_socket_) {
+        LOG_ERROR("Cannot start RTCP Runner because no connections have been initialized");
+        return RTP_INVALID_VALUE;
+    }
+    active_  = true;
+    reactor_ = reactor;
+
+    for (auto& socket : sockets_) {
+        if (reactor->add_source(thread, socket->get_raw_socket(), this, recv_handler) != RTP_OK) {
+            LOG_ERROR("Failed to add RTCP socket to reactor");
+            return RTP_GENERIC_ERROR;
+        }
+    }
+
+    if (reactor->add_timer(thread, MIN_TIMEOUT, this, report_handler, &report_timer_) != RTP_OK) {
+        LOG_ERROR("Failed to add RTCP report timer to reactor");
+        return RTP_GENERIC_ERROR;
+    }
 
     return RTP_OK;
 }
 
 rtp_error_t uvgrtp::rtcp::stop()
 {
-    if (!runner_)
+    if (reactor_) {
+        for (auto& socket : sockets_)
+            (void)reactor_->remove_source((int)socket->get_raw_socket());
+
+        if (report_timer_ != -1)
+            (void)reactor_->remove_source(report_timer_);
+
+        reactor_      = nullptr;
+        report_timer_ = -1;
+    }
+    else if (!runner_) {
         goto free_mem;
+    }
 
     /* when the member count is less than 50,
      * we can just send the BYE message and destroy the session */
@@ -96,15 +149,20 @@ rtp_error_t uvgrtp::rtcp::stop()
     active_   = false;
 
 end:
+    if (runner_ && runner_->joinable())
+        runner_->join();
+
     /* Send BYE packet with our SSRC to all participants */
     return uvgrtp::rtcp::send_bye_packet({ ssrc_ });
 
 free_mem:
     /* free all receiver statistic structs */
     for (auto& participant : participants_) {
-        delete participant.second->socket;
+        if (participant.second->socket != mux_socket_)
+            delete participant.second->socket;
         delete participant.second;
     }
+    sockets_.clear();
 
     return RTP_OK;
 }
@@ -144,6 +202,57 @@ void uvgrtp::rtcp::rtcp_runner(uvgrtp::rtcp* rtcp)
     }
 }
 
+void uvgrtp::rtcp::rtcp_mux_runner(uvgrtp::rtcp* rtcp)
+{
+    LOG_INFO("RTCP instance created!");
+
+    uvgrtp::clock::hrc::hrc_t last_report = uvgrtp::clock::hrc::now();
+    rtp_error_t ret;
+
+    /* the packets are received by the packet dispatcher of the RTP socket,
+     * sleep in short intervals so that stop() is noticed quickly */
+    while (rtcp->active()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        if (uvgrtp::clock::hrc::diff_now(last_report) < MIN_TIMEOUT)
+            continue;
+
+        {
+            std::lock_guard<std::mutex> lock(rtcp->recv_mtx_);
+
+            if ((ret = rtcp->generate_report()) != RTP_OK && ret != RTP_NOT_READY)
+                LOG_ERROR("Failed to send RTCP status report!");
+        }
+
+        last_report = uvgrtp::clock::hrc::now();
+    }
+}
+
+void uvgrtp::rtcp::recv_handler(void *arg)
+{
+    uvgrtp::rtcp *rtcp = (uvgrtp::rtcp *)arg;
+    uint8_t buffer[MAX_PACKET];
+    int nread;
+
+    /* the handler is shared by all RTCP sockets so read everything from all of them */
+    for (auto& socket : rtcp->get_sockets()) {
+        while (socket->recv(buffer, MAX_PACKET, MSG_DONTWAIT, &nread) == RTP_OK && nread > 0)
+            (void)rtcp->handle_incoming_packet(buffer, (size_t)nread);
+    }
+}
+
+void uvgrtp::rtcp::report_handler(void *arg)
+{
+    uvgrtp::rtcp *rtcp = (uvgrtp::rtcp *)arg;
+    rtp_error_t ret;
+
+    /* multiplexed RTCP packets are handled by the packet dispatcher concurrently */
+    std::lock_guard<std::mutex> lock(rtcp->recv_mtx_);
+
+    if ((ret = rtcp->generate_report()) != RTP_OK && ret != RTP_NOT_READY)
+        LOG_ERROR("Failed to send RTCP status report!");
+}
+
 rtp_error_t uvgrtp::rtcp::add_participant(std::string dst_addr, uint16_t dst_port, uint16_t src_port, uint32_t clock_rate)
 {
     if (dst_addr == "" || !dst_port || !src_port) {
@@ -198,7 +307,29 @@ rtp_error_t uvgrtp::rtcp::add_participant(std::string dst_addr, uint16_t dst_por
     p->stats.clock_rate = clock_rate;
 
     initial_participants_.push_back(p);
-    sockets_.push_back(*p->socket);
+    sockets_.push_back(p->socket);
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::rtcp::add_participant(uvgrtp::socket *socket, std::string dst_addr, uint16_t dst_port, uint32_t clock_rate)
+{
+    if (!socket || dst_addr == "" || !dst_port) {
+        LOG_ERROR("Invalid values given (%s, %d), cannot create RTCP instance", dst_addr.c_str(), dst_port);
+        return RTP_INVALID_VALUE;
+    }
+
+    rtcp_participant *p = new rtcp_participant();
+
+    zero_stats(&p->stats);
+
+    p->socket           = socket;
+    p->role             = RECEIVER;
+    p->address          = socket->create_sockaddr(AF_INET, dst_addr, dst_port);
+    p->stats.clock_rate = clock_rate;
+
+    mux_socket_ = socket;
+    initial_participants_.push_back(p);
 
     return RTP_OK;
 }
@@ -227,6 +358,7 @@ rtp_error_t uvgrtp::rtcp::add_participant(uint32_t ssrc)
     participants_[ssrc]->sr_frame    = nullptr;
     participants_[ssrc]->sdes_frame = nullptr;
     participants_[ssrc]->app_frame  = nullptr;
+    participants_[ssrc]->ecn_frame  = nullptr;
 
     return RTP_OK;
 }
@@ -311,6 +443,26 @@ rtp_error_t uvgrtp::rtcp::install_app_hook(std::function<void(std::shared_ptr<uv
     return RTP_OK;
 }
 
+rtp_error_t uvgrtp::rtcp::install_ecn_hook(void (*hook)(uvgrtp::frame::rtcp_ecn_feedback*))
+{
+    if (!hook)
+        return RTP_INVALID_VALUE;
+
+    ecn_hook_ = hook;
+    ecn_hook_f_ = nullptr;
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::rtcp::install_ecn_hook(std::function<void(std::shared_ptr<uvgrtp::frame::rtcp_ecn_feedback>)> ecn_handler)
+{
+    if (!ecn_handler)
+        return RTP_INVALID_VALUE;
+
+    ecn_hook_ = nullptr;
+    ecn_hook_f_ = ecn_handler;
+    return RTP_OK;
+}
+
 uvgrtp::frame::rtcp_sender_report* uvgrtp::rtcp::get_sender_packet(uint32_t ssrc)
 {
     if (participants_.find(ssrc) == participants_.end())
@@ -355,7 +507,18 @@ uvgrtp::frame::rtcp_app_packet* uvgrtp::rtcp::get_app_packet(uint32_t ssrc)
     return frame;
 }
 
-std::vector<uvgrtp::socket>& uvgrtp::rtcp::get_sockets()
+uvgrtp::frame::rtcp_ecn_feedback* uvgrtp::rtcp::get_ecn_feedback(uint32_t ssrc)
+{
+    if (participants_.find(ssrc) == participants_.end())
+        return nullptr;
+
+    auto frame = participants_[ssrc]->ecn_frame;
+    participants_[ssrc]->ecn_frame = nullptr;
+
+    return frame;
+}
+
+std::vector<uvgrtp::socket *>& uvgrtp::rtcp::get_sockets()
 {
     return sockets_;
 }
@@ -399,6 +562,11 @@ void uvgrtp::rtcp::zero_stats(uvgrtp::rtcp_statistics *stats)
     stats->base_seq = 0;
     stats->bad_seq  = 0;
     stats->cycles   = 0;
+
+    stats->ect0_pkts    = 0;
+    stats->ect1_pkts    = 0;
+    stats->ce_pkts      = 0;
+    stats->not_ect_pkts = 0;
 }
 
 bool uvgrtp::rtcp::is_participant(uint32_t ssrc)
@@ -446,9 +614,10 @@ rtp_error_t uvgrtp::rtcp::init_new_participant(uvgrtp::frame::rtp_frame *frame)
     participants_[frame->header.ssrc]->probation = MIN_SEQUENTIAL;
 
     /* This is the first RTP frame from remote to frame->header.timestamp represents t = 0
-     * Save the timestamp and current NTP timestamp so we can do jitter calculations later on */
+     * Save the timestamp and the arrival time so we can do jitter calculations later on */
     participants_[frame->header.ssrc]->stats.initial_rtp = frame->header.timestamp;
-    participants_[frame->header.ssrc]->stats.initial_ntp = uvgrtp::clock::ntp::now();
+    participants_[frame->header.ssrc]->stats.initial_ntp =
+        frame->arrival ? frame->arrival : uvgrtp::clock::ntp::now();
 
     senders_++;
 
@@ -564,6 +733,13 @@ void uvgrtp::rtcp::update_session_statistics(uvgrtp::frame::rtp_frame *frame)
     p->stats.received_pkts  += 1;
     p->stats.received_bytes += (uint32_t)frame->payload_len;
 
+    switch (frame->ecn) {
+        case uvgrtp::ECN_ECT0: p->stats.ect0_pkts++;    break;
+        case uvgrtp::ECN_ECT1: p->stats.ect1_pkts++;    break;
+        case uvgrtp::ECN_CE:   p->stats.ce_pkts++;      break;
+        default:               p->stats.not_ect_pkts++; break;
+    }
+
     /* calculate number of dropped packets */
     int extended_max = p->stats.cycles + p->stats.max_seq;
     int expected     = extended_max - p->stats.base_seq + 1;
@@ -571,11 +747,14 @@ void uvgrtp::rtcp::update_session_statistics(uvgrtp::frame::rtp_frame *frame)
     int dropped = expected - p->stats.received_pkts;
     p->stats.dropped_pkts = dropped >= 0 ? dropped : 0;
 
+    /* Convert the arrival time to RTP timestamp units. The NTP difference is
+     * a 32.32 fixed-point number of seconds, use 16 bits of the fraction */
+    uint64_t arrival_ntp = frame->arrival ? frame->arrival : uvgrtp::clock::ntp::now();
+    uint64_t elapsed     = arrival_ntp > p->stats.initial_ntp ? arrival_ntp - p->stats.initial_ntp : 0;
+
     uint64_t arrival =
-        p->stats.initial_rtp +
-        + uvgrtp::clock::ntp::diff_now(p->stats.initial_ntp)
-        * (p->stats.clock_rate
-        / 1000);
+        p->stats.initial_rtp
+        + (((elapsed >> 16) * p->stats.clock_rate) >> 16);
 
 	/* calculate interarrival jitter. See RFC 3550 A.8 */
     uint64_t transit = arrival - frame->header.timestamp;
@@ -608,6 +787,8 @@ rtp_error_t uvgrtp::rtcp::recv_packet_handler(void *arg, int flags, frame::rtp_f
     uvgrtp::frame::rtp_frame *frame = *out;
     uvgrtp::rtcp *rtcp              = (uvgrtp::rtcp *)arg;
 
+    std::lock_guard<std::mutex> lock(rtcp->recv_mtx_);
+
     /* If this is the first packet from remote, move the participant from initial_participants_
      * to participants_, initialize its state and put it on probation until enough valid
      * packets from them have been received
@@ -629,6 +810,16 @@ rtp_error_t uvgrtp::rtcp::recv_packet_handler(void *arg, int flags, frame::rtp_f
     return RTP_PKT_NOT_HANDLED;
 }
 
+rtp_error_t uvgrtp::rtcp::mux_packet_handler(void *arg, uint8_t *packet, size_t size)
+{
+    uvgrtp::rtcp *rtcp = (uvgrtp::rtcp *)arg;
+
+    /* the reports are generated by the RTCP runner concurrently */
+    std::lock_guard<std::mutex> lock(rtcp->recv_mtx_);
+
+    return rtcp->handle_incoming_packet(packet, size);
+}
+
 rtp_error_t uvgrtp::rtcp::send_packet_handler_vec(void *arg, uvgrtp::buf_vec& buffers)
 {
     ssize_t pkt_size = -uvgrtp::frame::HEADER_SIZE_RTP;
@@ -671,7 +862,7 @@ rtp_error_t uvgrtp::rtcp::handle_incoming_packet(uint8_t *buffer, size_t size)
         return RTP_INVALID_VALUE;
     }
 
-    if (header.pkt_type > uvgrtp::frame::RTCP_FT_APP ||
+    if (header.pkt_type > uvgrtp::frame::RTCP_FT_RTPFB ||
         header.pkt_type < uvgrtp::frame::RTCP_FT_SR) {
         LOG_ERROR("Invalid packet type (%u)!", header.pkt_type);
         return RTP_INVALID_VALUE;
@@ -702,6 +893,10 @@ rtp_error_t uvgrtp::rtcp::handle_incoming_packet(uint8_t *buffer, size_t size)
             ret = handle_app_packet(buffer, size, header);
             break;
 
+        case uvgrtp::frame::RTCP_FT_RTPFB:
+            ret = handle_rtpfb_packet(buffer, size, header);
+            break;
+
         default:
             LOG_WARN("Unknown packet received, type %d", header.pkt_type);
             break;
@@ -724,6 +919,15 @@ rtp_error_t uvgrtp::rtcp::handle_sdes_packet(uint8_t* packet, size_t size,
     if (srtcp_ && (ret = srtcp_->handle_rtcp_decryption(flags_, frame->ssrc, packet, size)) != RTP_OK)
         return ret;
 
+    if (!is_participant(frame->ssrc)) {
+        LOG_WARN("Got an SDES packet from an unknown participant");
+
+        if (add_participant(frame->ssrc) != RTP_OK) {
+            delete frame;
+            return RTP_GENERIC_ERROR;
+        }
+    }
+
     /* Deallocate previous frame from the buffer if it exists, it's going to get overwritten */
     if (participants_[frame->ssrc]->sdes_frame) {
         for (auto& item : participants_[frame->ssrc]->sdes_frame->items)
@@ -765,7 +969,8 @@ rtp_error_t uvgrtp::rtcp::handle_bye_packet(uint8_t* packet, size_t size)
             continue;
         }
 
-        delete participants_[ssrc]->socket;
+        if (participants_[ssrc]->socket != mux_socket_)
+            delete participants_[ssrc]->socket;
         delete participants_[ssrc];
         participants_.erase(ssrc);
     }
@@ -790,7 +995,11 @@ rtp_error_t uvgrtp::rtcp::handle_app_packet(uint8_t* packet, size_t size,
     /* Deallocate previous frame from the buffer if it exists, it's going to get overwritten */
     if (!is_participant(frame->ssrc)) {
         LOG_WARN("Got an APP packet from an unknown participant");
-        add_participant(frame->ssrc);
+
+        if (add_participant(frame->ssrc) != RTP_OK) {
+            delete frame;
+            return RTP_GENERIC_ERROR;
+        }
     }
 
     if (participants_[frame->ssrc]->app_frame) {
@@ -813,6 +1022,67 @@ rtp_error_t uvgrtp::rtcp::handle_app_packet(uint8_t* packet, size_t size,
     return RTP_OK;
 }
 
+rtp_error_t uvgrtp::rtcp::handle_rtpfb_packet(uint8_t* packet, size_t size,
+    uvgrtp::frame::rtcp_header& header)
+{
+    if (!packet || !size)
+        return RTP_INVALID_VALUE;
+
+    /* the count field of the header is the feedback message type */
+    if (header.count != RTPFB_FMT_ECN) {
+        LOG_DEBUG("Transport layer feedback message type %u is not supported", header.count);
+        return RTP_NOT_SUPPORTED;
+    }
+
+    if (size < (size_t)RTCP_HEADER_SIZE + SSRC_CSRC_SIZE * 2 + ECN_FEEDBACK_SIZE) {
+        LOG_ERROR("ECN feedback packet is too short");
+        return RTP_INVALID_VALUE;
+    }
+
+    auto frame = new uvgrtp::frame::rtcp_ecn_feedback;
+    frame->header = header;
+    frame->ssrc = ntohl(*(uint32_t*)&packet[RTCP_HEADER_SIZE]);
+
+    auto ret = RTP_OK;
+    if (srtcp_ && (ret = srtcp_->handle_rtcp_decryption(flags_, frame->ssrc, packet, size)) != RTP_OK) {
+        delete frame;
+        return ret;
+    }
+
+    if (!is_participant(frame->ssrc)) {
+        LOG_WARN("Got ECN feedback from an unknown participant");
+
+        if (add_participant(frame->ssrc) != RTP_OK) {
+            delete frame;
+            return RTP_GENERIC_ERROR;
+        }
+    }
+
+    /* Deallocate previous frame from the buffer if it exists, it's going to get overwritten */
+    if (participants_[frame->ssrc]->ecn_frame)
+        delete participants_[frame->ssrc]->ecn_frame;
+
+    int ptr = RTCP_HEADER_SIZE + SSRC_CSRC_SIZE;
+
+    frame->media_ssrc  = ntohl(*(uint32_t*)&packet[ptr]);
+    frame->ext_max_seq = ntohl(*(uint32_t*)&packet[ptr + 4]);
+    frame->ect0        = ntohl(*(uint32_t*)&packet[ptr + 8]);
+    frame->ect1        = ntohl(*(uint32_t*)&packet[ptr + 12]);
+    frame->ce          = ntohs(*(uint16_t*)&packet[ptr + 16]);
+    frame->not_ect     = ntohs(*(uint16_t*)&packet[ptr + 18]);
+    frame->lost        = ntohs(*(uint16_t*)&packet[ptr + 20]);
+    frame->duplicates  = ntohs(*(uint16_t*)&packet[ptr + 22]);
+
+    if (ecn_hook_)
+        ecn_hook_(frame);
+    else if (ecn_hook_f_)
+        ecn_hook_f_(std::shared_ptr<uvgrtp::frame::rtcp_ecn_feedback>(frame));
+    else
+        participants_[frame->ssrc]->ecn_frame = frame;
+
+    return RTP_OK;
+}
+
 rtp_error_t uvgrtp::rtcp::handle_receiver_report_packet(uint8_t* packet, size_t size, 
     uvgrtp::frame::rtcp_header& header)
 {
@@ -834,7 +1104,12 @@ rtp_error_t uvgrtp::rtcp::handle_receiver_report_packet(uint8_t* packet, size_t
      * Check if that's the case and if so, move the entry from initial_participants_ to participants_ */
     if (!is_participant(frame->ssrc)) {
         LOG_WARN("Got a Receiver Report from an unknown participant");
-        add_participant(frame->ssrc);
+
+        /* in a multicast group, there may be more receivers than we can keep track of */
+        if (add_participant(frame->ssrc) != RTP_OK) {
+            delete frame;
+            return RTP_GENERIC_ERROR;
+        }
     }
 
     if (!frame->header.count) {
@@ -874,7 +1149,11 @@ rtp_error_t uvgrtp::rtcp::handle_sender_report_packet(uint8_t* packet, size_t si
 
     if (!is_participant(frame->ssrc)) {
         LOG_WARN("Sender Report received from an unknown participant");
-        add_participant(frame->ssrc);
+
+        if (add_participant(frame->ssrc) != RTP_OK) {
+            delete frame;
+            return RTP_GENERIC_ERROR;
+        }
     }
 
     /* Deallocate previous frame from the buffer if it exists, it's going to get overwritten */
@@ -981,6 +1260,11 @@ rtp_error_t uvgrtp::rtcp::send_rtcp_packet_to_participants(uint8_t* frame, size_
 {
     rtp_error_t ret = RTP_OK;
     for (auto& p : participants_) {
+        /* Only the participant created for the remote address has a socket. In a multicast
+         * session all participants share the group address so the packet is sent only once */
+        if (!p.second->socket)
+            continue;
+
         if ((ret = p.second->socket->sendto(p.second->address, frame, frame_size, 0)) != RTP_OK) {
             LOG_ERROR("Sending rtcp packet with sendto() failed!");
             delete[] frame;
@@ -1069,7 +1353,58 @@ rtp_error_t uvgrtp::rtcp::generate_report()
         return ret;
     }
 
-    return send_rtcp_packet_to_participants(frame, frame_size);
+    if ((ret = send_rtcp_packet_to_participants(frame, frame_size)) != RTP_OK)
+        return ret;
+
+    if (flags_ & RCE_ECN)
+        return send_ecn_feedback();
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::rtcp::send_ecn_feedback()
+{
+    rtp_error_t ret = RTP_OK;
+
+    for (auto& p : participants_) {
+        auto& stats = p.second->stats;
+
+        if (!stats.received_pkts)
+            continue;
+
+        uint8_t* frame = nullptr;
+        int ptr = RTCP_HEADER_SIZE + SSRC_CSRC_SIZE;
+        size_t frame_size = RTCP_HEADER_SIZE + SSRC_CSRC_SIZE * 2 + ECN_FEEDBACK_SIZE;
+
+        if (flags_ & RCE_SRTP)
+            frame_size += UVG_SRTCP_INDEX_LENGTH + UVG_AUTH_TAG_LENGTH;
+
+        if ((ret = construct_rtcp_header(frame_size, frame, RTPFB_FMT_ECN,
+                uvgrtp::frame::RTCP_FT_RTPFB, true)) != RTP_OK)
+            return ret;
+
+        rtcp_pkt_sent_count_++;
+
+        /* The 16-bit counters are allowed to wrap, see RFC 6679 section 5.1 */
+        SET_NEXT_FIELD_32(frame, ptr, htonl(p.first)); /* media ssrc */
+        SET_NEXT_FIELD_32(frame, ptr, htonl(stats.cycles + stats.max_seq));
+        SET_NEXT_FIELD_32(frame, ptr, htonl(stats.ect0_pkts));
+        SET_NEXT_FIELD_32(frame, ptr, htonl(stats.ect1_pkts));
+        SET_NEXT_FIELD_32(frame, ptr, htonl(((stats.ce_pkts & 0xffff) << 16) | (stats.not_ect_pkts & 0xffff)));
+        SET_NEXT_FIELD_32(frame, ptr, htonl((stats.dropped_pkts & 0xffff) << 16)); /* duplicates are not counted */
+
+        if (srtcp_ && (ret = srtcp_->handle_rtcp_encryption(flags_, rtcp_pkt_sent_count_, ssrc_, frame, frame_size)) != RTP_OK)
+        {
+            LOG_DEBUG("Encryption failed. Not sending packet");
+            delete[] frame;
+            return ret;
+        }
+
+        if ((ret = send_rtcp_packet_to_participants(frame, frame_size)) != RTP_OK)
+            return ret;
+    }
+
+    return ret;
 }
 
 rtp_error_t uvgrtp::rtcp::send_sdes_packet(std::vector<uvgrtp::frame::rtcp_sdes_item>& items)
@@ -1,6 +1,7 @@
 #include "rtp.hh"
 
 #include "frame.hh"
+#include "frame_pool.hh"
 #include "debug.hh"
 #include "random.hh"
 
@@ -10,6 +11,7 @@
 #endif
 
 #include <chrono>
+#include <cstring>
 
 
 
@@ -19,6 +21,7 @@ uvgrtp::rtp::rtp(rtp_format_t fmt):
     wc_start_(0),
     sent_pkts_(0),
     timestamp_(INVALID_TS),
+    payload_limit_(0),
     delay_(PKT_MAX_DELAY)
 {
     seq_  = uvgrtp::random::generate_32() & 0xffff;
@@ -127,7 +130,7 @@ uint32_t uvgrtp::rtp::get_clock_rate(void)
     return clock_rate_;
 }
 
-void uvgrtp::rtp::set_payload_size(size_t payload_size)
+size_t uvgrtp::rtp::subtract_format_header(size_t payload_size)
 {
     switch (fmt_) {
         case RTP_FORMAT_H264:
@@ -138,7 +141,25 @@ void uvgrtp::rtp::set_payload_size(size_t payload_size)
             break;
     }
 
-    payload_size_ = payload_size;
+    return payload_size;
+}
+
+void uvgrtp::rtp::set_payload_size(size_t payload_size)
+{
+    max_payload_size_ = subtract_format_header(payload_size);
+    payload_size_     = max_payload_size_;
+
+    if (payload_limit_ && payload_limit_ < payload_size_)
+        payload_size_ = payload_limit_;
+}
+
+void uvgrtp::rtp::set_payload_limit(size_t payload_limit)
+{
+    payload_limit_ = payload_limit ? subtract_format_header(payload_limit) : 0;
+    payload_size_  = max_payload_size_;
+
+    if (payload_limit_ && payload_limit_ < payload_size_)
+        payload_size_ = payload_limit_;
 }
 
 size_t uvgrtp::rtp::get_payload_size()
@@ -151,6 +172,11 @@ rtp_format_t uvgrtp::rtp::get_payload()
     return (rtp_format_t)fmt_;
 }
 
+uint8_t uvgrtp::rtp::get_payload_type()
+{
+    return payload_;
+}
+
 void uvgrtp::rtp::set_pkt_max_delay(size_t delay)
 {
     delay_ = delay;
@@ -161,7 +187,7 @@ size_t uvgrtp::rtp::get_pkt_max_delay()
     return delay_;
 }
 
-rtp_error_t uvgrtp::rtp::packet_handler(ssize_t size, void *packet, int flags, uvgrtp::frame::rtp_frame **out)
+rtp_error_t uvgrtp::rtp::packet_handler(void *arg, ssize_t size, void *packet, int flags, uvgrtp::frame::rtp_frame **out)
 {
     (void)flags;
 
@@ -175,7 +201,7 @@ rtp_error_t uvgrtp::rtp::packet_handler(ssize_t size, void *packet, int flags, u
     if (((ptr[0] >> 6) & 0x03) != 0x2)
         return RTP_PKT_NOT_HANDLED;
 
-    if (!(*out = uvgrtp::frame::alloc_rtp_frame()))
+    if (!(*out = uvgrtp::frame::alloc_pooled_frame((uvgrtp::frame_pool *)arg, 0)))
         return RTP_GENERIC_ERROR;
 
     (*out)->header.version   = (ptr[0] >> 6) & 0x03;
@@ -239,7 +265,8 @@ rtp_error_t uvgrtp::rtp::packet_handler(ssize_t size, void *packet, int flags, u
         (*out)->padding_len  = padding_len;
     }
 
-    (*out)->payload    = (uint8_t *)memdup(ptr, (*out)->payload_len);
+    (*out)->payload    = uvgrtp::frame::alloc_payload(*out, (*out)->payload_len, (*out)->payload_class);
+    std::memcpy((*out)->payload, ptr, (*out)->payload_len);
     (*out)->dgram      = (uint8_t *)packet;
     (*out)->dgram_size = size;
 
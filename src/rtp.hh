@@ -21,6 +21,7 @@ namespace uvgrtp {
             size_t       get_payload_size();
             size_t       get_pkt_max_delay();
             rtp_format_t get_payload();
+            uint8_t      get_payload_type();
 
             void inc_sent_pkts();
             void inc_sequence();
@@ -30,15 +31,22 @@ namespace uvgrtp {
             void set_dynamic_payload(uint8_t payload);
             void set_timestamp(uint64_t timestamp);
             void set_payload_size(size_t payload_size);
+
+            /* Limit the payload size below the configured one, e.g., to fit into the path MTU. 0 removes the limit */
+            void set_payload_limit(size_t payload_limit);
             void set_pkt_max_delay(size_t delay);
 
             void fill_header(uint8_t *buffer);
             void update_sequence(uint8_t *buffer);
 
-            /* Validates the RTP header pointed to by "packet" */
-            static rtp_error_t packet_handler(ssize_t size, void *packet, int flags, frame::rtp_frame **out);
+            /* Validates the RTP header pointed to by "packet"
+             *
+             * The frame is allocated from the frame pool "arg" of the media stream, if it is not nullptr */
+            static rtp_error_t packet_handler(void *arg, ssize_t size, void *packet, int flags, frame::rtp_frame **out);
 
         private:
+            /* Subtract the size of the payload header of the format, e.g., the FU header of H.265 */
+            size_t subtract_format_header(size_t payload_size);
 
             uint32_t ssrc_;
             uint32_t ts_;
@@ -61,6 +69,11 @@ namespace uvgrtp {
              * (maximum amount of payload bytes when MTU is 1500) */
             size_t payload_size_;
 
+            /* Payload size set with set_payload_size() and the limit set with set_payload_limit(),
+             * "payload_size_" is the smaller of the two */
+            size_t max_payload_size_;
+            size_t payload_limit_;
+
             /* What is the maximum delay allowed for each frame
              * i.e. how long does the packet receiver wait for
              * all fragments of a frame until it's considered late and dropped
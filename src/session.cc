@@ -1,22 +1,24 @@
 #include "session.hh"
 
+#include "bundle.hh"
 #include "media_stream.hh"
 #include "zrtp.hh"
 #include "crypto.hh"
 #include "debug.hh"
 
 
-uvgrtp::session::session(std::string addr):
+uvgrtp::session::session(std::string addr, uvgrtp::reactor *reactor):
 #ifdef __RTP_CRYPTO__
     zrtp_(nullptr),
 #endif
     addr_(addr),
-    laddr_("")
+    laddr_(""),
+    reactor_(reactor)
 {
 }
 
-uvgrtp::session::session(std::string remote_addr, std::string local_addr):
-    session(remote_addr)
+uvgrtp::session::session(std::string remote_addr, std::string local_addr, uvgrtp::reactor *reactor):
+    session(remote_addr, reactor)
 {
     laddr_ = local_addr;
 }
@@ -45,10 +47,36 @@ uvgrtp::media_stream *uvgrtp::session::create_stream(int r_port, int s_port, rtp
         return nullptr;
     }
 
+    if (flags & RCE_BUNDLE) {
+        /* these need a socket or a receive loop of their own */
+        int exclusive = RCE_RECV_SHARDS | RCE_AF_XDP | RCE_IO_URING | RCE_MSG_ZEROCOPY | RCE_PMTU_DISCOVERY |
+                        RCE_LOOPBACK_TRANSPORT | RCE_SHM_TRANSPORT | RCE_SRTP_KMNGMNT_ZRTP;
+
+        if (flags & exclusive) {
+            LOG_ERROR("Flags 0x%x cannot be used with RCE_BUNDLE", flags & exclusive);
+            rtp_errno = RTP_NOT_SUPPORTED;
+            return nullptr;
+        }
+
+        /* the RTCP packets of the bundled media streams are told apart by SSRC */
+        if (flags & RCE_RTCP)
+            flags |= RCE_RTCP_MUX;
+    }
+
     if (laddr_ == "")
-        stream = new uvgrtp::media_stream(addr_, r_port, s_port, fmt, flags);
+        stream = new uvgrtp::media_stream(addr_, r_port, s_port, fmt, flags, reactor_);
     else
-        stream = new uvgrtp::media_stream(addr_, laddr_, r_port, s_port, fmt, flags);
+        stream = new uvgrtp::media_stream(addr_, laddr_, r_port, s_port, fmt, flags, reactor_);
+
+    if (flags & RCE_BUNDLE) {
+        auto& entry = bundles_[std::make_pair(r_port, s_port)];
+        auto bundle = entry.lock();
+
+        if (!bundle)
+            entry = bundle = std::make_shared<uvgrtp::bundle>();
+
+        stream->set_bundle(bundle);
+    }
 
     if (flags & RCE_SRTP) {
         if (!uvgrtp::crypto::enabled()) {
@@ -0,0 +1,666 @@
+#include "shm.hh"
+
+#include "debug.hh"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+#define F_SEAL_SEAL   0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW   0x0004
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <errno.h>
+
+#ifdef __linux__
+/* Identifies a ring created by this version of uvgRTP */
+static const uint32_t SHM_MAGIC = 0x75767368;
+
+/* Each slot starts with the length of the datagram */
+static const size_t SHM_MAX_DATAGRAM = uvgrtp::SHM_SLOT_SIZE - sizeof(uint32_t);
+
+/* Start of the shared memory. The indices are free-running and the slot of
+ * index "i" is "i & (slots - 1)". Each index is written by one side only and
+ * they are kept in separate cache lines so that the two sides do not contend */
+struct uvgrtp::shm::ring_header {
+    uint32_t magic;
+    uint32_t slots;
+    uint32_t slot_size;
+
+    /* written by the sender */
+    alignas(64) std::atomic<uint32_t> head;
+
+    /* written by the receiver */
+    alignas(64) std::atomic<uint32_t> tail;
+
+    /* set by the receiver when it has found the ring empty and cleared
+     * by the sender when it signals the eventfd */
+    alignas(64) std::atomic<uint32_t> sleeping;
+};
+
+static bool is_local_address(sockaddr_in& addr)
+{
+    struct ifaddrs *ifaddrs = nullptr;
+    bool local = false;
+
+    if ((ntohl(addr.sin_addr.s_addr) & 0xff000000) == 0x7f000000)
+        return true;
+
+    if (getifaddrs(&ifaddrs) < 0) {
+        log_platform_error("getifaddrs(3) failed");
+        return false;
+    }
+
+    for (struct ifaddrs *ifa = ifaddrs; ifa && !local; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET)
+            local = ((sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr == addr.sin_addr.s_addr;
+    }
+    freeifaddrs(ifaddrs);
+
+    return local;
+}
+#endif
+
+uvgrtp::shm::shm()
+#ifdef __linux__
+    :
+    listen_fd_(-1),
+    epoll_fd_(-1),
+    rx_tail_(0),
+    has_remote_(false),
+    tx_ready_(false),
+    tx_head_(0),
+    tx_dropped_(0),
+    tx_retry_(std::chrono::steady_clock::now())
+#endif
+{
+}
+
+uvgrtp::shm::~shm()
+{
+#ifdef __linux__
+    close_ring(rx_);
+    close_ring(tx_);
+
+    if (listen_fd_ != -1)
+        close(listen_fd_);
+
+    if (epoll_fd_ != -1)
+        close(epoll_fd_);
+#endif
+}
+
+rtp_error_t uvgrtp::shm::listen(uint16_t port)
+{
+#ifdef __linux__
+    struct sockaddr_un addr;
+    socklen_t len = make_address(addr, port);
+
+    if ((listen_fd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) < 0) {
+        log_platform_error("Failed to create the shared-memory listener");
+        return RTP_GENERIC_ERROR;
+    }
+
+    if (::bind(listen_fd_, (struct sockaddr *)&addr, len) < 0 || ::listen(listen_fd_, 4) < 0) {
+        LOG_WARN("Cannot accept shared-memory senders on port %u: %s", port, strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return RTP_GENERIC_ERROR;
+    }
+
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events  = EPOLLIN;
+    event.data.fd = listen_fd_;
+
+    if ((epoll_fd_ = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event) < 0) {
+        log_platform_error("Failed to create the shared-memory epoll instance");
+        return RTP_GENERIC_ERROR;
+    }
+
+    return RTP_OK;
+#else
+    (void)port;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::shm::set_remote(sockaddr_in& remote)
+{
+#ifdef __linux__
+    if (!is_local_address(remote))
+        return RTP_NOT_SUPPORTED;
+
+    remote_     = remote;
+    has_remote_ = true;
+
+    return RTP_OK;
+#else
+    (void)remote;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::shm::send(sockaddr_in& addr, uvgrtp::buf_vec& buffer, int *bytes_sent)
+{
+#ifdef __linux__
+    size_t len = 0;
+
+    for (auto& chunk : buffer)
+        len += chunk.first;
+
+    if (len > SHM_MAX_DATAGRAM || !ready(addr))
+        return RTP_NOT_SUPPORTED;
+
+    (void)push(buffer, len);
+    publish();
+
+    set_bytes(bytes_sent, (int)len);
+    return RTP_OK;
+#else
+    (void)addr, (void)buffer, (void)bytes_sent;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::shm::send(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int *bytes_sent)
+{
+#ifdef __linux__
+    int sent_bytes = 0;
+
+    for (auto& buffer : buffers) {
+        size_t len = 0;
+
+        for (auto& chunk : buffer)
+            len += chunk.first;
+
+        if (len > SHM_MAX_DATAGRAM)
+            return RTP_NOT_SUPPORTED;
+    }
+
+    if (!ready(addr))
+        return RTP_NOT_SUPPORTED;
+
+    for (auto& buffer : buffers) {
+        size_t len = 0;
+
+        for (auto& chunk : buffer)
+            len += chunk.first;
+
+        (void)push(buffer, len);
+        sent_bytes += (int)len;
+    }
+
+    publish();
+    set_bytes(bytes_sent, sent_bytes);
+    return RTP_OK;
+#else
+    (void)addr, (void)buffers, (void)bytes_sent;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+uint64_t uvgrtp::shm::get_dropped()
+{
+#ifdef __linux__
+    return tx_dropped_.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+int uvgrtp::shm::get_fd()
+{
+#ifdef __linux__
+    return epoll_fd_;
+#else
+    return -1;
+#endif
+}
+
+rtp_error_t uvgrtp::shm::recv(uvgrtp::transport_datagram *dgrams, size_t count, size_t *ndgrams)
+{
+#ifdef __linux__
+    uint32_t avail = rx_.hdr ? rx_.hdr->head.load(std::memory_order_acquire) - rx_tail_ : 0;
+
+    /* Clear the wakeup and handle the connections, then tell the sender to signal the eventfd and
+     * check the ring once more, otherwise a datagram written after the check above would be missed */
+    if (!avail) {
+        poll();
+
+        if (!rx_.hdr)
+            return RTP_INTERRUPTED;
+
+        rx_.hdr->sleeping.store(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!(avail = rx_.hdr->head.load(std::memory_order_acquire) - rx_tail_))
+            return RTP_INTERRUPTED;
+    }
+
+    if (rx_.hdr->sleeping.load(std::memory_order_relaxed))
+        rx_.hdr->sleeping.store(0, std::memory_order_relaxed);
+
+    *ndgrams = std::min((size_t)std::min(avail, SHM_SLOTS), count);
+
+    for (size_t i = 0; i < *ndgrams; ++i) {
+        uint8_t *slot = rx_.slots + ((rx_tail_ + i) & (SHM_SLOTS - 1)) * SHM_SLOT_SIZE;
+        uint32_t len;
+
+        memcpy(&len, slot, sizeof(len));
+
+        /* the memory is shared with another process, do not trust it */
+        dgrams[i].data = slot + sizeof(len);
+        dgrams[i].len  = (len <= SHM_MAX_DATAGRAM) ? len : 0;
+    }
+
+    return RTP_OK;
+#else
+    (void)dgrams, (void)count, (void)ndgrams;
+    return RTP_INTERRUPTED;
+#endif
+}
+
+void uvgrtp::shm::release(size_t count)
+{
+#ifdef __linux__
+    rx_tail_ += (uint32_t)count;
+    rx_.hdr->tail.store(rx_tail_, std::memory_order_release);
+#else
+    (void)count;
+#endif
+}
+
+#ifdef __linux__
+bool uvgrtp::shm::ready(sockaddr_in& addr)
+{
+    if (!has_remote_ || addr.sin_addr.s_addr != remote_.sin_addr.s_addr || addr.sin_port != remote_.sin_port)
+        return false;
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (tx_.conn_fd == -1) {
+        if (now < tx_retry_)
+            return false;
+
+        tx_retry_ = now + std::chrono::milliseconds(SHM_RETRY_INTERVAL);
+
+        if (connect() != RTP_OK)
+            return false;
+    }
+
+    if (tx_ready_ && now < tx_retry_)
+        return true;
+
+    /* The receiver acknowledges the ring with one byte and closes the
+     * connection if it rejects the ring or when it goes away */
+    char ack;
+    ssize_t ret = ::recv(tx_.conn_fd, &ack, sizeof(ack), MSG_DONTWAIT);
+
+    if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        if (tx_ready_) {
+            LOG_DEBUG("Shared-memory receiver has gone away, sending through the socket");
+        }
+
+        close_ring(tx_);
+        tx_ready_ = false;
+        tx_retry_ = now + std::chrono::milliseconds(SHM_RETRY_INTERVAL);
+        return false;
+    }
+
+    if (ret > 0 && !tx_ready_) {
+        LOG_DEBUG("Sending to port %u through shared memory", ntohs(remote_.sin_port));
+        tx_ready_ = true;
+    }
+
+    if (tx_ready_)
+        tx_retry_ = now + std::chrono::milliseconds(SHM_RETRY_INTERVAL);
+
+    return tx_ready_;
+}
+
+void uvgrtp::shm::poll()
+{
+    struct epoll_event events[3];
+    bool closed   = false;
+    bool received = false;
+    bool pending  = false;
+    int nevents;
+
+    if (epoll_fd_ == -1 || (nevents = epoll_wait(epoll_fd_, events, 3, 0)) <= 0)
+        return;
+
+    /* the events are acted on only after all of them have been looked at so that
+     * a descriptor number reused by accept() is not mistaken for the closed one */
+    for (int i = 0; i < nevents; ++i) {
+        if (events[i].data.fd == listen_fd_) {
+            pending = true;
+        } else if (events[i].data.fd == rx_.conn_fd) {
+            /* before the ring has been received, the connection becomes readable when the ring arrives */
+            if (rx_.hdr)
+                closed = true;
+            else
+                received = true;
+        } else if (events[i].data.fd == rx_.event_fd) {
+            uint64_t count;
+            (void)::read(rx_.event_fd, &count, sizeof(count));
+        }
+    }
+
+    if (closed) {
+        LOG_DEBUG("Shared-memory sender has gone away");
+        close_ring(rx_);
+    }
+
+    if (received)
+        receive_ring();
+
+    if (pending)
+        accept();
+}
+
+socklen_t uvgrtp::shm::make_address(struct sockaddr_un& addr, uint16_t port)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    /* abstract address, the name starts after the leading null byte */
+    int len = snprintf(addr.sun_path + 1, sizeof(addr.sun_path) - 1, "uvgrtp-shm-%u", port);
+
+    return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + len);
+}
+
+rtp_error_t uvgrtp::shm::connect()
+{
+    struct sockaddr_un addr;
+    socklen_t len = make_address(addr, ntohs(remote_.sin_port));
+    int mem_fd    = -1;
+
+    if ((tx_.conn_fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) < 0) {
+        log_platform_error("Failed to create the shared-memory socket");
+        return RTP_GENERIC_ERROR;
+    }
+
+    /* the receiver is not running or it has not enabled the shared-memory transport */
+    if (::connect(tx_.conn_fd, (struct sockaddr *)&addr, len) < 0) {
+        close_ring(tx_);
+        return RTP_GENERIC_ERROR;
+    }
+
+    tx_.map_len = sizeof(ring_header) + (size_t)SHM_SLOTS * SHM_SLOT_SIZE;
+
+    /* The seals prevent the size of the memory from changing after
+     * the receiver has mapped it, which would crash the receiver */
+    if ((mem_fd = (int)syscall(__NR_memfd_create, "uvgrtp-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0 ||
+        ftruncate(mem_fd, (off_t)tx_.map_len) < 0 ||
+        fcntl(mem_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        log_platform_error("Failed to create the shared-memory ring");
+        goto error;
+    }
+
+    tx_.hdr = (ring_header *)mmap(nullptr, tx_.map_len, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0);
+
+    if ((void *)tx_.hdr == MAP_FAILED) {
+        log_platform_error("Failed to map the shared-memory ring");
+        tx_.hdr = nullptr;
+        goto error;
+    }
+
+    tx_.slots          = (uint8_t *)tx_.hdr + sizeof(ring_header);
+    tx_.hdr->magic     = SHM_MAGIC;
+    tx_.hdr->slots     = SHM_SLOTS;
+    tx_.hdr->slot_size = (uint32_t)SHM_SLOT_SIZE;
+    tx_.hdr->sleeping  = 1;
+    tx_head_           = 0;
+
+    if ((tx_.event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+        log_platform_error("Failed to create the shared-memory eventfd");
+        goto error;
+    }
+
+    {
+        int fds[2] = { mem_fd, tx_.event_fd };
+        char byte  = 0;
+        struct iovec iov = { &byte, sizeof(byte) };
+        union {
+            char buf[CMSG_SPACE(sizeof(fds))];
+            struct cmsghdr align;
+        } control;
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type  = SCM_RIGHTS;
+        cm->cmsg_len   = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+        if (::sendmsg(tx_.conn_fd, &msg, MSG_NOSIGNAL) < 0) {
+            log_platform_error("Failed to pass the shared-memory ring to the receiver");
+            goto error;
+        }
+    }
+
+    /* the mapping keeps the memory alive */
+    close(mem_fd);
+    return RTP_OK;
+
+error:
+    if (mem_fd >= 0)
+        close(mem_fd);
+
+    close_ring(tx_);
+    return RTP_GENERIC_ERROR;
+}
+
+void uvgrtp::shm::accept()
+{
+    int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+    if (fd < 0)
+        return;
+
+    /* the ring has one producer, the other senders keep using UDP */
+    if (rx_.conn_fd != -1) {
+        LOG_DEBUG("Shared-memory receiver already has a sender");
+        close(fd);
+        return;
+    }
+
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events  = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+        log_platform_error("Failed to add the shared-memory connection to epoll");
+        close(fd);
+        return;
+    }
+
+    rx_.conn_fd = fd;
+
+    /* the sender passes the ring right after connecting so it is usually already here */
+    receive_ring();
+}
+
+void uvgrtp::shm::receive_ring()
+{
+    int fds[2] = { -1, -1 };
+    char byte;
+    struct iovec iov = { &byte, sizeof(byte) };
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    struct stat st;
+    ssize_t ret;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    if ((ret = ::recvmsg(rx_.conn_fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC)) < 0 &&
+        (errno == EAGAIN || errno == EWOULDBLOCK))
+        return;
+
+    if (ret <= 0) {
+        close_ring(rx_);
+        return;
+    }
+
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+
+    if (!cm || cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS || cm->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        LOG_WARN("Shared-memory sender did not pass a ring");
+
+        /* do not leak the descriptors of a misbehaving sender */
+        for (; cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS)
+                continue;
+
+            for (size_t i = 0; i < (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int); ++i) {
+                int passed;
+                memcpy(&passed, CMSG_DATA(cm) + i * sizeof(int), sizeof(passed));
+                close(passed);
+            }
+        }
+
+        close_ring(rx_);
+        return;
+    }
+
+    memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+    rx_.event_fd = fds[1];
+    rx_.map_len  = sizeof(ring_header) + (size_t)SHM_SLOTS * SHM_SLOT_SIZE;
+
+    int seals = fcntl(fds[0], F_GET_SEALS);
+
+    if (fstat(fds[0], &st) < 0 || (size_t)st.st_size != rx_.map_len ||
+        seals < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW)) {
+        LOG_WARN("Invalid shared-memory ring");
+        close(fds[0]);
+        close_ring(rx_);
+        return;
+    }
+
+    rx_.hdr = (ring_header *)mmap(nullptr, rx_.map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+
+    if ((void *)rx_.hdr == MAP_FAILED) {
+        log_platform_error("Failed to map the shared-memory ring");
+        rx_.hdr = nullptr;
+        close_ring(rx_);
+        return;
+    }
+    rx_.slots = (uint8_t *)rx_.hdr + sizeof(ring_header);
+
+    if (rx_.hdr->magic != SHM_MAGIC || rx_.hdr->slots != SHM_SLOTS || rx_.hdr->slot_size != SHM_SLOT_SIZE) {
+        LOG_WARN("Shared-memory ring of an incompatible sender");
+        close_ring(rx_);
+        return;
+    }
+
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events  = EPOLLIN;
+    event.data.fd = rx_.event_fd;
+
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, rx_.event_fd, &event) < 0 ||
+        ::send(rx_.conn_fd, &byte, sizeof(byte), MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        log_platform_error("Failed to accept the shared-memory ring");
+        close_ring(rx_);
+        return;
+    }
+
+    rx_tail_ = rx_.hdr->tail.load(std::memory_order_acquire);
+
+    LOG_DEBUG("Receiving through shared memory");
+}
+
+bool uvgrtp::shm::push(uvgrtp::buf_vec& buffer, size_t len)
+{
+    if (tx_head_ - tx_.hdr->tail.load(std::memory_order_acquire) >= SHM_SLOTS) {
+        tx_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint8_t *slot = tx_.slots + (tx_head_ & (SHM_SLOTS - 1)) * SHM_SLOT_SIZE;
+    uint32_t slot_len = (uint32_t)len;
+    size_t offset = sizeof(slot_len);
+
+    memcpy(slot, &slot_len, sizeof(slot_len));
+
+    for (auto& chunk : buffer) {
+        memcpy(slot + offset, chunk.second, chunk.first);
+        offset += chunk.first;
+    }
+
+    ++tx_head_;
+    return true;
+}
+
+void uvgrtp::shm::publish()
+{
+    tx_.hdr->head.store(tx_head_, std::memory_order_release);
+
+    /* pairs with the fence of the receiver in recv(), either the receiver sees
+     * the new head or the sender sees that the receiver is going to sleep */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (tx_.hdr->sleeping.load(std::memory_order_relaxed) && tx_.hdr->sleeping.exchange(0)) {
+        uint64_t one = 1;
+        (void)::write(tx_.event_fd, &one, sizeof(one));
+    }
+}
+
+void uvgrtp::shm::close_ring(ring& r)
+{
+    if (r.hdr)
+        munmap(r.hdr, r.map_len);
+
+    if (r.event_fd != -1)
+        close(r.event_fd);
+
+    if (r.conn_fd != -1)
+        close(r.conn_fd);
+
+    r = ring();
+}
+#endif
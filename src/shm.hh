@@ -0,0 +1,136 @@
+#pragma once
+
+#include "transport.hh"
+#include "util.hh"
+
+#ifdef __linux__
+#include <sys/un.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+
+namespace uvgrtp {
+
+    /* Size of one slot of the shared-memory ring. A slot holds one datagram and its length
+     * so frames with larger packets (see RCC_MTU_SIZE) are sent through the socket instead */
+    const size_t SHM_SLOT_SIZE = 2048;
+
+    /* Number of slots in the ring. Must be a power of two */
+    const uint32_t SHM_SLOTS = 4096;
+
+    /* How often (milliseconds) the sender tries to connect to the receiver
+     * and checks that the receiver is still alive */
+    const int SHM_RETRY_INTERVAL = 1000;
+
+    /* Shared-memory transport between two media streams on the same host (Linux only)
+     *
+     * The receiver listens on an abstract Unix domain socket named after its UDP port.
+     * The sender creates a memfd holding a single-producer single-consumer ring of datagram
+     * slots and an eventfd, and passes both to the receiver over the Unix socket (SCM_RIGHTS).
+     * After that, the datagrams are written to the ring without system calls and the eventfd
+     * is signaled only when the receiver has found the ring empty and is about to sleep.
+     *
+     * Until the receiver has accepted the ring, and after it has gone away, the datagrams are
+     * sent through the UDP socket as usual. The receiver accepts one sender at a time, the
+     * other senders keep using UDP. If the ring is full, the datagram is dropped.
+     *
+     * The received datagrams point to the ring */
+    class shm : public transport {
+        public:
+            shm();
+            ~shm();
+
+            /* Accept rings from the senders of UDP port "port"
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the shared-memory transport is not supported
+             * Return RTP_GENERIC_ERROR if creating the Unix socket failed */
+            rtp_error_t listen(uint16_t port);
+
+            /* Send the datagrams destined to "remote" through a ring if "remote" is an address of this host
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if "remote" is not local or if the transport is not supported */
+            rtp_error_t set_remote(sockaddr_in& remote);
+
+            /* Write the packets to the ring if the receiver has accepted it
+             *
+             * Return RTP_NOT_SUPPORTED if the ring is not connected to "addr"
+             * or if a packet does not fit into a slot, nothing is written then */
+            rtp_error_t send(sockaddr_in& addr, uvgrtp::buf_vec& buffer, int *bytes_sent);
+            rtp_error_t send(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int *bytes_sent);
+
+            /* Return the number of datagrams dropped because the ring was full */
+            uint64_t get_dropped();
+
+            /* Get the file descriptor that becomes readable when datagrams or
+             * connections are received, -1 if listen() has not been called */
+            int get_fd();
+
+            /* The connections are accepted and closed when the ring is found empty */
+            rtp_error_t recv(uvgrtp::transport_datagram *dgrams, size_t count, size_t *ndgrams);
+
+            /* Give the slots of the "count" datagrams returned by the previous recv() back to the sender */
+            void release(size_t count);
+
+        private:
+#ifdef __linux__
+            struct ring_header;
+
+            struct ring {
+                ring_header *hdr = nullptr;
+                uint8_t *slots   = nullptr;
+                size_t map_len   = 0;
+                int event_fd     = -1;
+                int conn_fd      = -1;
+            };
+
+            /* Return true if the datagrams to "addr" can be written to the ring
+             *
+             * This connects to the receiver at most once per SHM_RETRY_INTERVAL and
+             * completes the handshake without blocking */
+            bool ready(sockaddr_in& addr);
+
+            /* Accept or close the connections and clear the wakeup */
+            void poll();
+
+            /* Fill the abstract address of the Unix socket of UDP port "port" */
+            socklen_t make_address(struct sockaddr_un& addr, uint16_t port);
+
+            /* Create the ring and pass it to the receiver */
+            rtp_error_t connect();
+
+            /* Accept a sender */
+            void accept();
+
+            /* Receive the ring of the accepted sender and map it */
+            void receive_ring();
+
+            /* Write one packet to the slot after the cached head */
+            bool push(uvgrtp::buf_vec& buffer, size_t len);
+
+            /* Make the pushed datagrams visible to the receiver and wake it up if needed */
+            void publish();
+
+            void close_ring(ring& r);
+
+            /* receiving end */
+            int listen_fd_;
+            int epoll_fd_;
+            ring rx_;
+            uint32_t rx_tail_;
+
+            /* sending end */
+            sockaddr_in remote_;
+            bool has_remote_;
+            bool tx_ready_;
+            ring tx_;
+            uint32_t tx_head_;
+            std::atomic<uint64_t> tx_dropped_; /* read by get_dropped() from other threads */
+            std::chrono::steady_clock::time_point tx_retry_;
+#endif
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
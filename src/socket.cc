@@ -1,6 +1,12 @@
 #include "socket.hh"
 
 #include "debug.hh"
+#include "pacer.hh"
+#include "pmtu.hh"
+#include "random.hh"
+#include "transport.hh"
+#include "uring.hh"
+#include "xdp.hh"
 #include "util.hh"
 
 #ifdef _WIN32
@@ -11,6 +17,25 @@
 #include <unistd.h>
 #include <poll.h>
 #include <fcntl.h>
+#include <netinet/udp.h>
+#include <sys/ioctl.h>
+#endif
+
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/sockios.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#endif
+
+#if defined(__linux__) && !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103
 #endif
 
 #if defined(__MINGW32__) || defined(__MINGW64__)
@@ -19,20 +44,63 @@ using namespace uvgrtp;
 using namespace mingw;
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <cassert>
+#include <map>
+#include <mutex>
+#include <thread>
 
 
 #define WSABUF_SIZE 256
 
+/* Completion tracking of MSG_ZEROCOPY sends, see uvgrtp::socket::reap_zerocopy() */
+struct uvgrtp::zerocopy_state {
+    /* cleared if the kernel reports that it had to copy the data anyway */
+    std::atomic<bool> enabled{true};
+
+    /* identifier of the next zero-copy send, updated by the sending thread */
+    std::atomic<uint32_t> sent{0};
+
+    /* all sends below "done" have completed. Ranges that completed out of
+     * order are kept in "ranges" until the gap before them is filled */
+    std::atomic<uint32_t> done{0};
+    std::map<uint32_t, uint32_t> ranges;
+    std::mutex mtx;
+};
+
 uvgrtp::socket::socket(int flags):
     socket_(-1),
-    flags_(flags)
+    flags_(flags),
+    gso_(false),
+    shared_(false),
+    uring_(nullptr),
+    xdp_(nullptr),
+    transport_(nullptr),
+    pmtu_(nullptr),
+    tos_(0),
+    priority_tos_(-1),
+    pacer_(nullptr),
+    zc_(nullptr),
+    redundant_(nullptr),
+    counters_()
 {
 }
 
 uvgrtp::socket::~socket()
 {
+    delete uring_;
+    delete xdp_;
+    delete transport_;
+    delete pmtu_;
+    delete pacer_;
+    delete zc_;
+
+    if (shared_)
+        return;
+
 #ifdef __linux__
     close(socket_);
 #else
@@ -61,6 +129,34 @@ rtp_error_t uvgrtp::socket::init(short family, int type, int protocol)
     WSAIoctl(socket_, _WSAIOW(IOC_VENDOR, 12), &bNewBehavior, sizeof(bNewBehavior), NULL, 0, &dwBytesReturned, NULL, NULL);
 #endif
 
+    if ((flags_ & RCE_UDP_GSO) && type == SOCK_DGRAM) {
+#ifdef __linux__
+        /* Setting the default segment size to zero does not enable segmentation
+         * but tells us whether the kernel knows about UDP GSO at all */
+        int seg_size = 0;
+
+        if (::setsockopt(socket_, SOL_UDP, UDP_SEGMENT, &seg_size, sizeof(seg_size)) < 0)
+            LOG_WARN("UDP GSO is not supported: %s", strerror(errno));
+        else
+            gso_ = true;
+#else
+        LOG_WARN("UDP GSO is supported only on Linux");
+#endif
+    }
+
+    if ((flags_ & RCE_MSG_ZEROCOPY) && type == SOCK_DGRAM) {
+#ifdef __linux__
+        int enabled = 1;
+
+        if (::setsockopt(socket_, SOL_SOCKET, SO_ZEROCOPY, &enabled, sizeof(enabled)) < 0)
+            LOG_WARN("MSG_ZEROCOPY is not supported: %s", strerror(errno));
+        else
+            zc_ = new uvgrtp::zerocopy_state();
+#else
+        LOG_WARN("MSG_ZEROCOPY is supported only on Linux");
+#endif
+    }
+
     return RTP_OK;
 }
 
@@ -74,6 +170,13 @@ rtp_error_t uvgrtp::socket::setsockopt(int level, int optname, const void *optva
     return RTP_OK;
 }
 
+void uvgrtp::socket::share(uvgrtp::socket *owner)
+{
+    socket_ = owner->socket_;
+    gso_    = owner->gso_;
+    shared_ = true;
+}
+
 rtp_error_t uvgrtp::socket::bind(short family, unsigned host, short port)
 {
     assert(family == AF_INET);
@@ -134,6 +237,401 @@ socket_t& uvgrtp::socket::get_raw_socket()
 }
 
 
+rtp_error_t uvgrtp::socket::enable_io_uring()
+{
+    rtp_error_t ret;
+
+    if (uring_)
+        return RTP_OK;
+
+    uring_ = new uvgrtp::uring();
+
+    if ((ret = uring_->init(socket_)) != RTP_OK) {
+        delete uring_;
+        uring_ = nullptr;
+    }
+
+    return ret;
+}
+
+uvgrtp::uring *uvgrtp::socket::get_uring()
+{
+    return uring_;
+}
+
+rtp_error_t uvgrtp::socket::enable_xdp(sockaddr_in& remote)
+{
+    rtp_error_t ret;
+
+    if (xdp_)
+        return RTP_OK;
+
+    xdp_ = new uvgrtp::xdp();
+
+    if ((ret = xdp_->init(socket_, remote)) != RTP_OK) {
+        delete xdp_;
+        xdp_ = nullptr;
+    }
+
+    return ret;
+}
+
+uvgrtp::xdp *uvgrtp::socket::get_xdp()
+{
+    return xdp_;
+}
+
+void uvgrtp::socket::set_transport(uvgrtp::transport *transport)
+{
+    delete transport_;
+    transport_ = transport;
+}
+
+uvgrtp::transport *uvgrtp::socket::get_transport()
+{
+    return transport_;
+}
+
+rtp_error_t uvgrtp::socket::enable_pmtu_discovery(sockaddr_in& remote)
+{
+    rtp_error_t ret;
+
+    if (pmtu_)
+        return RTP_OK;
+
+    pmtu_ = new uvgrtp::pmtu();
+
+    if ((ret = pmtu_->init(socket_, remote)) != RTP_OK) {
+        delete pmtu_;
+        pmtu_ = nullptr;
+    }
+
+    return ret;
+}
+
+uvgrtp::pmtu *uvgrtp::socket::get_pmtu()
+{
+    return pmtu_;
+}
+
+rtp_error_t uvgrtp::socket::set_dscp(int dscp)
+{
+    /* DSCP is the upper six bits of the type of service byte */
+    int tos = (dscp << 2) | (tos_ & 0x3);
+
+    if (::setsockopt(socket_, IPPROTO_IP, IP_TOS, (const char *)&tos, sizeof(tos)) < 0) {
+        log_platform_error("Failed to set IP_TOS");
+        return RTP_GENERIC_ERROR;
+    }
+
+    tos_ = tos;
+
+    if (redundant_)
+        (void)redundant_->set_dscp(dscp);
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::socket::set_priority_dscp(int dscp)
+{
+#ifdef __linux__
+    priority_tos_ = (dscp < 0) ? -1 : (dscp << 2) | (tos_ & 0x3);
+
+    if (redundant_)
+        (void)redundant_->set_priority_dscp(dscp);
+
+    return RTP_OK;
+#else
+    (void)dscp;
+
+    LOG_WARN("Marking packets individually is supported only on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+bool uvgrtp::socket::priority_marking()
+{
+    return priority_tos_ != -1 && priority_tos_ != tos_;
+}
+
+rtp_error_t uvgrtp::socket::set_ecn(uint8_t ecn)
+{
+#ifdef __linux__
+    int tos    = (tos_ & ~0x3) | (ecn & 0x3);
+    int enable = 1;
+
+    if (::setsockopt(socket_, IPPROTO_IP, IP_TOS, (const char *)&tos, sizeof(tos)) < 0) {
+        log_platform_error("Failed to set IP_TOS");
+        return RTP_GENERIC_ERROR;
+    }
+
+    if (::setsockopt(socket_, IPPROTO_IP, IP_RECVTOS, (const char *)&enable, sizeof(enable)) < 0) {
+        log_platform_error("Failed to set IP_RECVTOS");
+        return RTP_GENERIC_ERROR;
+    }
+
+    tos_ = tos;
+
+    if (priority_tos_ != -1)
+        priority_tos_ = (priority_tos_ & ~0x3) | (ecn & 0x3);
+
+    if (redundant_)
+        (void)redundant_->set_ecn(ecn);
+
+    return RTP_OK;
+#else
+    (void)ecn;
+
+    LOG_WARN("ECN is supported only on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::set_busy_poll(int budget)
+{
+#ifdef __linux__
+    int prefer = budget > 0;
+
+    /* raising SO_BUSY_POLL above net.core.busy_read requires CAP_NET_ADMIN */
+    if (::setsockopt(socket_, SOL_SOCKET, SO_BUSY_POLL, &budget, sizeof(budget)) < 0) {
+        LOG_WARN("Failed to set SO_BUSY_POLL: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    /* SO_PREFER_BUSY_POLL is supported only since Linux 5.11, busy polling works without it */
+    if (::setsockopt(socket_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer)) < 0) {
+        LOG_DEBUG("Failed to set SO_PREFER_BUSY_POLL: %s", strerror(errno));
+    }
+
+    return RTP_OK;
+#else
+    (void)budget;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::get_send_status(send_status_t *status)
+{
+    if (!status)
+        return RTP_INVALID_VALUE;
+
+    int buf_size      = 0;
+    socklen_t opt_len = sizeof(buf_size);
+
+    if (::getsockopt(socket_, SOL_SOCKET, SO_SNDBUF, (char *)&buf_size, &opt_len) < 0) {
+        log_platform_error("getsockopt(2) failed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    status->buffer_size     = (size_t)buf_size;
+    status->queued_bytes    = 0;
+    status->would_block     = counters_.would_block.load(std::memory_order_relaxed);
+    status->blocked_sends   = counters_.blocked_sends.load(std::memory_order_relaxed);
+    status->dropped_packets = counters_.dropped_packets.load(std::memory_order_relaxed) +
+                              (transport_ ? transport_->get_dropped() : 0);
+    status->path_mtu        = pmtu_ ? pmtu_->get_mtu() : 0;
+
+#ifdef __linux__
+    int queued = 0;
+
+    if (::ioctl(socket_, SIOCOUTQ, &queued) < 0) {
+        log_platform_error("ioctl(2) failed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    status->queued_bytes = (size_t)queued;
+#endif
+
+    return RTP_OK;
+}
+
+uvgrtp::pacer *uvgrtp::socket::enable_pacing()
+{
+    if (!pacer_)
+        pacer_ = new uvgrtp::pacer();
+
+    return pacer_;
+}
+
+bool uvgrtp::socket::zerocopy_enabled()
+{
+    /* io_uring has its own buffer lifetime, and a UDP GSO buffer made of the RTP
+     * headers and payloads of many packets exceeds the fragment limit of a zero-copy skb */
+    return zc_ && zc_->enabled && !uring_ && !gso_;
+}
+
+uint32_t uvgrtp::socket::zerocopy_sent()
+{
+    return zc_ ? zc_->sent.load() : 0;
+}
+
+bool uvgrtp::socket::zerocopy_completed(uint32_t id)
+{
+    return !zc_ || (int32_t)(zc_->done - id) >= 0;
+}
+
+void uvgrtp::socket::reap_zerocopy()
+{
+#ifdef __linux__
+    if (!zc_ || zc_->done == zc_->sent)
+        return;
+
+    std::lock_guard<std::mutex> lock(zc_->mtx);
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in))];
+
+    for (;;) {
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (::recvmsg(socket_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR)
+                continue;
+
+            struct sock_extended_err *serr = (struct sock_extended_err *)CMSG_DATA(cm);
+
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0)
+                continue;
+
+            /* The kernel had to copy the data (e.g., loopback or no scatter-gather support)
+             * so pinning the pages is pure overhead, stop using zero-copy */
+            if ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && zc_->enabled) {
+                LOG_DEBUG("Kernel copied zero-copy send, disabling MSG_ZEROCOPY");
+                zc_->enabled = false;
+            }
+
+            /* notification covers the sends [ee_info, ee_data] */
+            zc_->ranges[serr->ee_info] = serr->ee_data;
+        }
+    }
+
+    /* advance the completion point over all ranges that are now contiguous */
+    uint32_t done = zc_->done;
+
+    for (auto it = zc_->ranges.find(done); it != zc_->ranges.end(); it = zc_->ranges.find(done)) {
+        done = it->second + 1;
+        zc_->ranges.erase(it);
+    }
+
+    zc_->done = done;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::wait_zerocopy(uint32_t id, int timeout)
+{
+#ifdef __linux__
+    for (int waited = 0; ; ++waited) {
+        reap_zerocopy();
+
+        if (zerocopy_completed(id))
+            return RTP_OK;
+
+        if (waited >= timeout)
+            return RTP_TIMEOUT;
+
+        /* POLLERR is always reported, and the packet dispatcher may reap
+         * the completions before this thread wakes up so wait in short slices */
+        struct pollfd pfd = { socket_, 0, 0 };
+        (void)poll(&pfd, 1, 1);
+    }
+#else
+    (void)id, (void)timeout;
+    return RTP_OK;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::add_destination(sockaddr_in& addr)
+{
+#ifdef __linux__
+    auto dest = std::make_shared<uvgrtp::fanout_destination>();
+
+    dest->addr = addr;
+    dest->seq  = (uint16_t)uvgrtp::random::generate_32();
+
+    auto old = std::atomic_load(&dests_);
+
+    /* the senders keep using the list they loaded, it is never modified after publishing */
+    for (;;) {
+        auto list = std::make_shared<destination_list>();
+
+        if (old) {
+            for (auto& d : *old) {
+                if (d->addr.sin_addr.s_addr == addr.sin_addr.s_addr && d->addr.sin_port == addr.sin_port)
+                    return RTP_INVALID_VALUE;
+            }
+            *list = *old;
+        }
+        list->push_back(dest);
+
+        if (std::atomic_compare_exchange_weak(&dests_, &old, std::shared_ptr<const destination_list>(list)))
+            return RTP_OK;
+    }
+#else
+    (void)addr;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::remove_destination(sockaddr_in& addr)
+{
+    auto old = std::atomic_load(&dests_);
+
+    for (;;) {
+        if (!old)
+            return RTP_INVALID_VALUE;
+
+        auto list = std::make_shared<destination_list>();
+
+        for (auto& d : *old) {
+            if (d->addr.sin_addr.s_addr != addr.sin_addr.s_addr || d->addr.sin_port != addr.sin_port)
+                list->push_back(d);
+        }
+
+        if (list->size() == old->size())
+            return RTP_INVALID_VALUE;
+
+        if (std::atomic_compare_exchange_weak(&dests_, &old, std::shared_ptr<const destination_list>(list)))
+            return RTP_OK;
+    }
+}
+
+void uvgrtp::socket::set_redundant_path(uvgrtp::socket *path)
+{
+    if (path && tos_) {
+        if (::setsockopt(path->socket_, IPPROTO_IP, IP_TOS, (const char *)&tos_, sizeof(tos_)) < 0)
+            log_platform_error("Failed to set IP_TOS of the redundant path");
+
+        path->tos_ = tos_;
+    }
+
+    /* with ECN, the codepoints of the packets that arrive first through the path are counted too */
+    if (path && (tos_ & 0x3))
+        (void)path->set_ecn((uint8_t)(tos_ & 0x3));
+
+    if (path)
+        path->priority_tos_ = priority_tos_;
+
+    redundant_ = path;
+}
+
+rtp_error_t uvgrtp::socket::send_redundant(rtp_error_t ret, uvgrtp::buf_vec& buffers, int flags)
+{
+    uvgrtp::socket *path = redundant_;
+
+    if (!path)
+        return ret;
+
+    rtp_error_t path_ret = path->__sendtov(path->addr_, buffers, flags, nullptr);
+
+    /* the receiver gets the packets if either path delivers them */
+    return (ret == RTP_OK) ? RTP_OK : path_ret;
+}
+
 rtp_error_t uvgrtp::socket::install_handler(void *arg, packet_handler_vec handler)
 {
     if (!handler)
@@ -153,8 +651,19 @@ rtp_error_t uvgrtp::socket::__sendto(sockaddr_in& addr, uint8_t *buf, size_t buf
 {
     int nsend = 0;
 
+    if (transport_) {
+        uvgrtp::buf_vec buffer = { { buf_len, buf } };
+
+        if (transport_->send(addr, buffer, bytes_sent) == RTP_OK)
+            return RTP_OK;
+    }
+
 #ifdef __linux__
+
     if ((nsend = ::sendto(socket_, buf, buf_len, flags, (const struct sockaddr *)&addr, sizeof(addr_))) == -1) {
+        if (pmtu_ && errno == EMSGSIZE)
+            pmtu_->set_exceeded();
+
         LOG_ERROR("Failed to send data: %s", strerror(errno));
 
         if (bytes_sent)
@@ -210,6 +719,9 @@ rtp_error_t uvgrtp::socket::__sendtov(
     int flags, int *bytes_sent
 )
 {
+    if (transport_ && transport_->send(addr, buffers, bytes_sent) == RTP_OK)
+        return RTP_OK;
+
 #ifdef __linux__
     int sent_bytes = 0;
 
@@ -228,6 +740,9 @@ rtp_error_t uvgrtp::socket::__sendtov(
     header_.msg_hdr.msg_controllen = 0;
 
     if (sendmmsg(socket_, &header_, 1, flags) < 0) {
+        if (pmtu_ && errno == EMSGSIZE)
+            pmtu_->set_exceeded();
+
         LOG_ERROR("Failed to send RTP frame: %s!", strerror(errno));
         set_bytes(bytes_sent, -1);
         return RTP_SEND_ERROR;
@@ -276,7 +791,7 @@ rtp_error_t uvgrtp::socket::sendto(buf_vec& buffers, int flags)
         }
     }
 
-    return __sendtov(addr_, buffers, flags, nullptr);
+    return send_redundant(__sendtov(addr_, buffers, flags, nullptr), buffers, flags);
 }
 
 rtp_error_t uvgrtp::socket::sendto(buf_vec& buffers, int flags, int *bytes_sent)
@@ -290,7 +805,7 @@ rtp_error_t uvgrtp::socket::sendto(buf_vec& buffers, int flags, int *bytes_sent)
         }
     }
 
-    return __sendtov(addr_, buffers, flags, bytes_sent);
+    return send_redundant(__sendtov(addr_, buffers, flags, bytes_sent), buffers, flags);
 }
 
 rtp_error_t uvgrtp::socket::sendto(sockaddr_in& addr, buf_vec& buffers, int flags)
@@ -326,57 +841,132 @@ rtp_error_t uvgrtp::socket::sendto(
     return __sendtov(addr, buffers, flags, bytes_sent);
 }
 
+#ifdef __linux__
+bool uvgrtp::socket::wait_send_space(int error, std::chrono::steady_clock::time_point start)
+{
+    if (error != EAGAIN && error != EWOULDBLOCK && error != ENOBUFS && error != EINTR)
+        return false;
+
+    int elapsed = (int)TIME_DIFF(start, std::chrono::steady_clock::now(), milliseconds);
+
+    if (elapsed >= SEND_RETRY_TIMEOUT)
+        return false;
+
+    if (error == EINTR)
+        return true;
+
+    counters_.would_block.store(true, std::memory_order_relaxed);
+    counters_.blocked_sends.fetch_add(1, std::memory_order_relaxed);
+
+    /* ENOBUFS means that the queue of the device is full, which the
+     * socket cannot be polled for, so just give the device time to drain */
+    if (error == ENOBUFS) {
+        std::this_thread::sleep_for(std::chrono::microseconds(SEND_RETRY_INTERVAL));
+    } else {
+        struct pollfd pfd = { socket_, POLLOUT, 0 };
+        (void)poll(&pfd, 1, SEND_RETRY_TIMEOUT - elapsed);
+    }
+
+    return true;
+}
+
+int uvgrtp::socket::zc_sendmmsg(struct mmsghdr *headers, unsigned count, int flags)
+{
+    int ret = sendmmsg(socket_, headers, count, flags);
+
+    if (!(flags & MSG_ZEROCOPY))
+        return ret;
+
+    /* the kernel runs out of option memory for pinned pages if the
+     * completions are not reaped fast enough, send the rest by copying */
+    if (ret < 0 && errno == ENOBUFS) {
+        LOG_DEBUG("Zero-copy send failed with ENOBUFS, copying instead");
+        return sendmmsg(socket_, headers, count, flags & ~MSG_ZEROCOPY);
+    }
+
+    /* every sent message gets its own completion identifier */
+    if (ret > 0)
+        zc_->sent += (uint32_t)ret;
+
+    return ret;
+}
+#endif
+
 rtp_error_t uvgrtp::socket::__sendtov(
     sockaddr_in& addr,
     uvgrtp::pkt_vec& buffers,
-    int flags, int *bytes_sent
+    int flags, int *bytes_sent,
+    const uint8_t *classes
 )
 {
 #ifdef __linux__
+    /* zero-copy may have been disabled after the caller checked zerocopy_enabled() */
+    if ((flags & MSG_ZEROCOPY) && !zerocopy_enabled())
+        flags &= ~MSG_ZEROCOPY;
+
+    auto dests = std::atomic_load(&dests_);
+
+    if (dests && !dests->empty()) {
+        counters_.would_block.store(false, std::memory_order_relaxed);
+
+        /* the headers of the destinations are rewritten by the next send, they must not be sent from memory */
+        return __sendtov_fanout(addr, buffers, flags & ~MSG_ZEROCOPY, bytes_sent, classes, *dests);
+    }
+#endif
+
+    if (transport_ && transport_->send(addr, buffers, bytes_sent) == RTP_OK)
+        return RTP_OK;
+
+#ifdef __linux__
+    if (uring_)
+        return uring_->send(addr, buffers, flags, bytes_sent);
+
+    counters_.would_block.store(false, std::memory_order_relaxed);
+
+    if (gso_)
+        return __sendtov_gso(addr, buffers, flags, bytes_sent, classes);
+
     int sent_bytes = 0;
-    struct mmsghdr *hptr, *headers;
+    size_t nchunks = 0;
 
-    hptr = headers = new struct mmsghdr[buffers.size()];
+    for (auto& buffer : buffers)
+        nchunks += buffer.size();
 
-    for (size_t i = 0; i < buffers.size(); ++i) {
-        headers[i].msg_hdr.msg_iov        = new struct iovec[buffers[i].size()];
+    /* the descriptors are built into arrays owned by the socket, which
+     * stop allocating once they have grown to the size of the largest frame */
+    send_headers_.resize(buffers.size());
+    send_chunks_.resize(nchunks);
+
+    if (classes)
+        tos_cmsgs_.resize(buffers.size());
+
+    struct mmsghdr *headers = send_headers_.data();
+    struct iovec *chunks    = send_chunks_.data();
+
+    for (size_t i = 0, cptr = 0; i < buffers.size(); ++i) {
+        headers[i].msg_hdr.msg_iov        = &chunks[cptr];
         headers[i].msg_hdr.msg_iovlen     = buffers[i].size();
         headers[i].msg_hdr.msg_name       = (void *)&addr;
         headers[i].msg_hdr.msg_namelen    = sizeof(addr);
         headers[i].msg_hdr.msg_control    = 0;
         headers[i].msg_hdr.msg_controllen = 0;
+        headers[i].msg_hdr.msg_flags      = 0;
 
-        for (size_t k = 0; k < buffers[i].size(); ++k) {
-            headers[i].msg_hdr.msg_iov[k].iov_len   = buffers[i][k].first;
-            headers[i].msg_hdr.msg_iov[k].iov_base  = buffers[i][k].second;
-            sent_bytes                             += buffers[i][k].first;
+        for (auto& buffer : buffers[i]) {
+            chunks[cptr].iov_len   = buffer.first;
+            chunks[cptr].iov_base  = buffer.second;
+            sent_bytes            += buffer.first;
+            ++cptr;
         }
-    }
-
-    ssize_t npkts = (flags_ & RCE_NO_SYSTEM_CALL_CLUSTERING) ? 1 : 1024;
-    ssize_t bptr  = buffers.size();
-
-    while (bptr > npkts) {
-        if (sendmmsg(socket_, hptr, npkts, flags) < 0) {
-            log_platform_error("sendmmsg(2) failed");
-            return RTP_SEND_ERROR;
-        }
-
-        bptr -= npkts;
-        hptr += npkts;
-    }
 
-    if (sendmmsg(socket_, hptr, bptr, flags) < 0) {
-        log_platform_error("sendmmsg(2) failed");
-        return RTP_SEND_ERROR;
+        if (classes && classes[i] == PKT_CLASS_PRIORITY)
+            add_priority_cmsg(&headers[i].msg_hdr, tos_cmsgs_[i].buf);
     }
 
-    for (size_t i = 0; i < buffers.size(); ++i)
-        delete[] headers[i].msg_hdr.msg_iov;
-    delete[] headers;
+    rtp_error_t ret = __sendmmsg(headers, buffers.size(), flags);
 
-    set_bytes(bytes_sent, sent_bytes);
-    return RTP_OK;
+    set_bytes(bytes_sent, (ret == RTP_OK) ? sent_bytes : -1);
+    return ret;
 
 #else
     INT ret;
@@ -422,6 +1012,365 @@ send_:
 #endif
 }
 
+#ifdef __linux__
+rtp_error_t uvgrtp::socket::__sendmmsg(struct mmsghdr *headers, size_t nmsgs, int flags, size_t *msgs_sent)
+{
+    size_t npkts = (flags_ & RCE_NO_SYSTEM_CALL_CLUSTERING) ? 1 : 1024;
+    size_t mptr  = 0;
+    auto start   = std::chrono::steady_clock::now();
+
+    /* sendmmsg(2) may send fewer messages than requested, resume from the first unsent one */
+    while (mptr < nmsgs) {
+        int nsent = zc_sendmmsg(&headers[mptr], (unsigned)std::min(npkts, nmsgs - mptr), flags);
+
+        if (nsent < 0) {
+            if (wait_send_space(errno, start))
+                continue;
+
+            /* the datagrams larger than the path MTU are lost, the next frames are packetized smaller */
+            if (pmtu_ && errno == EMSGSIZE)
+                pmtu_->set_exceeded();
+
+            log_platform_error("sendmmsg(2) failed");
+            counters_.dropped_packets.fetch_add(nmsgs - mptr, std::memory_order_relaxed);
+
+            if (msgs_sent)
+                *msgs_sent = mptr;
+            return RTP_SEND_ERROR;
+        }
+
+        mptr += nsent;
+    }
+
+    if (msgs_sent)
+        *msgs_sent = mptr;
+    return RTP_OK;
+}
+
+void uvgrtp::socket::add_priority_cmsg(struct msghdr *hdr, char *buf)
+{
+    if (!hdr->msg_control) {
+        hdr->msg_control    = buf;
+        hdr->msg_controllen = 0;
+    }
+
+    struct cmsghdr *cm = (struct cmsghdr *)((char *)hdr->msg_control + hdr->msg_controllen);
+    cm->cmsg_level     = IPPROTO_IP;
+    cm->cmsg_type      = IP_TOS;
+    cm->cmsg_len       = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &priority_tos_, sizeof(int));
+
+    hdr->msg_controllen += CMSG_SPACE(sizeof(int));
+}
+
+rtp_error_t uvgrtp::socket::__sendtov_fanout(
+    sockaddr_in& addr,
+    uvgrtp::pkt_vec& buffers,
+    int flags, int *bytes_sent,
+    const uint8_t *classes,
+    const destination_list& dests
+)
+{
+    size_t ndests  = dests.size() + 1;
+    size_t nchunks = 0;
+    int sent_bytes = 0;
+
+    for (auto& buffer : buffers) {
+        if (buffer.empty() || buffer[0].first != RTP_HDR_SIZE) {
+            LOG_ERROR("Packet does not start with an RTP header, cannot send it to multiple destinations");
+            set_bytes(bytes_sent, -1);
+            return RTP_INVALID_VALUE;
+        }
+        nchunks += buffer.size();
+    }
+
+    send_headers_.resize(buffers.size() * ndests);
+    send_chunks_.resize(nchunks * ndests);
+    fanout_headers_.resize(buffers.size() * dests.size() * RTP_HDR_SIZE);
+
+    if (classes)
+        tos_cmsgs_.resize(buffers.size() * ndests);
+
+    struct mmsghdr *headers = send_headers_.data();
+    struct iovec *chunks    = send_chunks_.data();
+    uint8_t *rtp_headers    = fanout_headers_.data();
+
+    /* Each packet is sent to every destination before the next packet so that
+     * the destinations at the end of the list do not have to wait for the whole frame */
+    for (size_t i = 0, mptr = 0, cptr = 0; i < buffers.size(); ++i) {
+        for (size_t d = 0; d < ndests; ++d, ++mptr) {
+            headers[mptr].msg_hdr.msg_iov        = &chunks[cptr];
+            headers[mptr].msg_hdr.msg_iovlen     = buffers[i].size();
+            headers[mptr].msg_hdr.msg_name       = d ? (void *)&dests[d - 1]->addr : (void *)&addr;
+            headers[mptr].msg_hdr.msg_namelen    = sizeof(addr);
+            headers[mptr].msg_hdr.msg_control    = 0;
+            headers[mptr].msg_hdr.msg_controllen = 0;
+            headers[mptr].msg_hdr.msg_flags      = 0;
+
+            for (auto& buffer : buffers[i]) {
+                chunks[cptr].iov_len   = buffer.first;
+                chunks[cptr].iov_base  = buffer.second;
+                sent_bytes            += (int)buffer.first;
+                ++cptr;
+            }
+
+            if (classes && classes[i] == PKT_CLASS_PRIORITY)
+                add_priority_cmsg(&headers[mptr].msg_hdr, tos_cmsgs_[mptr].buf);
+
+            if (!d)
+                continue;
+
+            /* The first chunk of the packet is the RTP header, replace it with the header of the
+             * destination. Its sequence number is advanced only after the packet has been sent */
+            uint8_t *hdr  = rtp_headers;
+            rtp_headers  += RTP_HDR_SIZE;
+
+            memcpy(hdr, buffers[i][0].second, RTP_HDR_SIZE);
+            *(uint16_t *)&hdr[2] = htons((uint16_t)(dests[d - 1]->seq + i));
+
+            headers[mptr].msg_hdr.msg_iov[0].iov_base = hdr;
+        }
+    }
+
+    size_t nsent    = 0;
+    rtp_error_t ret = __sendmmsg(headers, send_headers_.size(), flags, &nsent);
+
+    /* the messages are ordered packet by packet so destination "d" got the packets whose
+     * message (i * ndests + d) was sent, the receivers don't see the unsent ones as lost */
+    for (size_t d = 1; d < ndests; ++d) {
+        if (nsent > d)
+            dests[d - 1]->seq += (uint16_t)((nsent - d + ndests - 1) / ndests);
+    }
+
+    set_bytes(bytes_sent, (ret == RTP_OK) ? sent_bytes : -1);
+    return ret;
+}
+
+rtp_error_t uvgrtp::socket::__sendtov_gso(
+    sockaddr_in& addr,
+    uvgrtp::pkt_vec& buffers,
+    int flags, int *bytes_sent,
+    const uint8_t *classes
+)
+{
+    int sent_bytes = 0;
+    size_t nchunks = 0;
+
+    for (auto& buffer : buffers)
+        nchunks += buffer.size();
+
+    send_headers_.resize(buffers.size());
+    send_chunks_.resize(nchunks);
+    gso_cmsgs_.resize(buffers.size());
+    gso_first_pkt_.resize(buffers.size());
+
+    struct mmsghdr *headers = send_headers_.data();
+    struct iovec *chunks    = send_chunks_.data();
+    gso_cmsg *cmsgs         = gso_cmsgs_.data();
+
+    /* index of the first RTP packet of each merged buffer, used for fall back */
+    size_t *first_pkt = gso_first_pkt_.data();
+
+    size_t nmsgs = 0;
+    size_t cptr  = 0;
+
+    for (size_t i = 0; i < buffers.size(); ++nmsgs) {
+        struct msghdr *hdr = &headers[nmsgs].msg_hdr;
+        size_t seg_size    = 0;
+        size_t msg_size    = 0;
+        size_t nsegs       = 0;
+
+        for (auto& chunk : buffers[i])
+            seg_size += chunk.first;
+
+        memset(hdr, 0, sizeof(*hdr));
+        hdr->msg_name    = (void *)&addr;
+        hdr->msg_namelen = sizeof(addr);
+        hdr->msg_iov     = &chunks[cptr];
+        first_pkt[nmsgs] = i;
+
+        /* Merge packets until the segment or size limit is reached.
+         * All segments must have the same size, except the last one which may be shorter */
+        while (i < buffers.size() && nsegs < MAX_GSO_SEGMENTS) {
+            size_t pkt_size = 0;
+
+            for (auto& chunk : buffers[i])
+                pkt_size += chunk.first;
+
+            if (nsegs && (pkt_size > seg_size || msg_size + pkt_size > MAX_GSO_SIZE ||
+                          hdr->msg_iovlen + buffers[i].size() > MAX_BUFFER_COUNT))
+                break;
+
+            /* all segments of a buffer are marked the same */
+            if (nsegs && classes && classes[i] != classes[first_pkt[nmsgs]])
+                break;
+
+            for (auto& chunk : buffers[i]) {
+                chunks[cptr].iov_len  = chunk.first;
+                chunks[cptr].iov_base = chunk.second;
+                ++cptr;
+            }
+
+            hdr->msg_iovlen += buffers[i].size();
+            msg_size        += pkt_size;
+            ++nsegs;
+            ++i;
+
+            if (pkt_size < seg_size)
+                break;
+        }
+
+        if (nsegs > 1) {
+            hdr->msg_control    = cmsgs[nmsgs].buf;
+            hdr->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+            struct cmsghdr *cm = CMSG_FIRSTHDR(hdr);
+            cm->cmsg_level     = SOL_UDP;
+            cm->cmsg_type      = UDP_SEGMENT;
+            cm->cmsg_len       = CMSG_LEN(sizeof(uint16_t));
+            *((uint16_t *)CMSG_DATA(cm)) = (uint16_t)seg_size;
+        }
+
+        if (classes && classes[first_pkt[nmsgs]] == PKT_CLASS_PRIORITY)
+            add_priority_cmsg(hdr, cmsgs[nmsgs].buf);
+
+        sent_bytes += (int)msg_size;
+    }
+
+    size_t mptr  = 0;
+    size_t npkts = (flags_ & RCE_NO_SYSTEM_CALL_CLUSTERING) ? 1 : 1024;
+    auto start   = std::chrono::steady_clock::now();
+
+    while (mptr < nmsgs) {
+        int ret = zc_sendmmsg(&headers[mptr], (unsigned)std::min(npkts, nmsgs - mptr), flags);
+
+        if (ret < 0) {
+            /* EIO is returned if the device cannot checksum the segments and EINVAL
+             * if the segment size is not suitable for the outgoing route */
+            if (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP) {
+                /* with the Don't Fragment bit set, EINVAL is also returned if the segments are larger than the path MTU */
+                bool mtu_error = pmtu_ && errno == EINVAL;
+
+                LOG_WARN("UDP GSO failed (%s), falling back to regular send", strerror(errno));
+                gso_ = false;
+
+                uvgrtp::pkt_vec unsent(buffers.begin() + first_pkt[mptr], buffers.end());
+
+                if (__sendtov(addr, unsent, flags, nullptr, classes ? classes + first_pkt[mptr] : nullptr) != RTP_OK) {
+                    /* the packets did not fit into the path MTU without GSO either, GSO was not the problem */
+                    gso_ = mtu_error;
+                    set_bytes(bytes_sent, -1);
+                    return RTP_SEND_ERROR;
+                }
+                break;
+            }
+
+            if (wait_send_space(errno, start))
+                continue;
+
+            log_platform_error("sendmmsg(2) failed");
+            counters_.dropped_packets.fetch_add(buffers.size() - first_pkt[mptr], std::memory_order_relaxed);
+            set_bytes(bytes_sent, -1);
+            return RTP_SEND_ERROR;
+        }
+
+        mptr += ret;
+    }
+
+    set_bytes(bytes_sent, sent_bytes);
+    return RTP_OK;
+}
+#endif
+
+rtp_error_t uvgrtp::socket::__sendtov_paced(
+    sockaddr_in& addr,
+    uvgrtp::pkt_vec& buffers,
+    int flags, int *bytes_sent,
+    const uint8_t *classes,
+    uvgrtp::socket *path
+)
+{
+    int path_flags = flags;
+
+#ifdef __linux__
+    /* the completions of the zero-copy sends are tracked only for this socket */
+    path_flags &= ~MSG_ZEROCOPY;
+#endif
+
+    if (!pacer_ || !pacer_->enabled()) {
+        rtp_error_t ret = __sendtov(addr, buffers, flags, bytes_sent, classes);
+
+        if (!path)
+            return ret;
+
+        /* the receiver gets the packets if either path delivers them */
+        rtp_error_t path_ret = path->__sendtov(path->addr_, buffers, path_flags, nullptr, classes);
+        return (ret == RTP_OK) ? RTP_OK : path_ret;
+    }
+
+    size_t frame_size = 0;
+    int sent_bytes    = 0;
+    int path_bytes    = 0;
+
+    /* a path that has failed is not used for the rest of the frame */
+    bool sending      = true;
+    bool path_sending = path != nullptr;
+
+    paced_sizes_.assign(buffers.size(), 0);
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        for (auto& buffer : buffers[i])
+            paced_sizes_[i] += buffer.first;
+        frame_size += paced_sizes_[i];
+    }
+
+    pacer_->begin_frame(frame_size);
+
+    /* send as many packets as fit into one burst at a time, but at least one packet */
+    for (size_t first = 0; first < buffers.size(); ) {
+        size_t last  = first;
+        size_t burst = 0;
+
+        while (last < buffers.size() && (last == first || burst + paced_sizes_[last] <= pacer_->get_burst()))
+            burst += paced_sizes_[last++];
+
+        pacer_->wait(burst);
+
+        /* copy the burst into a vector owned by the socket, reusing the memory of the previous bursts */
+        paced_.resize(last - first);
+
+        for (size_t i = first; i < last; ++i)
+            paced_[i - first].assign(buffers[i].begin(), buffers[i].end());
+
+        int nsent = 0;
+
+        if (sending && __sendtov(addr, paced_, flags, &nsent, classes ? classes + first : nullptr) != RTP_OK)
+            sending = false;
+
+        sent_bytes += nsent;
+
+        /* the burst goes out on the redundant path right away so that the paths stay in step */
+        if (path_sending) {
+            nsent = 0;
+
+            if (path->__sendtov(path->addr_, paced_, path_flags, &nsent, classes ? classes + first : nullptr) != RTP_OK)
+                path_sending = false;
+
+            path_bytes += nsent;
+        }
+
+        if (!sending && !path_sending) {
+            set_bytes(bytes_sent, -1);
+            return RTP_SEND_ERROR;
+        }
+
+        first = last;
+    }
+
+    set_bytes(bytes_sent, sending ? sent_bytes : path_bytes);
+    return RTP_OK;
+}
+
 rtp_error_t uvgrtp::socket::sendto(pkt_vec& buffers, int flags)
 {
     rtp_error_t ret;
@@ -435,7 +1384,25 @@ rtp_error_t uvgrtp::socket::sendto(pkt_vec& buffers, int flags)
         }
     }
 
-    return __sendtov(addr_, buffers, flags, nullptr);
+    return __sendtov_paced(addr_, buffers, flags, nullptr, nullptr, redundant_);
+}
+
+rtp_error_t uvgrtp::socket::sendto(pkt_vec& buffers, std::vector<uint8_t>& classes, int flags)
+{
+    rtp_error_t ret;
+
+    for (auto& buffer : buffers) {
+        for (auto& handler : vec_handlers_) {
+            if ((ret = (*handler.handler)(handler.arg, buffer)) != RTP_OK) {
+                LOG_ERROR("Malformed packet");
+                return ret;
+            }
+        }
+    }
+
+    const uint8_t *pkt_classes = (priority_marking() && classes.size() == buffers.size()) ? classes.data() : nullptr;
+
+    return __sendtov_paced(addr_, buffers, flags, nullptr, pkt_classes, redundant_);
 }
 
 rtp_error_t uvgrtp::socket::sendto(pkt_vec& buffers, int flags, int *bytes_sent)
@@ -451,7 +1418,7 @@ rtp_error_t uvgrtp::socket::sendto(pkt_vec& buffers, int flags, int *bytes_sent)
         }
     }
 
-    return __sendtov(addr_, buffers, flags, bytes_sent);
+    return __sendtov_paced(addr_, buffers, flags, bytes_sent, nullptr, redundant_);
 }
 
 rtp_error_t uvgrtp::socket::sendto(sockaddr_in& addr, pkt_vec& buffers, int flags)
@@ -467,7 +1434,7 @@ rtp_error_t uvgrtp::socket::sendto(sockaddr_in& addr, pkt_vec& buffers, int flag
         }
     }
 
-    return __sendtov(addr, buffers, flags, nullptr);
+    return __sendtov_paced(addr, buffers, flags, nullptr, nullptr, nullptr);
 }
 
 rtp_error_t uvgrtp::socket::sendto(sockaddr_in& addr, pkt_vec& buffers, int flags, int *bytes_sent)
@@ -483,7 +1450,7 @@ rtp_error_t uvgrtp::socket::sendto(sockaddr_in& addr, pkt_vec& buffers, int flag
         }
     }
 
-    return __sendtov(addr, buffers, flags, bytes_sent);
+    return __sendtov_paced(addr, buffers, flags, bytes_sent, nullptr, nullptr);
 }
 
 rtp_error_t uvgrtp::socket::__recv(uint8_t *buf, size_t buf_len, int flags, int *bytes_read)
@@ -612,6 +1579,32 @@ rtp_error_t uvgrtp::socket::recvfrom(uint8_t *buf, size_t buf_len, int flags)
     return __recvfrom(buf, buf_len, flags, nullptr, nullptr);
 }
 
+#ifdef __linux__
+rtp_error_t uvgrtp::socket::recvmmsg(struct mmsghdr *msgs, unsigned vlen, int flags, int *npkts)
+{
+    if (!msgs || !vlen) {
+        set_bytes(npkts, -1);
+        return RTP_INVALID_VALUE;
+    }
+
+    int ret = ::recvmmsg(socket_, msgs, vlen, flags, nullptr);
+
+    if (ret == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            set_bytes(npkts, 0);
+            return RTP_INTERRUPTED;
+        }
+        LOG_ERROR("recvmmsg(2) failed: %s", strerror(errno));
+
+        set_bytes(npkts, -1);
+        return RTP_GENERIC_ERROR;
+    }
+
+    set_bytes(npkts, ret);
+    return RTP_OK;
+}
+#endif
+
 sockaddr_in& uvgrtp::socket::get_out_address()
 {
     return addr_;
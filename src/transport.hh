@@ -0,0 +1,59 @@
+#pragma once
+
+#include "socket.hh"
+#include "util.hh"
+
+namespace uvgrtp {
+
+    /* Datagram received through a transport
+     *
+     * "data" points to memory owned by the transport and is valid until transport::release() is called */
+    struct transport_datagram {
+        uint8_t *data = nullptr;
+        size_t len    = 0;
+    };
+
+    /* I/O engine that uvgrtp::socket uses instead of its UDP socket, see socket::set_transport()
+     *
+     * The UDP socket is the default transport and it is always created so that the ports
+     * stay reserved and RTCP, ZRTP and the datagrams the transport cannot carry still work.
+     * A transport may carry only part of the traffic: if send() returns RTP_NOT_SUPPORTED,
+     * the datagrams are sent through the UDP socket, and the packet dispatcher reads both
+     * the UDP socket and the transport.
+     *
+     * send() is called by the thread pushing frames and the receive functions by the
+     * packet dispatcher, a transport must not need locking between the two */
+    class transport {
+        public:
+            virtual ~transport() {}
+
+            /* Send "buffer", or each packet of "buffers", as one datagram to "addr"
+             *
+             * Return RTP_OK on success and write the number of bytes sent to "bytes_sent"
+             * Return RTP_NOT_SUPPORTED if the datagrams must be sent through the UDP socket instead */
+            virtual rtp_error_t send(sockaddr_in& addr, uvgrtp::buf_vec& buffer, int *bytes_sent) = 0;
+            virtual rtp_error_t send(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int *bytes_sent) = 0;
+
+            /* Return the number of datagrams the transport has dropped, e.g., because the receiver was full */
+            virtual uint64_t get_dropped() = 0;
+
+            /* Get the file descriptor that becomes readable when datagrams can be received
+             *
+             * Return -1 if the transport does not receive or cannot be waited on,
+             * the packet dispatcher then checks it whenever it wakes up */
+            virtual int get_fd() = 0;
+
+            /* Fetch at most "count" received datagrams without blocking
+             *
+             * The packet dispatcher calls this until it returns RTP_INTERRUPTED
+             *
+             * Return RTP_OK on success and write the number of datagrams to "ndgrams"
+             * Return RTP_INTERRUPTED if there are no datagrams */
+            virtual rtp_error_t recv(uvgrtp::transport_datagram *dgrams, size_t count, size_t *ndgrams) = 0;
+
+            /* Release the "count" datagrams returned by the previous recv() */
+            virtual void release(size_t count) = 0;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
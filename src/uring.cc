@@ -0,0 +1,507 @@
+#include "uring.hh"
+
+#include "debug.hh"
+
+#ifdef HAVE_IO_URING
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef HAVE_IO_URING
+/* liburing is not required, the rings are operated directly with these system calls */
+static int io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+enum URING_TAGS {
+    URING_RECV_TAG   = 1,
+    URING_WAKE_TAG   = 2,
+    URING_CANCEL_TAG = 3,
+};
+
+/* buffer group ID of the receive buffers */
+const uint16_t URING_BUFFER_GROUP = 0;
+#endif
+
+uvgrtp::uring::uring():
+#ifdef HAVE_IO_URING
+    buf_ring_(nullptr),
+    buf_tail_(nullptr),
+    recv_buffers_(nullptr),
+    recv_buffer_len_(0),
+    rearm_(false),
+    wake_fd_(-1),
+    woken_(false),
+#endif
+    socket_(-1)
+{
+#ifdef HAVE_IO_URING
+    memset(&recv_msg_, 0, sizeof(recv_msg_));
+#endif
+}
+
+uvgrtp::uring::~uring()
+{
+#ifdef HAVE_IO_URING
+    destroy_ring(send_);
+    destroy_ring(recv_);
+
+    if (buf_ring_)
+        munmap(buf_ring_, URING_RECV_BUFFERS * sizeof(struct io_uring_buf));
+
+    if (wake_fd_ != -1)
+        close(wake_fd_);
+
+    delete[] recv_buffers_;
+#endif
+}
+
+#ifdef HAVE_IO_URING
+rtp_error_t uvgrtp::uring::setup_ring(ring& r, unsigned entries, unsigned cq_entries)
+{
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+
+    if (cq_entries) {
+        params.flags     |= IORING_SETUP_CQSIZE;
+        params.cq_entries = cq_entries;
+    }
+
+    if ((r.fd = io_uring_setup(entries, &params)) < 0) {
+        LOG_WARN("io_uring_setup(2) failed: %s", strerror(errno));
+        return (errno == ENOSYS || errno == EPERM) ? RTP_NOT_SUPPORTED : RTP_GENERIC_ERROR;
+    }
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        LOG_WARN("io_uring of this kernel is too old");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    r.ring_len = std::max(
+        params.sq_off.array + params.sq_entries * sizeof(unsigned),
+        params.cq_off.cqes  + params.cq_entries * sizeof(struct io_uring_cqe)
+    );
+    r.sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    r.ring_ptr = mmap(nullptr, r.ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, IORING_OFF_SQ_RING);
+
+    if (r.ring_ptr == MAP_FAILED) {
+        r.ring_ptr = nullptr;
+        log_platform_error("mmap(2) failed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    r.sqes = (struct io_uring_sqe *)mmap(nullptr, r.sqes_len, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, r.fd, IORING_OFF_SQES);
+
+    if (r.sqes == MAP_FAILED) {
+        r.sqes = nullptr;
+        log_platform_error("mmap(2) failed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    uint8_t *ptr = (uint8_t *)r.ring_ptr;
+
+    r.sq_head  = (unsigned *)(ptr + params.sq_off.head);
+    r.sq_tail  = (unsigned *)(ptr + params.sq_off.tail);
+    r.sq_array = (unsigned *)(ptr + params.sq_off.array);
+    r.sq_mask  = *(unsigned *)(ptr + params.sq_off.ring_mask);
+    r.sq_size  = params.sq_entries;
+    r.sq_local = *r.sq_tail;
+
+    r.cq_head  = (unsigned *)(ptr + params.cq_off.head);
+    r.cq_tail  = (unsigned *)(ptr + params.cq_off.tail);
+    r.cq_mask  = *(unsigned *)(ptr + params.cq_off.ring_mask);
+    r.cqes     = (struct io_uring_cqe *)(ptr + params.cq_off.cqes);
+
+    /* the socket is referred to with index 0 in all submissions */
+    if (io_uring_register(r.fd, IORING_REGISTER_FILES, &socket_, 1) < 0) {
+        LOG_WARN("Failed to register the socket to io_uring: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    return RTP_OK;
+}
+
+void uvgrtp::uring::destroy_ring(ring& r)
+{
+    /* The kernel tears down the ring asynchronously after it has been closed so cancel
+     * the outstanding requests and drop the ring's reference to the socket here.
+     * Otherwise the port would remain bound for a while after the socket is closed */
+    if (r.fd != -1 && r.sqes) {
+        struct io_uring_sqe *sqe = get_sqe(r);
+
+        if (sqe) {
+            sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+            sqe->fd           = -1;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+            sqe->user_data    = URING_CANCEL_TAG;
+
+            (void)submit(r, 1);
+        }
+
+        (void)io_uring_register(r.fd, IORING_UNREGISTER_FILES, nullptr, 0);
+    }
+
+    if (r.sqes)
+        munmap(r.sqes, r.sqes_len);
+
+    if (r.ring_ptr)
+        munmap(r.ring_ptr, r.ring_len);
+
+    if (r.fd != -1)
+        close(r.fd);
+
+    r = ring();
+}
+
+struct io_uring_sqe *uvgrtp::uring::get_sqe(ring& r)
+{
+    unsigned head = __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE);
+
+    if (r.sq_local - head >= r.sq_size)
+        return nullptr;
+
+    unsigned index = r.sq_local & r.sq_mask;
+    struct io_uring_sqe *sqe = &r.sqes[index];
+
+    r.sq_array[index] = index;
+    ++r.sq_local;
+
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int uvgrtp::uring::submit(ring& r, unsigned wait_nr)
+{
+    unsigned to_submit = r.sq_local - *r.sq_tail;
+    unsigned flags     = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+
+    __atomic_store_n(r.sq_tail, r.sq_local, __ATOMIC_RELEASE);
+
+    while ((ret = io_uring_enter(r.fd, to_submit, wait_nr, flags)) < 0 && errno == EINTR)
+        ;
+
+    if (ret < 0)
+        LOG_ERROR("io_uring_enter(2) failed: %s", strerror(errno));
+
+    return ret;
+}
+
+rtp_error_t uvgrtp::uring::arm_recv()
+{
+    struct io_uring_sqe *sqe = get_sqe(recv_);
+
+    if (!sqe)
+        return RTP_GENERIC_ERROR;
+
+    sqe->opcode    = IORING_OP_RECVMSG;
+    sqe->fd        = 0;
+    sqe->flags     = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->addr      = (uintptr_t)&recv_msg_;
+    sqe->len       = 1;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = URING_RECV_TAG;
+
+    return RTP_OK;
+}
+#endif
+
+rtp_error_t uvgrtp::uring::init(socket_t socket)
+{
+    socket_ = socket;
+
+#ifdef HAVE_IO_URING
+    return setup_ring(send_, URING_SEND_ENTRIES, 0);
+#else
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::uring::start_recv(size_t control_size)
+{
+#ifdef HAVE_IO_URING
+    rtp_error_t ret;
+
+    /* each receive buffer must be able to hold the receive header, sender address,
+     * ancillary data and the largest possible datagram */
+    recv_buffer_len_  = sizeof(struct io_uring_recvmsg_out) + sizeof(sockaddr_in) + control_size + MAX_PACKET;
+    recv_buffer_len_  = (recv_buffer_len_ + 63) & ~(size_t)63;
+
+    recv_msg_.msg_namelen    = sizeof(sockaddr_in);
+    recv_msg_.msg_controllen = control_size;
+
+    if ((ret = setup_ring(recv_, 8, 4 * URING_RECV_BUFFERS)) != RTP_OK)
+        return ret;
+
+    buf_ring_ = (struct io_uring_buf *)mmap(nullptr, URING_RECV_BUFFERS * sizeof(struct io_uring_buf),
+                                            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (buf_ring_ == MAP_FAILED) {
+        buf_ring_ = nullptr;
+        log_platform_error("mmap(2) failed");
+        return RTP_MEMORY_ERROR;
+    }
+
+    struct io_uring_buf_reg reg;
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr    = (uintptr_t)buf_ring_;
+    reg.ring_entries = URING_RECV_BUFFERS;
+    reg.bgid         = URING_BUFFER_GROUP;
+
+    if (io_uring_register(recv_.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        LOG_WARN("Failed to register receive buffers to io_uring: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    recv_buffers_ = new uint8_t[URING_RECV_BUFFERS * recv_buffer_len_];
+    buf_tail_     = &buf_ring_[0].resv;
+
+    for (unsigned i = 0; i < URING_RECV_BUFFERS; ++i) {
+        buf_ring_[i].addr = (uintptr_t)(recv_buffers_ + i * recv_buffer_len_);
+        buf_ring_[i].len  = (uint32_t)recv_buffer_len_;
+        buf_ring_[i].bid  = (uint16_t)i;
+    }
+    __atomic_store_n(buf_tail_, (uint16_t)URING_RECV_BUFFERS, __ATOMIC_RELEASE);
+
+    if ((wake_fd_ = eventfd(0, EFD_CLOEXEC)) < 0) {
+        log_platform_error("eventfd(2) failed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    struct io_uring_sqe *sqe = get_sqe(recv_);
+
+    sqe->opcode        = IORING_OP_POLL_ADD;
+    sqe->fd            = wake_fd_;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data     = URING_WAKE_TAG;
+
+    if ((ret = arm_recv()) != RTP_OK)
+        return ret;
+
+    if (submit(recv_, 0) < 0)
+        return RTP_GENERIC_ERROR;
+
+    return RTP_OK;
+#else
+    (void)control_size;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::uring::send(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int flags, int *bytes_sent)
+{
+#ifdef HAVE_IO_URING
+    rtp_error_t ret = RTP_OK;
+    int sent_bytes  = 0;
+    size_t nchunks  = 0;
+
+    for (auto& buffer : buffers)
+        nchunks += buffer.size();
+
+    send_headers_.resize(buffers.size());
+    send_chunks_.resize(nchunks);
+
+    struct msghdr *headers = send_headers_.data();
+    struct iovec *chunks   = send_chunks_.data();
+
+    for (size_t i = 0, cptr = 0; i < buffers.size(); ++i) {
+        memset(&headers[i], 0, sizeof(headers[i]));
+        headers[i].msg_name    = (void *)&addr;
+        headers[i].msg_namelen = sizeof(addr);
+        headers[i].msg_iov     = &chunks[cptr];
+        headers[i].msg_iovlen  = buffers[i].size();
+
+        for (auto& buffer : buffers[i]) {
+            chunks[cptr].iov_len  = buffer.first;
+            chunks[cptr].iov_base = buffer.second;
+            ++cptr;
+        }
+    }
+
+    for (size_t pptr = 0; pptr < buffers.size() && ret == RTP_OK; ) {
+        size_t npkts      = std::min((size_t)URING_SEND_ENTRIES, buffers.size() - pptr);
+        size_t ncompleted = 0;
+
+        /* Link the packets so they are sent in order and so that the rest of
+         * the packets are cancelled if sending one of them fails */
+        for (size_t i = 0; i < npkts; ++i) {
+            struct io_uring_sqe *sqe = get_sqe(send_);
+
+            sqe->opcode    = IORING_OP_SENDMSG;
+            sqe->fd        = 0;
+            sqe->flags     = IOSQE_FIXED_FILE | ((i + 1 < npkts) ? IOSQE_IO_LINK : 0);
+            sqe->addr      = (uintptr_t)&headers[pptr + i];
+            sqe->len       = 1;
+            sqe->msg_flags = (uint32_t)flags;
+            sqe->user_data = pptr + i;
+        }
+
+        /* the buffers of the transaction are released after the call
+         * so all packets must be processed by the kernel before returning */
+        while (ncompleted < npkts) {
+            unsigned head = *send_.cq_head;
+            unsigned tail = __atomic_load_n(send_.cq_tail, __ATOMIC_ACQUIRE);
+
+            if (head == tail) {
+                if (submit(send_, (unsigned)(npkts - ncompleted)) < 0) {
+                    set_bytes(bytes_sent, -1);
+                    return RTP_SEND_ERROR;
+                }
+                continue;
+            }
+
+            for (; head != tail; ++head, ++ncompleted) {
+                struct io_uring_cqe *cqe = &send_.cqes[head & send_.cq_mask];
+
+                if (cqe->res >= 0) {
+                    sent_bytes += cqe->res;
+                } else if (cqe->res != -ECANCELED) {
+                    LOG_ERROR("Failed to send RTP packet: %s!", strerror(-cqe->res));
+                    ret = RTP_SEND_ERROR;
+                }
+            }
+            __atomic_store_n(send_.cq_head, head, __ATOMIC_RELEASE);
+        }
+
+        pptr += npkts;
+    }
+
+    set_bytes(bytes_sent, (ret == RTP_OK) ? sent_bytes : -1);
+    return ret;
+#else
+    (void)addr, (void)buffers, (void)flags;
+    set_bytes(bytes_sent, -1);
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::uring::recv(uvgrtp::uring_datagram *dgrams, size_t count, size_t *ndgrams)
+{
+#ifdef HAVE_IO_URING
+    size_t n = 0;
+
+    for (;;) {
+        unsigned head = *recv_.cq_head;
+        unsigned tail = __atomic_load_n(recv_.cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail && n < count; ++head) {
+            struct io_uring_cqe *cqe = &recv_.cqes[head & recv_.cq_mask];
+
+            if (cqe->user_data == URING_WAKE_TAG) {
+                woken_ = true;
+                continue;
+            }
+
+            /* The multishot receive is terminated if an error occurs or if the kernel
+             * runs out of receive buffers. In the latter case the datagrams are left
+             * in the socket and they're received when the receive is armed again */
+            if (!(cqe->flags & IORING_CQE_F_MORE))
+                rearm_ = true;
+
+            if (cqe->res < 0) {
+                if (cqe->res == -EINVAL) {
+                    LOG_WARN("Multishot receive is not supported by io_uring");
+                    __atomic_store_n(recv_.cq_head, head + 1, __ATOMIC_RELEASE);
+                    *ndgrams = n;
+                    return RTP_NOT_SUPPORTED;
+                }
+
+                if (cqe->res != -ENOBUFS)
+                    LOG_ERROR("io_uring receive failed: %s", strerror(-cqe->res));
+                continue;
+            }
+
+            if (!(cqe->flags & IORING_CQE_F_BUFFER))
+                continue;
+
+            uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            uint8_t *buf = recv_buffers_ + bid * recv_buffer_len_;
+            auto *out    = (struct io_uring_recvmsg_out *)buf;
+            uint8_t *ctl = buf + sizeof(*out) + recv_msg_.msg_namelen;
+
+            dgrams[n].data       = ctl + recv_msg_.msg_controllen;
+            dgrams[n].len        = out->payloadlen;
+            dgrams[n].control    = ctl;
+            dgrams[n].controllen = out->controllen;
+            dgrams[n].buffer_id  = bid;
+            ++n;
+        }
+        __atomic_store_n(recv_.cq_head, head, __ATOMIC_RELEASE);
+
+        if (n) {
+            *ndgrams = n;
+            return RTP_OK;
+        }
+
+        if (woken_) {
+            *ndgrams = 0;
+            return RTP_INTERRUPTED;
+        }
+
+        /* all buffers have been returned to the kernel by now so the receive can be rearmed */
+        if (rearm_) {
+            if (arm_recv() != RTP_OK)
+                return RTP_GENERIC_ERROR;
+            rearm_ = false;
+        }
+
+        if (submit(recv_, 1) < 0)
+            return RTP_GENERIC_ERROR;
+    }
+#else
+    (void)dgrams, (void)count;
+    *ndgrams = 0;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+void uvgrtp::uring::release(uvgrtp::uring_datagram *dgrams, size_t count)
+{
+#ifdef HAVE_IO_URING
+    uint16_t tail = *buf_tail_;
+
+    for (size_t i = 0; i < count; ++i, ++tail) {
+        struct io_uring_buf *buf = &buf_ring_[tail & (URING_RECV_BUFFERS - 1)];
+
+        buf->addr = (uintptr_t)(recv_buffers_ + dgrams[i].buffer_id * recv_buffer_len_);
+        buf->len  = (uint32_t)recv_buffer_len_;
+        buf->bid  = dgrams[i].buffer_id;
+    }
+    __atomic_store_n(buf_tail_, tail, __ATOMIC_RELEASE);
+#else
+    (void)dgrams, (void)count;
+#endif
+}
+
+void uvgrtp::uring::wake()
+{
+#ifdef HAVE_IO_URING
+    uint64_t value = 1;
+
+    if (wake_fd_ != -1 && write(wake_fd_, &value, sizeof(value)) < 0)
+        log_platform_error("write(2) failed");
+#endif
+}
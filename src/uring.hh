@@ -0,0 +1,154 @@
+#pragma once
+
+#include "socket.hh"
+#include "util.hh"
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+namespace uvgrtp {
+
+    /* Number of submission queue entries in the send ring.
+     * Larger transactions are submitted in chunks of this size */
+    const unsigned URING_SEND_ENTRIES = 256;
+
+    /* Number of receive buffers the kernel can fill before they are returned to it.
+     * Must be a power of two */
+    const unsigned URING_RECV_BUFFERS = 64;
+
+    /* Datagram received through the io_uring receive ring
+     *
+     * "data" points to a kernel-selected receive buffer and the buffer
+     * must be given back to the ring with uring::release() after the datagram
+     * has been processed */
+    struct uring_datagram {
+        uint8_t *data       = nullptr;
+        size_t len          = 0;
+        void *control       = nullptr;
+        size_t controllen   = 0;
+        uint16_t buffer_id  = 0;
+    };
+
+    /* io_uring backend for uvgrtp::socket
+     *
+     * The backend uses two rings: the send ring is used by the thread calling push_frame()
+     * and the receive ring by the packet dispatcher thread so neither of them needs locking.
+     *
+     * The socket is registered to both rings as a fixed file. All packets of a transaction
+     * are submitted as linked SENDMSG requests with one system call and a multishot RECVMSG
+     * request is kept armed on the socket. Received datagrams are written to a ring of
+     * registered receive buffers (provided buffer ring) selected by the kernel. */
+    class uring {
+        public:
+            uring();
+            ~uring();
+
+            /* Create the send ring and register "socket" to it
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the kernel does not support io_uring
+             * Return RTP_GENERIC_ERROR if creating the ring failed */
+            rtp_error_t init(socket_t socket);
+
+            /* Create the receive ring, register the receive buffers and arm the multishot receive
+             *
+             * "control_size" tells how much space is reserved for the ancillary data of each datagram
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the kernel does not support multishot receive
+             * Return RTP_GENERIC_ERROR if creating the ring failed */
+            rtp_error_t start_recv(size_t control_size);
+
+            /* Send all packets of "buffers" to "addr" using linked SENDMSG requests
+             * and wait until the kernel has processed all of them
+             *
+             * Return RTP_OK on success and write the amount of bytes sent to "bytes_sent"
+             * Return RTP_SEND_ERROR on error and set "bytes_sent" to -1 */
+            rtp_error_t send(sockaddr_in& addr, uvgrtp::pkt_vec& buffers, int flags, int *bytes_sent);
+
+            /* Fetch at most "count" received datagrams from the receive ring
+             *
+             * If no datagrams are available, recv() blocks until one is received or wake() is called
+             *
+             * Return RTP_OK on success and write the number of datagrams to "ndgrams"
+             * Return RTP_INTERRUPTED if wake() was called
+             * Return RTP_GENERIC_ERROR if waiting for the datagrams failed */
+            rtp_error_t recv(uvgrtp::uring_datagram *dgrams, size_t count, size_t *ndgrams);
+
+            /* Give the receive buffers of "dgrams" back to the kernel */
+            void release(uvgrtp::uring_datagram *dgrams, size_t count);
+
+            /* Make a thread blocked in recv() return
+             *
+             * This can be called from any thread */
+            void wake();
+
+        private:
+#ifdef HAVE_IO_URING
+            struct ring {
+                int fd = -1;
+
+                unsigned *sq_head  = nullptr;
+                unsigned *sq_tail  = nullptr;
+                unsigned *sq_array = nullptr;
+                unsigned sq_mask   = 0;
+                unsigned sq_size   = 0;
+                unsigned sq_local  = 0;
+
+                unsigned *cq_head  = nullptr;
+                unsigned *cq_tail  = nullptr;
+                unsigned cq_mask   = 0;
+
+                struct io_uring_sqe *sqes = nullptr;
+                struct io_uring_cqe *cqes = nullptr;
+
+                void *ring_ptr     = nullptr;
+                size_t ring_len    = 0;
+                size_t sqes_len    = 0;
+            };
+
+            rtp_error_t setup_ring(ring& r, unsigned entries, unsigned cq_entries);
+            void destroy_ring(ring& r);
+
+            /* Return pointer to the next free submission queue entry or nullptr if the queue is full */
+            struct io_uring_sqe *get_sqe(ring& r);
+
+            /* Submit the queued entries and wait until at least "wait_nr" completions are available */
+            int submit(ring& r, unsigned wait_nr);
+
+            /* Queue the multishot RECVMSG request to the receive ring */
+            rtp_error_t arm_recv();
+
+            ring send_;
+            ring recv_;
+
+            /* Provided buffer ring of the receive ring and the buffers themselves
+             *
+             * The ring is accessed as an array of buffer descriptors because the flexible array
+             * of struct io_uring_buf_ring is not laid out correctly in C++. The tail of the ring
+             * overlaps the reserved field of the first descriptor */
+            struct io_uring_buf *buf_ring_;
+            uint16_t *buf_tail_;
+            uint8_t *recv_buffers_;
+            size_t recv_buffer_len_;
+
+            /* message template for the multishot RECVMSG */
+            struct msghdr recv_msg_;
+
+            /* SENDMSG descriptors, reused by all sends */
+            std::vector<struct msghdr> send_headers_;
+            std::vector<struct iovec> send_chunks_;
+
+            /* has the multishot receive been terminated and needs to be rearmed */
+            bool rearm_;
+
+            /* eventfd written by wake() */
+            int wake_fd_;
+            bool woken_;
+#endif
+            socket_t socket_;
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
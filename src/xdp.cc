@@ -0,0 +1,462 @@
+#include "xdp.hh"
+
+#include "debug.hh"
+
+#ifdef HAVE_AF_XDP
+#include <ifaddrs.h>
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+
+#ifdef HAVE_AF_XDP
+static int sys_bpf(int cmd, union bpf_attr *attr)
+{
+    return (int)syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+static struct bpf_insn bpf_insn_make(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm)
+{
+    struct bpf_insn insn;
+
+    memset(&insn, 0, sizeof(insn));
+    insn.code    = code;
+    insn.dst_reg = dst;
+    insn.src_reg = src;
+    insn.off     = off;
+    insn.imm     = imm;
+
+    return insn;
+}
+#endif
+
+uvgrtp::xdp::xdp()
+#ifdef HAVE_AF_XDP
+    :
+    umem_(nullptr),
+    umem_len_(0),
+    fd_(-1),
+    map_fd_(-1),
+    prog_fd_(-1),
+    link_fd_(-1),
+    ifindex_(0),
+    port_(0)
+#endif
+{
+}
+
+uvgrtp::xdp::~xdp()
+{
+#ifdef HAVE_AF_XDP
+    destroy();
+#endif
+}
+
+rtp_error_t uvgrtp::xdp::init(socket_t socket, sockaddr_in& remote)
+{
+#ifdef HAVE_AF_XDP
+    rtp_error_t ret;
+
+    if (!(ifindex_ = find_interface(socket, remote))) {
+        LOG_ERROR("Cannot find the network interface for AF_XDP");
+        return RTP_GENERIC_ERROR;
+    }
+
+    if ((ret = create_socket())  != RTP_OK ||
+        (ret = bind_socket())    != RTP_OK ||
+        (ret = load_program())   != RTP_OK ||
+        (ret = attach_program()) != RTP_OK) {
+        destroy();
+        return ret;
+    }
+
+    return RTP_OK;
+#else
+    (void)socket, (void)remote;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+int uvgrtp::xdp::get_fd()
+{
+#ifdef HAVE_AF_XDP
+    return fd_;
+#else
+    return -1;
+#endif
+}
+
+rtp_error_t uvgrtp::xdp::recv(uvgrtp::xdp_datagram *dgrams, size_t count, size_t *ndgrams)
+{
+#ifdef HAVE_AF_XDP
+    uint32_t cons  = *rx_.consumer;
+    uint32_t avail = __atomic_load_n(rx_.producer, __ATOMIC_ACQUIRE) - cons;
+
+    if (!avail)
+        return RTP_INTERRUPTED;
+
+    *ndgrams = std::min((size_t)avail, count);
+
+    for (size_t i = 0; i < *ndgrams; ++i) {
+        struct xdp_desc *desc = &((struct xdp_desc *)rx_.desc)[(cons + i) & (XDP_FRAMES - 1)];
+        parse_frame(umem_ + desc->addr, desc->len, dgrams[i]);
+    }
+
+    return RTP_OK;
+#else
+    (void)dgrams, (void)count, (void)ndgrams;
+    return RTP_INTERRUPTED;
+#endif
+}
+
+void uvgrtp::xdp::release(size_t count)
+{
+#ifdef HAVE_AF_XDP
+    uint32_t cons = *rx_.consumer;
+    uint32_t prod = *fill_.producer;
+
+    /* Every UMEM frame is either in the fill ring, owned by the kernel or in the RX ring
+     * so the fill ring always has room for the frames that are given back */
+    for (size_t i = 0; i < count; ++i) {
+        struct xdp_desc *desc = &((struct xdp_desc *)rx_.desc)[(cons + i) & (XDP_FRAMES - 1)];
+        ((uint64_t *)fill_.desc)[(prod + i) & (XDP_FRAMES - 1)] = desc->addr & ~(uint64_t)(XDP_FRAME_SIZE - 1);
+    }
+
+    __atomic_store_n(fill_.producer, prod + (uint32_t)count, __ATOMIC_RELEASE);
+    __atomic_store_n(rx_.consumer,   cons + (uint32_t)count, __ATOMIC_RELEASE);
+
+    /* with zero-copy, the driver may be waiting for the frames to be refilled */
+    if (__atomic_load_n(fill_.flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP)
+        (void)::recvfrom(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+#else
+    (void)count;
+#endif
+}
+
+#ifdef HAVE_AF_XDP
+unsigned uvgrtp::xdp::find_interface(socket_t socket, sockaddr_in& remote)
+{
+    sockaddr_in local;
+    socklen_t len = sizeof(local);
+    struct ifaddrs *ifaddrs = nullptr;
+    unsigned ifindex = 0;
+
+    if (::getsockname(socket, (struct sockaddr *)&local, &len) < 0) {
+        log_platform_error("getsockname(2) failed");
+        return 0;
+    }
+    port_ = local.sin_port;
+
+    /* Connecting a UDP socket does not send anything but it selects the route,
+     * and thus the local address, that would be used to reach the remote */
+    if (local.sin_addr.s_addr == htonl(INADDR_ANY)) {
+        int probe = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+        if (probe < 0 || ::connect(probe, (struct sockaddr *)&remote, sizeof(remote)) < 0 ||
+            ::getsockname(probe, (struct sockaddr *)&local, &len) < 0) {
+            log_platform_error("Failed to find the route to remote");
+
+            if (probe >= 0)
+                close(probe);
+            return 0;
+        }
+        close(probe);
+    }
+
+    if (getifaddrs(&ifaddrs) < 0) {
+        log_platform_error("getifaddrs(3) failed");
+        return 0;
+    }
+
+    for (struct ifaddrs *ifa = ifaddrs; ifa && !ifindex; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != AF_INET)
+            continue;
+
+        if (((sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr == local.sin_addr.s_addr)
+            ifindex = if_nametoindex(ifa->ifa_name);
+    }
+    freeifaddrs(ifaddrs);
+
+    return ifindex;
+}
+
+rtp_error_t uvgrtp::xdp::map_ring(ring& r, uint64_t producer, uint64_t consumer,
+                                  uint64_t flags, uint64_t desc, size_t desc_size, off_t offset)
+{
+    r.map_len = desc + XDP_FRAMES * desc_size;
+    r.map     = mmap(nullptr, r.map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+
+    if (r.map == MAP_FAILED) {
+        log_platform_error("Failed to map AF_XDP ring");
+        r.map = nullptr;
+        return RTP_GENERIC_ERROR;
+    }
+
+    r.producer = (uint32_t *)((uint8_t *)r.map + producer);
+    r.consumer = (uint32_t *)((uint8_t *)r.map + consumer);
+    r.flags    = (uint32_t *)((uint8_t *)r.map + flags);
+    r.desc     = (uint8_t *)r.map + desc;
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::xdp::create_socket()
+{
+    struct xdp_umem_reg reg;
+    struct xdp_mmap_offsets off;
+    socklen_t len = sizeof(off);
+    int size = XDP_FRAMES;
+    rtp_error_t ret;
+
+    umem_len_ = (size_t)XDP_FRAMES * XDP_FRAME_SIZE;
+    umem_     = (uint8_t *)mmap(nullptr, umem_len_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (umem_ == MAP_FAILED) {
+        log_platform_error("Failed to allocate UMEM");
+        umem_ = nullptr;
+        return RTP_MEMORY_ERROR;
+    }
+
+    if ((fd_ = ::socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0)) < 0) {
+        log_platform_error("Failed to create AF_XDP socket");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.addr       = (uintptr_t)umem_;
+    reg.len        = umem_len_;
+    reg.chunk_size = XDP_FRAME_SIZE;
+    reg.headroom   = 0;
+
+    if (::setsockopt(fd_, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0 ||
+        ::setsockopt(fd_, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size)) < 0 ||
+        ::setsockopt(fd_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size, sizeof(size)) < 0 ||
+        ::setsockopt(fd_, SOL_XDP, XDP_RX_RING, &size, sizeof(size)) < 0) {
+        log_platform_error("Failed to configure AF_XDP socket");
+        return RTP_GENERIC_ERROR;
+    }
+
+    if (::getsockopt(fd_, SOL_XDP, XDP_MMAP_OFFSETS, &off, &len) < 0) {
+        log_platform_error("Failed to get AF_XDP ring offsets");
+        return RTP_GENERIC_ERROR;
+    }
+
+    /* the completion ring is not used because nothing is sent through the socket
+     * but it must exist for the socket to be bound */
+    if ((ret = map_ring(fill_, off.fr.producer, off.fr.consumer, off.fr.flags, off.fr.desc,
+                        sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING)) != RTP_OK ||
+        (ret = map_ring(comp_, off.cr.producer, off.cr.consumer, off.cr.flags, off.cr.desc,
+                        sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING)) != RTP_OK ||
+        (ret = map_ring(rx_, off.rx.producer, off.rx.consumer, off.rx.flags, off.rx.desc,
+                        sizeof(struct xdp_desc), XDP_PGOFF_RX_RING)) != RTP_OK)
+        return ret;
+
+    /* give all frames to the kernel */
+    for (unsigned i = 0; i < XDP_FRAMES; ++i)
+        ((uint64_t *)fill_.desc)[i] = (uint64_t)i * XDP_FRAME_SIZE;
+
+    __atomic_store_n(fill_.producer, XDP_FRAMES, __ATOMIC_RELEASE);
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::xdp::bind_socket()
+{
+    struct sockaddr_xdp sxdp;
+
+    memset(&sxdp, 0, sizeof(sxdp));
+    sxdp.sxdp_family   = AF_XDP;
+    sxdp.sxdp_ifindex  = ifindex_;
+    sxdp.sxdp_queue_id = 0;
+    sxdp.sxdp_flags    = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+
+    if (::bind(fd_, (struct sockaddr *)&sxdp, sizeof(sxdp)) == 0)
+        return RTP_OK;
+
+    /* the driver does not support zero-copy, fall back to copy mode */
+    sxdp.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+
+    if (::bind(fd_, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+        log_platform_error("Failed to bind AF_XDP socket");
+        return RTP_GENERIC_ERROR;
+    }
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::xdp::load_program()
+{
+    union bpf_attr attr;
+    uint32_t key = 0;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type    = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size    = sizeof(uint32_t);
+    attr.value_size  = sizeof(int);
+    attr.max_entries = XDP_MAX_QUEUES;
+
+    if ((map_fd_ = sys_bpf(BPF_MAP_CREATE, &attr)) < 0) {
+        log_platform_error("Failed to create XSKMAP");
+        return RTP_GENERIC_ERROR;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd_;
+    attr.key    = (uintptr_t)&key;
+    attr.value  = (uintptr_t)&fd_;
+    attr.flags  = BPF_ANY;
+
+    if (sys_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+        log_platform_error("Failed to add AF_XDP socket to XSKMAP");
+        return RTP_GENERIC_ERROR;
+    }
+
+    /* r1 = struct xdp_md *, r2 = data, r3 = data_end
+     *
+     * If the frame is an unfragmented IPv4 UDP datagram destined to our port,
+     * redirect it to the AF_XDP socket of the RX queue, otherwise pass it to the stack.
+     * Jump offsets are relative to the next instruction and all of them jump to "pass" */
+    const struct bpf_insn program[] = {
+        bpf_insn_make(BPF_ALU64 | BPF_MOV | BPF_X, 6, 1, 0, 0),                     /*  0: r6 = r1 */
+        bpf_insn_make(BPF_LDX | BPF_W | BPF_MEM, 2, 1, 0, 0),                       /*  1: r2 = ctx->data */
+        bpf_insn_make(BPF_LDX | BPF_W | BPF_MEM, 3, 1, 4, 0),                       /*  2: r3 = ctx->data_end */
+        bpf_insn_make(BPF_ALU64 | BPF_MOV | BPF_X, 4, 2, 0, 0),                     /*  3: r4 = r2 */
+        bpf_insn_make(BPF_ALU64 | BPF_ADD | BPF_K, 4, 0, 0, ETH_HLEN + 20),         /*  4: r4 += eth + ip */
+        bpf_insn_make(BPF_JMP | BPF_JGT | BPF_X, 4, 3, 22, 0),                      /*  5: if r4 > r3 goto pass */
+        bpf_insn_make(BPF_LDX | BPF_H | BPF_MEM, 5, 2, 12, 0),                      /*  6: r5 = eth->h_proto */
+        bpf_insn_make(BPF_JMP | BPF_JNE | BPF_K, 5, 0, 20, htons(ETH_P_IP)),        /*  7: if r5 != IPv4 goto pass */
+        bpf_insn_make(BPF_LDX | BPF_B | BPF_MEM, 5, 2, ETH_HLEN + 9, 0),            /*  8: r5 = ip->protocol */
+        bpf_insn_make(BPF_JMP | BPF_JNE | BPF_K, 5, 0, 18, IPPROTO_UDP),            /*  9: if r5 != UDP goto pass */
+        bpf_insn_make(BPF_LDX | BPF_H | BPF_MEM, 5, 2, ETH_HLEN + 6, 0),            /* 10: r5 = ip->frag_off */
+        bpf_insn_make(BPF_ALU64 | BPF_AND | BPF_K, 5, 0, 0, htons(0x3fff)),         /* 11: r5 &= MF | offset */
+        bpf_insn_make(BPF_JMP | BPF_JNE | BPF_K, 5, 0, 15, 0),                      /* 12: if fragment goto pass */
+        bpf_insn_make(BPF_LDX | BPF_B | BPF_MEM, 5, 2, ETH_HLEN, 0),                /* 13: r5 = ip->ihl */
+        bpf_insn_make(BPF_ALU64 | BPF_AND | BPF_K, 5, 0, 0, 0x0f),                  /* 14: */
+        bpf_insn_make(BPF_ALU64 | BPF_LSH | BPF_K, 5, 0, 0, 2),                     /* 15: r5 = ip header length */
+        bpf_insn_make(BPF_ALU64 | BPF_ADD | BPF_X, 2, 5, 0, 0),                     /* 16: r2 += r5 */
+        bpf_insn_make(BPF_ALU64 | BPF_MOV | BPF_X, 4, 2, 0, 0),                     /* 17: r4 = r2 */
+        bpf_insn_make(BPF_ALU64 | BPF_ADD | BPF_K, 4, 0, 0, ETH_HLEN + 8),          /* 18: r4 += eth + udp */
+        bpf_insn_make(BPF_JMP | BPF_JGT | BPF_X, 4, 3, 8, 0),                       /* 19: if r4 > r3 goto pass */
+        bpf_insn_make(BPF_LDX | BPF_H | BPF_MEM, 5, 2, ETH_HLEN + 2, 0),            /* 20: r5 = udp->dest */
+        bpf_insn_make(BPF_JMP | BPF_JNE | BPF_K, 5, 0, 6, port_),                   /* 21: if r5 != port goto pass */
+        bpf_insn_make(BPF_LDX | BPF_W | BPF_MEM, 2, 6, 16, 0),                      /* 22: r2 = ctx->rx_queue_index */
+        bpf_insn_make(BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, map_fd_), /* 23: r1 = XSKMAP */
+        bpf_insn_make(0, 0, 0, 0, 0),                                               /* 24: */
+        bpf_insn_make(BPF_ALU64 | BPF_MOV | BPF_K, 3, 0, 0, XDP_PASS),              /* 25: r3 = XDP_PASS */
+        bpf_insn_make(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),          /* 26: redirect */
+        bpf_insn_make(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),                              /* 27: */
+        bpf_insn_make(BPF_ALU64 | BPF_MOV | BPF_K, 0, 0, 0, XDP_PASS),              /* 28: pass: r0 = XDP_PASS */
+        bpf_insn_make(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),                              /* 29: */
+    };
+
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns     = (uintptr_t)program;
+    attr.insn_cnt  = sizeof(program) / sizeof(program[0]);
+    attr.license   = (uintptr_t)"Dual BSD/GPL";
+
+    if ((prog_fd_ = sys_bpf(BPF_PROG_LOAD, &attr)) < 0) {
+        log_platform_error("Failed to load XDP program");
+        return RTP_GENERIC_ERROR;
+    }
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::xdp::attach_program()
+{
+    union bpf_attr attr;
+
+    /* Prefer driver mode but if the driver has no XDP support, use generic mode */
+    for (uint32_t mode : { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE }) {
+        memset(&attr, 0, sizeof(attr));
+        attr.link_create.prog_fd        = prog_fd_;
+        attr.link_create.target_ifindex = ifindex_;
+        attr.link_create.attach_type    = BPF_XDP;
+        attr.link_create.flags          = mode;
+
+        if ((link_fd_ = sys_bpf(BPF_LINK_CREATE, &attr)) >= 0) {
+            LOG_DEBUG("XDP program attached in %s mode", mode == XDP_FLAGS_DRV_MODE ? "driver" : "generic");
+            return RTP_OK;
+        }
+
+        /* another program has already been attached to the interface */
+        if (errno == EBUSY || errno == EEXIST)
+            break;
+    }
+
+    log_platform_error("Failed to attach XDP program");
+    return RTP_GENERIC_ERROR;
+}
+
+void uvgrtp::xdp::parse_frame(uint8_t *frame, size_t len, uvgrtp::xdp_datagram& dgram)
+{
+    size_t ip_len, udp_len;
+
+    dgram.data = nullptr;
+    dgram.len  = 0;
+
+    /* the XDP program has already checked the protocols and the port */
+    if (len < ETH_HLEN + 20 + 8)
+        return;
+
+    ip_len = (frame[ETH_HLEN] & 0x0f) * 4;
+
+    if (ip_len < 20 || len < ETH_HLEN + ip_len + 8)
+        return;
+
+    uint8_t *udp = frame + ETH_HLEN + ip_len;
+    udp_len      = ((size_t)udp[4] << 8) | udp[5];
+
+    if (udp_len < 8 || ETH_HLEN + ip_len + udp_len > len)
+        return;
+
+    dgram.data = udp + 8;
+    dgram.len  = udp_len - 8;
+}
+
+void uvgrtp::xdp::destroy()
+{
+    /* detach the program before the socket it redirects to is closed */
+    if (link_fd_ != -1)
+        close(link_fd_);
+
+    if (prog_fd_ != -1)
+        close(prog_fd_);
+
+    if (map_fd_ != -1)
+        close(map_fd_);
+
+    for (ring *r : { &fill_, &comp_, &rx_ }) {
+        if (r->map)
+            munmap(r->map, r->map_len);
+        *r = ring();
+    }
+
+    if (fd_ != -1)
+        close(fd_);
+
+    if (umem_)
+        munmap(umem_, umem_len_);
+
+    link_fd_ = prog_fd_ = map_fd_ = fd_ = -1;
+    umem_    = nullptr;
+}
+#endif
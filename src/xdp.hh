@@ -0,0 +1,110 @@
+#pragma once
+
+#include "socket.hh"
+#include "util.hh"
+
+namespace uvgrtp {
+
+    /* Size of one UMEM frame. A frame holds one received Ethernet frame so
+     * datagrams larger than this (minus XDP headroom) are dropped by the kernel */
+    const unsigned XDP_FRAME_SIZE = 2048;
+
+    /* Number of UMEM frames and the size of the fill and RX rings. Must be a power of two */
+    const unsigned XDP_FRAMES = 2048;
+
+    /* Number of entries in the XSKMAP, i.e., the highest RX queue index + 1 the program can redirect */
+    const unsigned XDP_MAX_QUEUES = 64;
+
+    /* UDP payload of a datagram received through the AF_XDP socket
+     *
+     * "data" points to UMEM and is valid until xdp::release() is called.
+     * "len" is 0 if the frame was not a valid UDP datagram */
+    struct xdp_datagram {
+        uint8_t *data = nullptr;
+        size_t len    = 0;
+    };
+
+    /* AF_XDP receive backend for uvgrtp::socket
+     *
+     * A small XDP program is attached to the interface of the socket. The program
+     * steers the IPv4 UDP datagrams destined to the port of the socket into an AF_XDP
+     * socket bound to RX queue 0 of the interface. Everything else, including the datagrams
+     * of the port received on other RX queues, is passed to the network stack as usual
+     * so the regular socket must still be read.
+     *
+     * Driver mode and zero-copy are used if the driver supports them, otherwise the
+     * program runs in generic (SKB) mode and frames are copied to UMEM.
+     *
+     * Only one program can be attached to an interface so only one media stream per
+     * interface can use AF_XDP. Sending is done through the regular socket */
+    class xdp {
+        public:
+            xdp();
+            ~xdp();
+
+            /* Attach the XDP program to the interface "socket" is bound to or, if "socket" is
+             * bound to INADDR_ANY, to the interface that is used to reach "remote"
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if AF_XDP is not supported
+             * Return RTP_GENERIC_ERROR if creating the socket or attaching the program failed */
+            rtp_error_t init(socket_t socket, sockaddr_in& remote);
+
+            /* Get the file descriptor of the AF_XDP socket, it becomes readable when datagrams are received */
+            int get_fd();
+
+            /* Fetch at most "count" received datagrams without blocking
+             *
+             * Return RTP_OK on success and write the number of datagrams to "ndgrams"
+             * Return RTP_INTERRUPTED if there are no datagrams */
+            rtp_error_t recv(uvgrtp::xdp_datagram *dgrams, size_t count, size_t *ndgrams);
+
+            /* Give the UMEM frames of the "count" datagrams returned by the previous recv() back to the kernel */
+            void release(size_t count);
+
+        private:
+#ifdef HAVE_AF_XDP
+            struct ring {
+                uint32_t *producer = nullptr;
+                uint32_t *consumer = nullptr;
+                uint32_t *flags    = nullptr;
+                void *desc         = nullptr;
+
+                void *map          = nullptr;
+                size_t map_len     = 0;
+            };
+
+            /* Find the index of the interface the AF_XDP socket should be bound to */
+            unsigned find_interface(socket_t socket, sockaddr_in& remote);
+
+            rtp_error_t create_socket();
+            rtp_error_t map_ring(ring& r, uint64_t producer, uint64_t consumer,
+                                 uint64_t flags, uint64_t desc, size_t desc_size, off_t offset);
+            rtp_error_t bind_socket();
+            rtp_error_t load_program();
+            rtp_error_t attach_program();
+
+            /* Parse Ethernet/IPv4/UDP headers of a received frame */
+            void parse_frame(uint8_t *frame, size_t len, uvgrtp::xdp_datagram& dgram);
+
+            void destroy();
+
+            ring fill_;
+            ring comp_;
+            ring rx_;
+
+            uint8_t *umem_;
+            size_t umem_len_;
+
+            int fd_;
+            int map_fd_;
+            int prog_fd_;
+            int link_fd_;
+
+            unsigned ifindex_;
+            uint16_t port_;
+#endif
+    };
+};
+
+namespace uvg_rtp = uvgrtp;
@@ -792,9 +792,9 @@ rtp_error_t uvgrtp::zrtp::get_srtp_keys(
     return RTP_OK;
 }
 
-rtp_error_t uvgrtp::zrtp::packet_handler(ssize_t size, void *packet, int flags, frame::rtp_frame **out)
+rtp_error_t uvgrtp::zrtp::packet_handler(void *arg, ssize_t size, void *packet, int flags, frame::rtp_frame **out)
 {
-    (void)size, (void)flags, (void)out;
+    (void)arg, (void)size, (void)flags, (void)out;
 
     auto msg = (uvgrtp::zrtp_msg::zrtp_msg *)packet;
 
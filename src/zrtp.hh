@@ -212,7 +212,7 @@ namespace uvgrtp {
              * Return RTP_OK on success
              * Return RTP_PKT_NOT_HANDLED if "buffer" does not contain a ZRTP message
              * Return RTP_GENERIC_ERROR if "buffer" contains an invalid ZRTP message */
-            static rtp_error_t packet_handler(ssize_t size, void *packet, int flags, frame::rtp_frame **out);
+            static rtp_error_t packet_handler(void *arg, ssize_t size, void *packet, int flags, frame::rtp_frame **out);
 
         private:
             /* Initialize ZRTP session between us and remote using Diffie-Hellman Mode
@@ -27,24 +27,36 @@ QMAKE_CXXFLAGS += -DNDEBUG
 INCLUDEPATH    += include
 
 SOURCES += \
+	src/bundle.cc \
 	src/clock.cc \
 	src/crypto.cc \
+	src/dedup.cc \
 	src/dispatch.cc \
 	src/frame.cc \
+	src/frame_pool.cc \
 	src/hostname.cc \
 	src/lib.cc \
+	src/loopback.cc \
 	src/media_stream.cc \
 	src/mingw_inet.cc \
 	src/multicast.cc \
+	src/pacer.cc \
 	src/pkt_dispatch.cc \
+	src/pmtu.cc \
 	src/poll.cc \
 	src/queue.cc \
 	src/random.cc \
+	src/rcvbuf.cc \
+	src/reactor.cc \
+	src/recv_slots.cc \
 	src/rtcp.cc \
 	src/rtp.cc \
 	src/runner.cc \
 	src/session.cc \
+	src/shm.cc \
 	src/socket.cc \
+	src/uring.cc \
+	src/xdp.cc \
 	src/holepuncher.cc \
 	src/zrtp.cc \
 	src/formats/media.cc \
@@ -77,16 +89,29 @@ HEADERS += \
 	include/session.hh \
 	include/socket.hh \
 	include/util.hh \
+	src/bundle.hh \
+	src/dedup.hh \
 	src/dispatch.hh \
+	src/frame_pool.hh \
 	src/holepuncher.hh \
 	src/hostname.hh \
+	src/loopback.hh \
 	src/mingw_inet.hh \
 	src/multicast.hh \
+	src/pacer.hh \
 	src/pkt_dispatch.hh \
+	src/pmtu.hh \
 	src/poll.hh \
 	src/queue.hh \
 	src/random.hh \
+	src/rcvbuf.hh \
+	src/reactor.hh \
+	src/recv_slots.hh \
 	src/rtp.hh \
+	src/shm.hh \
+	src/transport.hh \
+	src/uring.hh \
+	src/xdp.hh \
 	src/zrtp.hh \
 	src/formats/media.hh \
 	src/formats/h26x.hh \